@@ -8,44 +8,49 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "borders.h"
 #include "fau.h"
 #include "gamma.h"
+#include "output_writer.h"
 #include "batch_mode.h"
+#include "binary_mode.h"
+#include "render.h"
+#include "stats.h"
+
+/** @brief Checks if character separates words of the line.
+ * @param[in] character - checked character.
+ * @return True for ' ', '\t', '\v', '\f', '\r' and '\n'.
+ */
+static inline bool is_whitespace(char character) {
+    return character == ' ' || (character >= '\t' && character <= '\r');
+}
 
 /** @brief Translates number written is string into integer
- * Check if given string can be interpreted as uint32_t
+ * Check if given word can be interpreted as uint32_t, so if it consists
+ * of digits only, has no leading zeros and is not too big.
  * returns this integer if yes or return -1 if no.
- * @param[in] word  - checked string.
+ * @param[in] word      - checked word,
+ * @param[in] length    - number of characters of the word.
  * @return Returns found number or -1.
  */
-static int64_t interpret_number(char* word) {
-    if (word[0] == '-')
-        return -1; // can't be negative number
-    char* last = NULL;
-    uint64_t result = strtoull(word, &last, 10);
+static int64_t interpret_number(const char* word, size_t length) {
+    if (length > 10 || (word[0] == '0' && length > 1))
+        return -1; // number out of range or with leading zeros
+    uint64_t result = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint32_t digit = (unsigned char)word[i] - '0';
+        if (digit > 9)
+            return -1; // not a digit
+        result = result * 10 + digit;
+    }
     if (result > UINT32_MAX)
         return -1; // number out of range
-    // if number of digits in 'result' differs from 'word' length then  
-    // not whole 'word' was interpreted so result is not valid
-    if (count_digits(result) != strlen(word))
-        return -1;
-    // if 'result' is 0 then it is possible that 'word' was a single
-    // non-numeric char in this case result in not valid 
-    if (result == 0 && word[0] != '0')
-        return -1;
     return (int64_t)result;
 }
 
-/** @brief checks if command can be performed in this moment
- * For given moment in (before of after starting batchmode game) checks
- * if command_type is proper and suits number of parameters.
- * @param[in] my_command    - command to check,
- * @param[in] batch_mode    - has batch mode game already started.
- * @return if command can be performed.
- */
-static bool check_command_type(command* my_command, bool batch_mode) {
+bool check_command_type(command* my_command, bool batch_mode) {
     if (batch_mode) { // commands possible only after starting batch mode game
         if (my_command->command_type == 'm' || my_command->command_type == 'g')
             if (my_command->arguments_number == 3)
@@ -54,95 +59,222 @@ static bool check_command_type(command* my_command, bool batch_mode) {
             my_command->command_type == 'q')
             if (my_command->arguments_number == 1)
                 return true;
-        if (my_command->command_type == 'p')
+        if (my_command->command_type == 'p' ||
+            my_command->command_type == 'c')
             if (my_command->arguments_number == 0)
                 return true;
+        if (my_command->command_type == 'a')
+            if (my_command->arguments_number == 2)
+                return true;
+        if (my_command->command_type == 's' && my_command->path != NULL)
+            return true;
     }
     else { // commands possible only before starting batch mode game
         if (my_command->command_type == 'B' && my_command->arguments_number == 4)
             return true;
         if (my_command->command_type == 'I' && my_command->arguments_number == 4)
             return true;
+        if (my_command->command_type == 'L' && my_command->path != NULL)
+            return true;
+        if (my_command->command_type == 'X' && my_command->arguments_number == 0)
+            return true;
     }
     return false;
 }
 
-bool parse_line(char* input_line, command* my_command, bool batch_mode) {
+bool parse_line(char* input_line, size_t length, command* my_command,
+                bool batch_mode) {
     if (input_line[0] == '#' || input_line[0] == '\n') {
         my_command->command_type = '#';
         return true; // line is a comment or is just single '\n' character
     }
-    const char whitespace[] = " \t\v\f\r\n";
-
-    if (strchr(whitespace, input_line[0]) != NULL)
+    if (is_whitespace(input_line[0]) || input_line[0] == '\0')
         return false; // non-empty line starts with white character
-    if (input_line[strlen(input_line) - 1] != '\n')
+    if (input_line[length - 1] != '\n')
         return false; // line not ended with '\n'
-    
-    char* first_word = strtok(input_line, whitespace);
-    if (first_word == NULL)
-        return false; // non-empty line with only white characters
-    if (strlen(first_word) != 1)
+    if (memchr(input_line, '\0', length) != NULL)
+        return false; // line ends at '\0' instead of '\n'
+    if (!is_whitespace(input_line[1]))
         return false; // first word is not single char
 
-    my_command->command_type = first_word[0];
+    my_command->command_type = input_line[0];
+    my_command->path = NULL;
+    bool path_command = my_command->command_type == 'L' ||
+                        my_command->command_type == 's';
 
     int number_count = 0;
-    char* one_word = strtok(NULL, whitespace);
-    while (one_word != NULL) { 
+    char* end = input_line + length;
+    char* position = input_line + 1;
+    while (true) {
+        while (position < end && is_whitespace(*position))
+            position++;
+        if (position == end)
+            break; // no more words
+        char* word = position;
+        // line ends with '\n', so every word ends with white character
+        while (!is_whitespace(*position))
+            position++;
+        if (path_command) {
+            if (my_command->path != NULL)
+                return false; // too many parameters
+            my_command->path = word;
+            *position++ = '\0';
+            continue;
+        }
         if (number_count > 3)
             return false; // too many parameters
-        int64_t number = interpret_number(one_word);
+        int64_t number = interpret_number(word, position - word);
         if (number == -1)
             return false; // number error
         my_command->args[number_count] = (uint32_t)number;
         number_count++;
-        one_word = strtok(NULL, whitespace);
     }
     my_command->arguments_number = number_count;
-    if (check_command_type(my_command, batch_mode))
-        return true;
-    else 
-        return false;
+    return check_command_type(my_command, batch_mode);
+}
+
+void open_batch_output(batch_output* output, int answers_fd, int errors_fd,
+                       bool strict) {
+    open_writer(&output->answers, answers_fd);
+    open_writer(&output->errors, errors_fd);
+    output->strict = strict;
+    output->binary = false;
 }
 
-/** @brief Runs given command on given gamma game
- * For command which does not need memory allocation runs it and 
- * prints its result.
- * @param[in] my_command    - given command to run,
- * @param[in, out] g        - pointer to structure holding game status.
+void open_batch_sink(batch_output* output, output_sink sink, void* data) {
+    open_sink_writer(&output->answers, sink, data);
+    open_sink_writer(&output->errors, sink, data);
+    output->strict = true;
+    output->binary = false;
+}
+
+void flush_batch_output(batch_output* output) {
+    flush_writer(&output->errors);
+    flush_writer(&output->answers);
+}
+
+void close_batch_output(batch_output* output) {
+    close_writer(&output->errors);
+    close_writer(&output->answers);
+}
+
+/** @brief Gives writer of answers.
+ * In strict mode errors given earlier are written first.
+ * @param[in, out] output   - pointer to outputs of batch mode.
+ * @return Pointer to the writer.
  */
-static void run_in_batch_mode(command* my_command, gamma_t* g) {
-    if (my_command->command_type == 'm') {
-        bool succes = gamma_move(g, my_command->args[0], my_command->args[1],
-                                    my_command->args[2]);
-        if (succes) // if gamma_move was succesfully performed
-            printf("1\n");
-        else
-            printf("0\n");
+static output_writer* answers(batch_output* output) {
+    if (output->strict && output->errors.used > 0)
+        flush_writer(&output->errors);
+    return &output->answers;
+}
+
+void print_error(batch_output* output, int line_number) {
+    if (output->binary) {
+        write_answer(&output->answers, ANSWER_ERROR, line_number, 0);
+        return; // errors are among answers
     }
-    if (my_command->command_type == 'g') {
-        bool succes = gamma_golden_move(g, my_command->args[0], my_command->args[1],
-                                    my_command->args[2]);
-        if (succes) // if gamma_golden_move was succesfully performed
-            printf("1\n");
-        else
-            printf("0\n");
+    if (output->strict && output->answers.used > 0)
+        flush_writer(&output->answers);
+    write_text(&output->errors, "ERROR ", 6);
+    write_number(&output->errors, line_number);
+    write_text(&output->errors, "\n", 1);
+}
+
+void print_answer(batch_output* output, int line_number,
+                  uint64_t number) {
+    if (output->binary) {
+        write_answer(&output->answers, ANSWER_VALUE, line_number, number);
+        return;
     }
-    if (my_command->command_type == 'q') {
-        bool succes = gamma_golden_possible(g, my_command->args[0]);
-        if (succes)
-            printf("1\n");
-        else
-            printf("0\n");
+    output_writer* writer = answers(output);
+    write_number(writer, number);
+    write_text(writer, "\n", 1);
+}
+
+/** @brief Prints move suggested for a player.
+ * Text answer consists of column, row and 1 for golden move or 0.
+ * @param[in, out] output   - pointer to outputs of batch mode,
+ * @param[in] line_number   - number of input line where command is given,
+ * @param[in] x             - column of the field,
+ * @param[in] y             - row of the field,
+ * @param[in] golden        - if it is golden move.
+ */
+static void print_move(batch_output* output, int line_number, uint32_t x,
+                       uint32_t y, bool golden) {
+    if (output->binary) {
+        write_answer(&output->answers,
+                     golden ? ANSWER_GOLDEN_MOVE : ANSWER_MOVE, line_number,
+                     x | (uint64_t)y << 32);
+        return;
     }
+    output_writer* writer = answers(output);
+    write_number(writer, x);
+    write_text(writer, " ", 1);
+    write_number(writer, y);
+    write_text(writer, golden ? " 1\n" : " 0\n", 3);
+}
+
+/** @brief Prints counters of engine hot paths of the game.
+ * Text answer has a line with name and value of every counter.
+ * @param[in, out] output   - pointer to outputs of batch mode,
+ * @param[in] line_number   - number of input line where command is given,
+ * @param[in] g             - pointer to structure holding game status.
+ */
+static void print_stats(batch_output* output, int line_number, gamma_t* g) {
+    for (int i = 0; i < STAT_COUNTERS; i++) {
+        if (output->binary) {
+            write_answer(&output->answers, ANSWER_STAT + i, line_number,
+                         stat_value(g, i));
+            continue;
+        }
+        output_writer* writer = answers(output);
+        write_text(writer, stat_names[i], strlen(stat_names[i]));
+        write_text(writer, " ", 1);
+        write_number(writer, stat_value(g, i));
+        write_text(writer, "\n", 1);
+    }
+}
+
+bool number_command(const command* my_command) {
+    return my_command->command_type == 'm' ||
+           my_command->command_type == 'g' ||
+           my_command->command_type == 'q' ||
+           my_command->command_type == 'b' ||
+           my_command->command_type == 'f';
+}
+
+uint64_t run_number_command(command* my_command, gamma_t* g) {
+    if (my_command->command_type == 'm') // 1 if gamma_move was performed
+        return gamma_move(g, my_command->args[0], my_command->args[1],
+                          my_command->args[2]);
+    if (my_command->command_type == 'g') // 1 if golden move was performed
+        return gamma_golden_move(g, my_command->args[0], my_command->args[1],
+                                 my_command->args[2]);
+    if (my_command->command_type == 'q')
+        return gamma_golden_possible(g, my_command->args[0]);
     if (my_command->command_type == 'b')
-        printf("%lu\n", gamma_busy_fields(g, my_command->args[0]));
-    if (my_command->command_type == 'f')
-        printf("%lu\n", gamma_free_fields(g, my_command->args[0]));
+        return gamma_busy_fields(g, my_command->args[0]);
+    return gamma_free_fields(g, my_command->args[0]);
+}
+
+/** @brief Prints OK line after creating batch mode game.
+ * @param[in, out] output   - pointer to outputs of batch mode,
+ * @param[in] line_number   - number of input line where game was created.
+ */
+static void print_ok(batch_output* output, int line_number) {
+    if (output->binary) {
+        write_answer(&output->answers, ANSWER_OK, line_number, 0);
+        return;
+    }
+    output_writer* writer = answers(output);
+    write_text(writer, "OK ", 3);
+    write_number(writer, line_number);
+    write_text(writer, "\n", 1);
 }
 
-bool run_command(command* my_command, gamma_t** g_pointer, int line_number) {
+bool run_command(command* my_command, gamma_t** g_pointer, int line_number,
+                 batch_output* output) {
     if (my_command->command_type == '#')
         return true; // commend is valid but no actions need to be taken
     if (my_command->command_type == 'B') {
@@ -152,10 +284,22 @@ bool run_command(command* my_command, gamma_t** g_pointer, int line_number) {
             return false; // failed to allocate memory to create new game
         else {
             *g_pointer = g;
-            printf("OK %d\n", line_number);
+            print_ok(output, line_number);
             return true;
         }
     }
+    if (my_command->command_type == 'L') {
+        gamma_t* g = gamma_load(my_command->path);
+        if (g == NULL)
+            return false; // failed to load the game
+        else {
+            *g_pointer = g;
+            print_ok(output, line_number);
+            return true;
+        }
+    }
+    if (my_command->command_type == 's')
+        return gamma_save(*g_pointer, my_command->path);
     if (my_command->command_type == 'I') {
         gamma_t* g = gamma_new(my_command->args[0], my_command->args[1],
                                my_command->args[2], my_command->args[3]);
@@ -166,17 +310,47 @@ bool run_command(command* my_command, gamma_t** g_pointer, int line_number) {
             return true;
         }
     }
+    if (my_command->command_type == 'X')
+        return true; // input is switched to binary records by the caller
     if (my_command->command_type == 'p') {
-        char* board = gamma_board(*g_pointer);
-        if (board == NULL)
-            return false; // failed to allocate memory to perform gamma_board
-        else {
-            printf("%s", board);
+        gamma_t* g = *g_pointer;
+        if (output->binary) {
+            uint64_t line_size = g->width * field_text_size(g) +
+                                 (g->players < 10 ? 1 : 0);
+            write_answer(&output->answers, ANSWER_BOARD, line_number,
+                         line_size * g->height);
+        }
+        flush_writer(answers(output));
+        if (output->answers.sink != NULL) {
+            // sink gets the whole board at once
+            char* board = gamma_board(g);
+            if (board == NULL)
+                return false;
+            write_text(&output->answers, board, strlen(board));
             free(board);
             return true;
         }
+        // board is written directly to the descriptor
+        return gamma_board_write(g, output->answers.fd);
     } 
-    else // other possible commands that don't allocate heap memory
-        run_in_batch_mode(my_command, *g_pointer);
+    if (my_command->command_type == 'a') {
+        uint32_t x, y;
+        bool golden;
+        // player gets move found by searching for given milliseconds
+        if (!gamma_suggest_move(*g_pointer, my_command->args[0],
+                                my_command->args[1], 0, &x, &y, &golden))
+            return false; // no move or failed to allocate memory
+        print_move(output, line_number, x, y, golden);
+        return true;
+    }
+    if (my_command->command_type == 'c') {
+        if (!stats_enabled())
+            return false; // counters aren't compiled in
+        print_stats(output, line_number, *g_pointer);
+        return true;
+    }
+    else if (number_command(my_command))
+        print_answer(output, line_number,
+                     run_number_command(my_command, *g_pointer));
     return true;    
-}
\ No newline at end of file
+}
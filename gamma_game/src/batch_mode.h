@@ -12,19 +12,44 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "output_writer.h"
+
+/** @brief Structure representing outputs of batch mode.
+ * Answers go to one writer and errors to the other. In strict mode
+ * a writer is flushed before anything is written to the other one, so
+ * answers and errors are interleaved in the order they were given.
+ */
+typedef struct batch_output {
+    output_writer answers; ///< output of answers (standard output).
+    output_writer errors; ///< output of errors (standard error output).
+    bool strict; ///< if order between answers and errors is kept.
+    bool binary; ///< if answers and errors are binary records.
+} batch_output;
+
 /** @brief Structure representing potentially valid command in batch mode.
  * Input represents input line that can be interpreted as single char 
  * and up to four integers or is a commant.
+ * Commands 'L' and 's' take single file path instead of integers.
  * comment is a valid command too.
- * command_type can be '#' (for empty lines or commants), 'B', 'I',
- * 'm', 'g', 'b', 'f', 'q', 'p'. 
+ * command_type can be '#' (for empty lines or commants), 'B', 'I', 'L', 'X',
+ * 'm', 'g', 'b', 'f', 'q', 'p', 's', 'a', 'c'.
  */
 typedef struct command {
     char command_type; ///< what action command represents (# if comment).
     uint32_t* args; ///< up to 4 integer parameters.
     int arguments_number; ///< number of parameters
+    char* path; ///< file path pointing into parsed line ('L' and 's').
 } command;
 
+/** @brief checks if command can be performed in this moment
+ * For given moment in (before of after starting batchmode game) checks
+ * if command_type is proper and suits number of parameters.
+ * @param[in] my_command    - command to check,
+ * @param[in] batch_mode    - has batch mode game already started.
+ * @return if command can be performed.
+ */
+bool check_command_type(command* my_command, bool batch_mode);
+
 /** @brief Checks if single line can be interpreted as valid command
  * Checks if line is empty or starts with '#' what means it is a comment
  * If line can be interpreted as some command checks if this command
@@ -32,24 +57,84 @@ typedef struct command {
  * If line can be interpreted as valid command, sets command values
  * at pointed command (my_command).
  * Diffrent commands can be valid depending on activation of batch_mode.
- * @param[in, out] input_line   - inputed string to parse,
+ * Line with '\0' character is valid only as a comment.
+ * @param[in, out] input_line   - inputed line to parse (not ended with '\0'),
+ * @param[in] length            - number of characters of the line,
  * @param[in, out] my_command   - pointed to a command that will be modified,
  * @param[in] batch_mode        - if batch mode is active.
  * @return Returns true if line can be interpreted as valid command,
  *         returns false otherwise
  */
-bool parse_line(char* input_line, command* my_command, bool batch_mode);
+bool parse_line(char* input_line, size_t length, command* my_command,
+                bool batch_mode);
+
+/** @brief Prepares outputs of batch mode.
+ * Outputs are textual until binary protocol is started.
+ * @param[out] output       - pointer to initialized outputs,
+ * @param[in] answers_fd    - descriptor for answers,
+ * @param[in] errors_fd     - descriptor for errors,
+ * @param[in] strict        - if order between answers and errors is kept.
+ */
+void open_batch_output(batch_output* output, int answers_fd, int errors_fd,
+                       bool strict);
+
+/** @brief Prepares outputs of batch mode given to a function.
+ * Answers and errors are passed to the same sink in the order of commands.
+ * @param[out] output       - pointer to initialized outputs,
+ * @param[in] sink          - function receiving answers and errors,
+ * @param[in] data          - data passed to the sink.
+ */
+void open_batch_sink(batch_output* output, output_sink sink, void* data);
+
+/** @brief Writes all buffered answers and errors.
+ * @param[in, out] output   - pointer to outputs of batch mode.
+ */
+void flush_batch_output(batch_output* output);
+
+/** @brief Flushes and frees outputs of batch mode.
+ * @param[in, out] output   - pointer to outputs of batch mode.
+ */
+void close_batch_output(batch_output* output);
+
+/** @brief Reports ERROR and line number as an error.
+ * @param[in, out] output   - pointer to outputs of batch mode,
+ * @param[in] line_number   - line where the error occured.
+ */
+void print_error(batch_output* output, int line_number);
+
+/** @brief Prints answer of a command.
+ * @param[in, out] output   - pointer to outputs of batch mode,
+ * @param[in] line_number   - number of input line where command is given,
+ * @param[in] number        - the answer.
+ */
+void print_answer(batch_output* output, int line_number, uint64_t number);
+
+/** @brief Checks if command is answered with a single number.
+ * Those are commands 'm', 'g', 'q', 'b' and 'f', they never fail.
+ * @param[in] my_command    - checked command.
+ * @return True if command is answered with a single number.
+ */
+bool number_command(const command* my_command);
+
+/** @brief Runs command answered with a single number.
+ * @param[in] my_command    - command checked by number_command,
+ * @param[in, out] g        - pointer to structure holding game status.
+ * @return The answer of the command.
+ */
+uint64_t run_number_command(command* my_command, gamma_t* g);
 
 /** @brief Performs gamma function represented in command reports if succesful
  * For given command runs one of gamma functions (including gamma_new)
  * If commend means creating batch_mode game or interactive_mode game
- * and game is created succesfully modifies pointer *g_pointer, 
- * (in batch_mode game also prints OK line).
+ * or loading batch_mode game and game is created succesfully modifies
+ * pointer *g_pointer, (in batch_mode game also prints OK line).
  * @param[in] my_command    - given command,
  * @param[in] g_pointer     - pointer to gamma_t pointer used in gamma_main,
- * @param[in] line_number   - number of input line where command is given. 
+ * @param[in] line_number   - number of input line where command is given,
+ * @param[in, out] output   - pointer to outputs of batch mode.
  * @return Reports if commend was succesfully performed
  */
-bool run_command(command* my_command, gamma_t** g_pointer, int line_number);
+bool run_command(command* my_command, gamma_t** g_pointer, int line_number,
+                 batch_output* output);
 
 #endif /* BATCH_MODE_H */
@@ -0,0 +1,52 @@
+/** @file
+ * Implementation of binary protocol of batch mode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gamma.h"
+#include "batch_mode.h"
+#include "line_reader.h"
+#include "output_writer.h"
+#include "binary_mode.h"
+
+void write_answer(output_writer* writer, uint32_t answer_type,
+                  uint32_t record, uint64_t value) {
+    binary_answer answer = {answer_type, record, value};
+    write_text(writer, (const char*)&answer, sizeof(answer));
+}
+
+void run_binary(line_reader* reader, batch_output* output) {
+    gamma_t* g = NULL;
+    uint32_t args[4];
+    command my_command = {0, args, 0, NULL};
+    char* data;
+    int record_number = 0;
+    size_t length;
+    while ((length = next_bytes(reader, &data, sizeof(binary_command))) > 0) {
+        binary_command record;
+        memcpy(&record, data, length);
+        record_number++;
+
+        bool proper_command = length == sizeof(record) && // record not cut
+                              record.command_type != BINARY_INVALID &&
+                              record.command_type != 'I' &&
+                              record.command_type != 'X' &&
+                              record.arguments_number <= 4;
+        if (proper_command && record.command_type != '#') {
+            my_command.command_type = (char)record.command_type;
+            my_command.arguments_number = record.arguments_number;
+            memcpy(args, record.args, sizeof(args));
+            proper_command = check_command_type(&my_command, g != NULL) &&
+                             run_command(&my_command, &g, record_number,
+                                         output);
+        }
+        if (!proper_command)
+            print_error(output, record_number);
+    }
+    gamma_delete(g);
+}
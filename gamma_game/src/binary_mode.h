@@ -0,0 +1,75 @@
+/** @file
+ * Interface of binary protocol of batch mode.
+ * After text command 'X' input consists of fixed size command records
+ * and answers are given as fixed size answer records. Records are numbered
+ * from 1 and numbers are written in byte order of the machine.
+ */
+
+#ifndef BINARY_MODE_H
+#define BINARY_MODE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "batch_mode.h"
+#include "line_reader.h"
+
+/** @brief Type of record that is not a command, always answered with error. */
+#define BINARY_INVALID 0
+
+/** @brief Answer with a number, result of 'm', 'g', 'q', 'b' or 'f'. */
+#define ANSWER_VALUE 0
+/** @brief Answer to 'B', the game was created. */
+#define ANSWER_OK 1
+/** @brief Answer to incorrect record. */
+#define ANSWER_ERROR 2
+/** @brief Answer to 'p', value characters of the board follow it. */
+#define ANSWER_BOARD 3
+/** @brief Answer to 'a', value holds column and row shifted by 32 bits. */
+#define ANSWER_MOVE 4
+/** @brief Answer to 'a' suggesting golden move, value as in ANSWER_MOVE. */
+#define ANSWER_GOLDEN_MOVE 5
+/** @brief Answer to 'c' giving the first counter, every counter of
+ * stat_counter has its own type, value holds the counter. */
+#define ANSWER_STAT 6
+
+/** @brief Structure representing command record.
+ * Command type is one of command letters of text batch mode or '#'
+ * for record doing nothing.
+ */
+typedef struct binary_command {
+    uint8_t command_type; ///< what action command represents.
+    uint8_t arguments_number; ///< number of used arguments.
+    uint16_t reserved; ///< always 0.
+    uint32_t args[4]; ///< parameters of the command.
+} binary_command;
+
+/** @brief Structure representing answer record.
+ */
+typedef struct binary_answer {
+    uint32_t answer_type; ///< one of ANSWER_ values.
+    uint32_t record; ///< number of answered command record.
+    uint64_t value; ///< answer, or number of board characters.
+} binary_answer;
+
+/** @brief Writes answer record.
+ * @param[in, out] writer   - writer of answers,
+ * @param[in] answer_type   - one of ANSWER_ values,
+ * @param[in] record        - number of answered command record,
+ * @param[in] value         - the answer.
+ */
+void write_answer(output_writer* writer, uint32_t answer_type,
+                  uint32_t record, uint64_t value);
+
+/** @brief Runs commands given as binary records.
+ * Reads command records till the end of input. Errors are answered with
+ * error records among other answers, incomplete record at the end of input
+ * is an error too.
+ * @param[in, out] reader   - reader of the input,
+ * @param[in, out] output   - pointer to outputs of batch mode.
+ */
+void run_binary(line_reader* reader, batch_output* output);
+
+#endif /* BINARY_MODE_H */
@@ -0,0 +1,631 @@
+/** @file
+ * Implementation of board storage allocation, tiles and sparse board.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "borders.h"
+#include "board.h"
+
+/** @brief Maximal number of bytes of board kept whole. */
+#define DENSE_LIMIT (1ULL << 30)
+
+/** @brief Number of slots of a new sparse board. */
+#define INITIAL_SLOTS 1024
+
+/** @brief Structure representing loaded snapshot holding data of tiles.
+ */
+typedef struct mapping {
+    atomic_uint_fast64_t refs; ///< number of tiles lying in the snapshot.
+    void* begin; ///< beginning of the mapping.
+    uint64_t size; ///< size of the mapping.
+} mapping;
+
+/** @brief Structure representing tile of an array.
+ * Data of the tile follows the structure unless it lies in a snapshot.
+ */
+typedef struct tile {
+    atomic_uint_fast64_t refs; ///< number of games using the tile.
+    mapping* snapshot; ///< snapshot holding data of the tile or NULL.
+    uint64_t size; ///< number of bytes of data.
+    struct tile* next; ///< next reserved tile.
+    max_align_t data[]; ///< data of the tile.
+} tile;
+
+size_t index_size(gamma_t* g) {
+    return g->wide_indexes ? sizeof(int64_t) : sizeof(int32_t);
+}
+
+/** @brief Allocates a tile used by one game.
+ * @param[in] size          - number of bytes of data,
+ * @param[in] zero          - if data should be zeroed.
+ * @return Pointer to the tile or NULL if memory couldn't be allocated.
+ */
+static tile* new_tile(uint64_t size, bool zero) {
+    tile* t = zero ? calloc(1, sizeof(tile) + size) :
+                     malloc(sizeof(tile) + size);
+    if (t != NULL) {
+        atomic_init(&t->refs, 1);
+        t->snapshot = NULL;
+        t->size = size;
+    }
+    return t;
+}
+
+/** @brief Releases the snapshot, unmaps it if no tile lies in it.
+ * @param[in, out] m        - pointer to the snapshot.
+ */
+static void release_mapping(mapping* m) {
+    if (atomic_fetch_sub_explicit(&m->refs, 1, memory_order_acq_rel) == 1) {
+        munmap(m->begin, m->size);
+        free(m);
+    }
+}
+
+/** @brief Releases the tile, frees it if no game uses it.
+ * @param[in, out] t        - pointer to the tile.
+ */
+static void release_tile(tile* t) {
+    if (atomic_fetch_sub_explicit(&t->refs, 1, memory_order_acq_rel) == 1) {
+        if (t->snapshot != NULL)
+            release_mapping(t->snapshot);
+        free(t);
+    }
+}
+
+/** @brief Gives number of tiles needed for given number of elements.
+ * @param[in] elements      - number of elements.
+ * @return Number of tiles.
+ */
+static uint64_t tiles_for(uint64_t elements) {
+    return (elements + TILE_ELEMENTS - 1) >> TILE_SHIFT;
+}
+
+/** @brief Gives number of elements of the tile, the last can be partial.
+ * @param[in] elements      - number of elements of the array,
+ * @param[in] number        - number of the tile.
+ * @return Number of elements.
+ */
+static uint64_t tile_elements(uint64_t elements, uint64_t number) {
+    uint64_t left = elements - (number << TILE_SHIFT);
+    return left < TILE_ELEMENTS ? left : TILE_ELEMENTS;
+}
+
+/** @brief Allocates table of tiles of an array.
+ * Data pointers, tiles and flags are kept in one block.
+ * @param[out] array        - pointer to the array,
+ * @param[in] count         - number of tiles.
+ * @return False if memory couldn't be allocated, the array is empty then.
+ */
+static bool alloc_table(tiled_array* array, uint64_t count) {
+    char* block = malloc(count * (sizeof(void*) + sizeof(tile*) +
+                                  sizeof(bool)) + 1);
+    if (block == NULL) {
+        *array = (tiled_array){NULL, NULL, NULL, 0};
+        return false; // failed to allocate memory
+    }
+    array->data = (void**)block;
+    array->tiles = (tile**)(block + count * sizeof(void*));
+    array->writable = (bool*)(block + count * (sizeof(void*) + sizeof(tile*)));
+    array->count = count;
+    return true;
+}
+
+/** @brief Releases every tile of the array and frees its table.
+ * @param[in, out] array    - pointer to the array, it is empty afterwards.
+ */
+static void free_tiled(tiled_array* array) {
+    for (uint64_t i = 0; i < array->count; i++)
+        release_tile(array->tiles[i]);
+    free(array->data);
+    *array = (tiled_array){NULL, NULL, NULL, 0};
+}
+
+/** @brief Allocates array of tiles used by one game.
+ * @param[out] array        - pointer to the array,
+ * @param[in] elements      - number of elements,
+ * @param[in] size          - size of single element,
+ * @param[in] zero          - if elements should be zeroed.
+ * @return False if memory couldn't be allocated, the array is empty then.
+ */
+static bool alloc_tiled(tiled_array* array, uint64_t elements, size_t size,
+                        bool zero) {
+    if (!alloc_table(array, tiles_for(elements)))
+        return false; // failed to allocate memory
+    for (uint64_t i = 0; i < array->count; i++) {
+        tile* t = new_tile(tile_elements(elements, i) * size, zero);
+        if (t == NULL) {
+            array->count = i;
+            free_tiled(array);
+            return false; // failed to allocate memory
+        }
+        array->tiles[i] = t;
+        array->data[i] = t->data;
+        array->writable[i] = true;
+    }
+    return true;
+}
+
+/** @brief Allocates copy of the array used only by the copying game.
+ * @param[out] copy         - pointer to the copy,
+ * @param[in] array         - pointer to copied array.
+ * @return False if memory couldn't be allocated, the copy is empty then.
+ */
+static bool copy_tiled(tiled_array* copy, tiled_array* array) {
+    if (!alloc_table(copy, array->count))
+        return false; // failed to allocate memory
+    for (uint64_t i = 0; i < array->count; i++) {
+        tile* t = new_tile(array->tiles[i]->size, false);
+        if (t == NULL) {
+            copy->count = i;
+            free_tiled(copy);
+            return false; // failed to allocate memory
+        }
+        memcpy(t->data, array->data[i], t->size);
+        copy->tiles[i] = t;
+        copy->data[i] = t->data;
+        copy->writable[i] = true;
+    }
+    return true;
+}
+
+/** @brief Shares tiles of the array with a clone.
+ * Both games have to copy a tile before changing it afterwards.
+ * @param[in, out] copy     - pointer to the cloned game,
+ * @param[out] shared       - pointer to array of the clone,
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in, out] array    - pointer to shared array.
+ * @return False if memory couldn't be allocated, the clone's array is
+ * empty then.
+ */
+static bool share_tiled(gamma_t* copy, tiled_array* shared, gamma_t* g,
+                        tiled_array* array) {
+    if (!alloc_table(shared, array->count))
+        return false; // failed to allocate memory
+    for (uint64_t i = 0; i < array->count; i++) {
+        atomic_fetch_add_explicit(&array->tiles[i]->refs, 1,
+                                  memory_order_relaxed);
+        shared->tiles[i] = array->tiles[i];
+        shared->data[i] = array->data[i];
+        shared->writable[i] = false;
+        if (array->writable[i]) {
+            array->writable[i] = false;
+            g->shared_tiles++;
+        }
+    }
+    copy->shared_tiles += array->count;
+    return true;
+}
+
+/** @brief Allocates arrays of sparse board with given number of slots.
+ * Every slot is empty.
+ * @param[in] g             - pointer to structure holding game status,
+ * @param[in] slots         - number of slots, power of two,
+ * @param[out] keys         - pointer to array of slot keys,
+ * @param[out] owners       - pointer to array of owners,
+ * @param[out] field_nodes  - pointer to array of nodes.
+ * @return False if memory couldn't be allocated.
+ */
+static bool alloc_slots(gamma_t* g, uint64_t slots, tiled_array* keys,
+                        tiled_array* owners, tiled_array* field_nodes) {
+    // keys of empty slots have every bit set
+    if (alloc_tiled(keys, slots, sizeof(uint64_t), false) &&
+        alloc_tiled(owners, slots, sizeof(uint32_t), false) &&
+        alloc_tiled(field_nodes, slots, index_size(g), false)) {
+        for (uint64_t i = 0; i < keys->count; i++)
+            memset(keys->data[i], 0xFF, keys->tiles[i]->size);
+        return true;
+    }
+    free_tiled(keys);
+    free_tiled(owners);
+    free_tiled(field_nodes);
+    return false; // failed to allocate memory
+}
+
+/** @brief Gives hash shift for given number of slots.
+ * @param[in] slots         - number of slots, power of two.
+ * @return Shift leaving highest bits of hash which index the slots.
+ */
+static uint32_t shift_for(uint64_t slots) {
+    uint32_t shift = 64;
+    while (slots > 1) {
+        slots /= 2;
+        shift--;
+    }
+    return shift;
+}
+
+/** @brief Allocates arrays of the board.
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in] board_size    - number of fields on the board.
+ * @return False if memory couldn't be allocated.
+ */
+static bool init_fields(gamma_t* g, uint64_t board_size) {
+    g->field_keys = (tiled_array){NULL, NULL, NULL, 0};
+    if (board_size <= DENSE_LIMIT / (sizeof(uint32_t) + index_size(g))) {
+        g->sparse = false;
+        if (alloc_tiled(&g->owners, board_size, sizeof(uint32_t), true) &&
+            alloc_tiled(&g->field_nodes, board_size, index_size(g), false))
+            return true;
+        free_tiled(&g->owners);
+    }
+    // whole board takes too much memory
+    g->sparse = true;
+    g->slots = INITIAL_SLOTS;
+    g->slots_shift = shift_for(g->slots);
+    g->busy_slots = 0;
+    return alloc_slots(g, g->slots, &g->field_keys, &g->owners,
+                       &g->field_nodes);
+}
+
+bool init_board(gamma_t* g, uint64_t nodes) {
+    uint64_t board_size = g->width * (uint64_t)g->height;
+    g->wide_indexes = board_size > INT32_MAX;
+    g->used_nodes = 0;
+    g->nodes_capacity = nodes;
+    g->shared_tiles = 0;
+    g->spare_tiles = NULL;
+    g->spares = 0;
+    if (!alloc_tiled(&g->nodes, nodes, index_size(g), false))
+        return false; // failed to allocate memory
+    if (!init_fields(g, board_size)) {
+        free_tiled(&g->nodes);
+        return false; // failed to allocate memory
+    }
+    return true;
+}
+
+/** @brief Makes tiles of the array point into the snapshot.
+ * @param[out] array        - pointer to the array,
+ * @param[in, out] m        - pointer to the snapshot,
+ * @param[in] begin         - beginning of the array in the snapshot,
+ * @param[in] elements      - number of elements,
+ * @param[in] size          - size of single element.
+ * @return False if memory couldn't be allocated, the array is empty then.
+ */
+static bool map_tiled(tiled_array* array, mapping* m, char* begin,
+                      uint64_t elements, size_t size) {
+    if (!alloc_table(array, tiles_for(elements)))
+        return false; // failed to allocate memory
+    for (uint64_t i = 0; i < array->count; i++) {
+        tile* t = new_tile(0, false);
+        if (t == NULL) {
+            array->count = i;
+            free_tiled(array);
+            return false; // failed to allocate memory
+        }
+        atomic_fetch_add_explicit(&m->refs, 1, memory_order_relaxed);
+        t->snapshot = m;
+        t->size = tile_elements(elements, i) * size;
+        array->tiles[i] = t;
+        array->data[i] = begin + (i << TILE_SHIFT) * size;
+        array->writable[i] = true;
+    }
+    return true;
+}
+
+bool map_board(gamma_t* g, char* begin, uint64_t size,
+               const uint64_t offsets[4]) {
+    g->owners = g->field_nodes = g->field_keys = g->nodes =
+        (tiled_array){NULL, NULL, NULL, 0};
+    g->shared_tiles = 0;
+    g->spare_tiles = NULL;
+    g->spares = 0;
+    mapping* m = malloc(sizeof(mapping));
+    if (m == NULL) {
+        munmap(begin, size);
+        return false; // failed to allocate memory
+    }
+    // the snapshot is held until every tile is made
+    atomic_init(&m->refs, 1);
+    m->begin = begin;
+    m->size = size;
+    uint64_t positions = storage_size(g);
+    bool mapped = map_tiled(&g->owners, m, begin + offsets[0], positions,
+                            sizeof(uint32_t)) &&
+        map_tiled(&g->field_nodes, m, begin + offsets[1], positions,
+                  index_size(g)) &&
+        (!g->sparse || map_tiled(&g->field_keys, m, begin + offsets[2],
+                                 positions, sizeof(uint64_t))) &&
+        map_tiled(&g->nodes, m, begin + offsets[3], g->nodes_capacity,
+                  index_size(g));
+    if (!mapped)
+        free_board(g);
+    release_mapping(m);
+    return mapped;
+}
+
+void free_board(gamma_t* g) {
+    free_tiled(&g->owners);
+    free_tiled(&g->field_nodes);
+    free_tiled(&g->field_keys);
+    free_tiled(&g->nodes);
+    reserve_tiles(g, 0); // frees reserved tiles
+}
+
+bool clone_board(gamma_t* copy, gamma_t* g) {
+    copy->owners = copy->field_nodes = copy->field_keys = copy->nodes =
+        (tiled_array){NULL, NULL, NULL, 0};
+    copy->shared_tiles = 0;
+    copy->spare_tiles = NULL;
+    copy->spares = 0;
+    bool cloned;
+    if (g->sparse) // tables of sparse board are small enough to be copied
+        cloned = copy_tiled(&copy->owners, &g->owners) &&
+                 copy_tiled(&copy->field_nodes, &g->field_nodes) &&
+                 copy_tiled(&copy->field_keys, &g->field_keys);
+    else
+        cloned = share_tiled(copy, &copy->owners, g, &g->owners) &&
+                 share_tiled(copy, &copy->field_nodes, g, &g->field_nodes);
+    cloned = cloned && share_tiled(copy, &copy->nodes, g, &g->nodes);
+    if (!cloned) {
+        free_board(copy);
+        copy->shared_tiles = 0;
+        return false; // failed to allocate memory
+    }
+    return true;
+}
+
+bool view_board(gamma_t* view, gamma_t* g) {
+    view->owners = view->field_nodes = view->field_keys = view->nodes =
+        (tiled_array){NULL, NULL, NULL, 0};
+    view->shared_tiles = 0;
+    view->spare_tiles = NULL;
+    view->spares = 0;
+    bool viewed;
+    if (g->sparse)
+        viewed = copy_tiled(&view->owners, &g->owners) &&
+                 copy_tiled(&view->field_keys, &g->field_keys);
+    else
+        viewed = share_tiled(view, &view->owners, g, &g->owners);
+    if (!viewed) {
+        free_board(view);
+        view->shared_tiles = 0;
+        return false; // failed to allocate memory
+    }
+    return true;
+}
+
+/** @brief Gives number of bytes of reserved tile.
+ * Every shared tile fits in it, owners of wide board are never shared.
+ * @param[in] g             - pointer to structure holding game status.
+ * @return Number of bytes.
+ */
+static uint64_t spare_size(gamma_t* g) {
+    return TILE_ELEMENTS * index_size(g);
+}
+
+bool reserve_tiles(gamma_t* g, uint64_t count) {
+    if (count > g->shared_tiles)
+        count = g->shared_tiles;
+    while (g->spares > count) {
+        tile* t = g->spare_tiles;
+        g->spare_tiles = t->next;
+        g->spares--;
+        free(t);
+    }
+    while (g->spares < count) {
+        tile* t = new_tile(spare_size(g), false);
+        if (t == NULL)
+            return false; // failed to allocate memory
+        t->next = g->spare_tiles;
+        g->spare_tiles = t;
+        g->spares++;
+    }
+    return true;
+}
+
+void own_tile(gamma_t* g, tiled_array* array, uint64_t number) {
+    tile* shared = array->tiles[number];
+    array->writable[number] = true;
+    g->shared_tiles--;
+    if (atomic_load_explicit(&shared->refs, memory_order_acquire) == 1)
+        return; // other games don't use the tile anymore
+    tile* t = g->spare_tiles;
+    if (t != NULL) {
+        g->spare_tiles = t->next;
+        g->spares--;
+    }
+    else {
+        t = new_tile(spare_size(g), false);
+        if (t == NULL)
+            abort(); // tiles weren't reserved before changing the board
+    }
+    t->size = shared->size;
+    memcpy(t->data, array->data[number], t->size);
+    array->tiles[number] = t;
+    array->data[number] = t->data;
+    release_tile(shared);
+}
+
+/** @brief Makes the game the only user of every tile of the array.
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in, out] array    - pointer to the array.
+ */
+static void own_tiled(gamma_t* g, tiled_array* array) {
+    for (uint64_t i = 0; i < array->count; i++)
+        if (!array->writable[i])
+            own_tile(g, array, i);
+}
+
+bool own_board(gamma_t* g) {
+    if (!reserve_tiles(g, g->shared_tiles))
+        return false; // failed to allocate memory
+    own_tiled(g, &g->owners);
+    own_tiled(g, &g->field_nodes);
+    own_tiled(g, &g->nodes);
+    reserve_tiles(g, 0); // tiles released by other games weren't copied
+    return true;
+}
+
+uint64_t max_nodes(gamma_t* g) {
+    return g->wide_indexes ? (uint64_t)INT64_MAX : (uint64_t)INT32_MAX;
+}
+
+bool resize_nodes(gamma_t* g, uint64_t capacity) {
+    tiled_array* nodes = &g->nodes;
+    tiled_array resized;
+    if (!alloc_table(&resized, tiles_for(capacity)))
+        return false; // failed to allocate memory
+    // full tiles are kept, the last partial one is replaced
+    uint64_t kept = g->nodes_capacity >> TILE_SHIFT;
+    for (uint64_t i = 0; i < kept; i++) {
+        resized.tiles[i] = nodes->tiles[i];
+        resized.data[i] = nodes->data[i];
+        resized.writable[i] = nodes->writable[i];
+    }
+    for (uint64_t i = kept; i < resized.count; i++) {
+        tile* t = new_tile(tile_elements(capacity, i) * index_size(g), false);
+        if (t == NULL) {
+            for (uint64_t j = kept; j < i; j++)
+                release_tile(resized.tiles[j]);
+            free(resized.data);
+            return false; // failed to allocate memory
+        }
+        resized.tiles[i] = t;
+        resized.data[i] = t->data;
+        resized.writable[i] = true;
+    }
+    if (kept < nodes->count) {
+        memcpy(resized.data[kept], nodes->data[kept],
+               nodes->tiles[kept]->size);
+        if (!nodes->writable[kept])
+            g->shared_tiles--;
+        release_tile(nodes->tiles[kept]);
+    }
+    free(nodes->data);
+    *nodes = resized;
+    g->nodes_capacity = capacity;
+    return true;
+}
+
+/** @brief Copies node of the field between slots of sparse board.
+ * @param[in] g             - pointer to structure holding game status,
+ * @param[out] to_nodes     - array of nodes to copy to,
+ * @param[in] to            - slot to copy to,
+ * @param[in] from_nodes    - array of nodes to copy from,
+ * @param[in] from          - slot to copy from.
+ */
+static void copy_node(gamma_t* g, tiled_array* to_nodes, uint64_t to,
+                      tiled_array* from_nodes, uint64_t from) {
+    size_t size = index_size(g);
+    memcpy(tile_element(to_nodes, to, size),
+           tile_element(from_nodes, from, size), size);
+}
+
+/** @brief Sets key and owner of the slot of sparse board.
+ * Tiles of sparse board are never shared, so they are changed directly.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] slot      - number of the slot,
+ * @param[in] key       - number of the field or NO_FIELD,
+ * @param[in] owner     - number of the owner.
+ */
+static void set_slot(gamma_t* g, uint64_t slot, uint64_t key,
+                     uint32_t owner) {
+    *(uint64_t*)tile_element(&g->field_keys, slot, sizeof(uint64_t)) = key;
+    *(uint32_t*)tile_element(&g->owners, slot, sizeof(uint32_t)) = owner;
+}
+
+/** @brief Removes the field from the table of sparse board.
+ * Shifts following fields back so no probing sequence is broken.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] slot      - slot of the field.
+ */
+static void remove_slot(gamma_t* g, uint64_t slot) {
+    uint64_t mask = g->slots - 1;
+    uint64_t next = slot;
+    while (true) {
+        next = (next + 1) & mask;
+        uint64_t key = slot_key(g, next);
+        if (key == NO_FIELD)
+            break;
+        uint64_t home = (key * 0x9E3779B97F4A7C15ULL) >> g->slots_shift;
+        // field can be moved back if its home slot is not cyclically
+        // in range (slot, next]
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            set_slot(g, slot, key, *(uint32_t*)tile_element(&g->owners, next,
+                                                            sizeof(uint32_t)));
+            copy_node(g, &g->field_nodes, slot, &g->field_nodes, next);
+            slot = next;
+        }
+    }
+    set_slot(g, slot, NO_FIELD, 0);
+    g->busy_slots--;
+}
+
+void set_sparse_owner(gamma_t* g, uint64_t board_num, uint32_t owner) {
+    uint64_t slot = field_slot(g, board_num);
+    if (owner == 0) {
+        if (slot_key(g, slot) != NO_FIELD)
+            remove_slot(g, slot);
+        return;
+    }
+    if (slot_key(g, slot) == NO_FIELD)
+        g->busy_slots++;
+    set_slot(g, slot, board_num, owner);
+}
+
+bool reserve_field(gamma_t* g) {
+    if (!g->sparse || 2 * (g->busy_slots + 1) <= g->slots)
+        return true;
+    // table is kept at most half full so probing sequences stay short
+    uint64_t slots = 2 * g->slots;
+    tiled_array keys, owners, field_nodes;
+    if (!alloc_slots(g, slots, &keys, &owners, &field_nodes))
+        return false; // failed to allocate memory
+
+    tiled_array old_keys = g->field_keys;
+    tiled_array old_owners = g->owners;
+    tiled_array old_nodes = g->field_nodes;
+    uint64_t old_slots = g->slots;
+    g->field_keys = keys;
+    g->owners = owners;
+    g->field_nodes = field_nodes;
+    g->slots = slots;
+    g->slots_shift = shift_for(slots);
+    for (uint64_t i = 0; i < old_slots; i++) {
+        uint64_t key = *(uint64_t*)tile_element(&old_keys, i,
+                                                sizeof(uint64_t));
+        if (key == NO_FIELD)
+            continue;
+        uint64_t slot = field_slot(g, key);
+        set_slot(g, slot, key, *(uint32_t*)tile_element(&old_owners, i,
+                                                        sizeof(uint32_t)));
+        copy_node(g, &g->field_nodes, slot, &old_nodes, i);
+    }
+    free_tiled(&old_keys);
+    free_tiled(&old_owners);
+    free_tiled(&old_nodes);
+    return true;
+}
+
+bool next_busy_field(gamma_t* g, uint64_t* position, uint64_t* board_num) {
+    uint64_t size = storage_size(g);
+    while (*position < size) {
+        uint64_t i = (*position)++;
+        if (g->sparse && slot_key(g, i) != NO_FIELD) {
+            *board_num = slot_key(g, i);
+            return true;
+        }
+        if (!g->sparse &&
+            *(uint32_t*)tile_element(&g->owners, i, sizeof(uint32_t)) != 0) {
+            *board_num = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t storage_size(gamma_t* g) {
+    if (g->sparse)
+        return g->slots;
+    return g->width * (uint64_t)g->height;
+}
@@ -0,0 +1,371 @@
+/** @file
+ * Interface of board storage.
+ * Owners of fields, find-and-union nodes of fields and parents of nodes
+ * are kept in separate arrays. Indexes of nodes are 32-bit if the board has
+ * less than 2^31 fields and 64-bit otherwise. Node representing an area
+ * holds minus number of fields in the area instead of its parent.
+ * Boards too large to be kept whole are sparse: only busy fields are kept,
+ * in open addressing hash table, and owners and nodes are indexed by slots
+ * of the table instead of numbers of fields.
+ * Arrays are divided into tiles shared by cloned games. A tile of owners,
+ * nodes of fields or parents is copied before the first change if other
+ * game uses it, copies are taken from tiles reserved by reserve_tiles so
+ * changing the board never allocates memory. Tiles of sparse board are
+ * never shared, only parents of nodes are.
+ * Access functions are inline as they are used in every engine loop.
+ * Changes are written to the journal of moves while a move is recorded,
+ * fields changing owner are also reported to the listener of the game.
+ * Expected complexity of every function is O(1)
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+#include "events.h"
+#include "journal.h"
+#include "planes.h"
+
+/** @brief Node of a free field or a field waiting for a new node. */
+#define NO_NODE UINT64_MAX
+
+/** @brief Key of empty slot of sparse board. */
+#define NO_FIELD UINT64_MAX
+
+/** @brief Number of elements of a tile is 2 to the power of TILE_SHIFT. */
+#define TILE_SHIFT 16
+
+/** @brief Number of elements of a full tile. */
+#define TILE_ELEMENTS (1ULL << TILE_SHIFT)
+
+/** @brief Mask giving position of an element in its tile. */
+#define TILE_MASK (TILE_ELEMENTS - 1)
+
+/** @brief Gives element of tiled array for reading.
+ * @param[in] array     - pointer to the array,
+ * @param[in] index     - number of the element,
+ * @param[in] size      - size of single element.
+ * @return Pointer to the element.
+ */
+static inline void* tile_element(tiled_array* array, uint64_t index,
+                                 size_t size) {
+    return (char*)array->data[index >> TILE_SHIFT] + (index & TILE_MASK) * size;
+}
+
+/** @brief Makes the game the only user of the tile.
+ * Tile used by other games is replaced with its copy made in a reserved
+ * tile, see reserve_tiles.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in, out] array - pointer to the array,
+ * @param[in] number    - number of the tile.
+ */
+void own_tile(gamma_t* g, tiled_array* array, uint64_t number);
+
+/** @brief Gives element of tiled array for changing.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in, out] array - pointer to the array,
+ * @param[in] index     - number of the element,
+ * @param[in] size      - size of single element.
+ * @return Pointer to the element.
+ */
+static inline void* writable_element(gamma_t* g, tiled_array* array,
+                                     uint64_t index, size_t size) {
+    uint64_t number = index >> TILE_SHIFT;
+    if (!array->writable[number])
+        own_tile(g, array, number);
+    return (char*)array->data[number] + (index & TILE_MASK) * size;
+}
+
+/** @brief Gives field kept in the slot of sparse board.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] slot      - number of the slot.
+ * @return Number of the field or NO_FIELD.
+ */
+static inline uint64_t slot_key(gamma_t* g, uint64_t slot) {
+    return *(uint64_t*)tile_element(&g->field_keys, slot, sizeof(uint64_t));
+}
+
+/** @brief Finds slot of the field on sparse board.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board.
+ * @return Slot holding the field or empty slot where it would be put.
+ */
+static inline uint64_t field_slot(gamma_t* g, uint64_t board_num) {
+    uint64_t mask = g->slots - 1;
+    uint64_t slot = (board_num * 0x9E3779B97F4A7C15ULL) >> g->slots_shift;
+    uint64_t key;
+    while ((key = slot_key(g, slot)) != board_num && key != NO_FIELD)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/** @brief Finds position of the field in owners and nodes arrays.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board.
+ * @return Number of the field or slot of the field on sparse board.
+ */
+static inline uint64_t field_position(gamma_t* g, uint64_t board_num) {
+    return g->sparse ? field_slot(g, board_num) : board_num;
+}
+
+/** @brief Gives owner of the field.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board.
+ * @return Number of field owner or 0 if field is free.
+ */
+static inline uint32_t get_owner(gamma_t* g, uint64_t board_num) {
+    if (!g->sparse)
+        return *(uint32_t*)tile_element(&g->owners, board_num,
+                                        sizeof(uint32_t));
+    uint64_t slot = field_slot(g, board_num);
+    if (slot_key(g, slot) == NO_FIELD)
+        return 0;
+    return *(uint32_t*)tile_element(&g->owners, slot, sizeof(uint32_t));
+}
+
+/** @brief Gives owners of consecutive fields of dense board.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] board_num - number of the first field,
+ * @param[in, out] count - pointer to number of wanted fields, it is reduced
+ *                        to number of fields lying in the same tile.
+ * @return Pointer to owner of the first field.
+ */
+static inline const uint32_t* owners_run(gamma_t* g, uint64_t board_num,
+                                         uint64_t* count) {
+    uint64_t left = TILE_ELEMENTS - (board_num & TILE_MASK);
+    if (*count > left)
+        *count = left;
+    return tile_element(&g->owners, board_num, sizeof(uint32_t));
+}
+
+/** @brief Sets owner of the field on sparse board.
+ * Adds the field to the table or removes it if it's freed, the table
+ * must have place for the field.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board,
+ * @param[in] owner     - number of a new owner or 0 to free the field.
+ */
+void set_sparse_owner(gamma_t* g, uint64_t board_num, uint32_t owner);
+
+/** @brief Gives find-and-union node of the field.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board.
+ * @return Number of the node or NO_NODE.
+ */
+static inline uint64_t get_node(gamma_t* g, uint64_t board_num) {
+    uint64_t position = field_position(g, board_num);
+    if (g->sparse && slot_key(g, position) == NO_FIELD)
+        return NO_NODE; // free field
+    // NO_NODE is kept as -1 in both widths
+    if (g->wide_indexes)
+        return (uint64_t)*(int64_t*)tile_element(&g->field_nodes, position,
+                                                 sizeof(int64_t));
+    return (uint64_t)(int64_t)*(int32_t*)tile_element(&g->field_nodes,
+                                                      position,
+                                                      sizeof(int32_t));
+}
+
+/** @brief Sets owner of the field.
+ * On sparse board there must be place for the field, see reserve_field.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board,
+ * @param[in] owner     - number of a new owner or 0 to free the field.
+ */
+static inline void set_owner(gamma_t* g, uint64_t board_num, uint32_t owner) {
+    if (g->recording) {
+        // node of freed field is lost on sparse board
+        if (g->sparse && owner == 0)
+            journal_word(g, JOURNAL_NODE, 0, board_num, get_node(g, board_num));
+        journal_word(g, JOURNAL_OWNER, 0, board_num, get_owner(g, board_num));
+    }
+    if (g->planes != NULL)
+        plane_move(g, board_num, get_owner(g, board_num), owner);
+    if (g->listener != NULL)
+        emit_event(g, GAMMA_EVENT_OWNER, owner, board_num,
+                   get_owner(g, board_num));
+    if (g->sparse)
+        set_sparse_owner(g, board_num, owner);
+    else
+        *(uint32_t*)writable_element(g, &g->owners, board_num,
+                                     sizeof(uint32_t)) = owner;
+}
+
+/** @brief Sets find-and-union node of the field.
+ * Field on sparse board must be busy.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board,
+ * @param[in] node      - number of the node or NO_NODE.
+ */
+static inline void set_node(gamma_t* g, uint64_t board_num, uint64_t node) {
+    if (g->recording)
+        journal_word(g, JOURNAL_NODE, 0, board_num, get_node(g, board_num));
+    uint64_t position = field_position(g, board_num);
+    if (g->wide_indexes)
+        *(int64_t*)writable_element(g, &g->field_nodes, position,
+                                    sizeof(int64_t)) = (int64_t)node;
+    else
+        *(int32_t*)writable_element(g, &g->field_nodes, position,
+                                    sizeof(int32_t)) = (int32_t)node;
+}
+
+/** @brief Gives parent of find-and-union node.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] node      - number of the node.
+ * @return Number of parent node or minus number of fields in the area
+ * if the node represents an area.
+ */
+static inline int64_t get_parent(gamma_t* g, uint64_t node) {
+    if (g->wide_indexes)
+        return *(int64_t*)tile_element(&g->nodes, node, sizeof(int64_t));
+    return *(int32_t*)tile_element(&g->nodes, node, sizeof(int32_t));
+}
+
+/** @brief Checks if changing parent of the node would copy a shared tile.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] node      - number of the node.
+ * @return True if other games may use the tile of the node.
+ */
+static inline bool node_shared(gamma_t* g, uint64_t node) {
+    return !g->nodes.writable[node >> TILE_SHIFT];
+}
+
+/** @brief Sets parent of find-and-union node.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] node      - number of the node,
+ * @param[in] parent    - number of parent node or minus number of fields
+ *                        in the area if the node represents an area.
+ */
+static inline void set_parent(gamma_t* g, uint64_t node, int64_t parent) {
+    if (g->recording)
+        journal_word(g, JOURNAL_PARENT, 0, node, get_parent(g, node));
+    if (g->wide_indexes)
+        *(int64_t*)writable_element(g, &g->nodes, node,
+                                    sizeof(int64_t)) = parent;
+    else
+        *(int32_t*)writable_element(g, &g->nodes, node,
+                                    sizeof(int32_t)) = (int32_t)parent;
+}
+
+/** @brief Gives size of single node index on the board.
+ * @param[in] g             - pointer to structure holding game status.
+ * @return Number of bytes.
+ */
+size_t index_size(gamma_t* g);
+
+/** @brief Allocates board storage for a new game.
+ * Every field is free. Expects board size to be set. The board is sparse
+ * if keeping whole board would take too much memory.
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in] nodes         - initial number of find-and-union nodes.
+ * @return False if memory couldn't be allocated.
+ */
+bool init_board(gamma_t* g, uint64_t nodes);
+
+/** @brief Uses arrays of loaded snapshot as board storage.
+ * Tiles of the board point into the snapshot, which is unmapped when the
+ * last of them is released. Expects board size, number of slots and nodes
+ * to be set.
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in] begin         - beginning of the mapped snapshot,
+ * @param[in] size          - size of the mapped snapshot,
+ * @param[in] offsets       - offsets of owners, nodes of fields, keys of
+ *                            slots and parents of nodes.
+ * @return False if memory couldn't be allocated, the board is empty and
+ * the snapshot is unmapped then.
+ */
+bool map_board(gamma_t* g, char* begin, uint64_t size,
+               const uint64_t offsets[4]);
+
+/** @brief Frees board storage.
+ * Tiles used by other games are left to them, snapshot is unmapped when
+ * no tile lies in it.
+ * @param[in, out] g        - pointer to structure holding game status.
+ */
+void free_board(gamma_t* g);
+
+/** @brief Clones board storage.
+ * Tiles of dense board and parents of nodes are shared with the clone,
+ * arrays of sparse board are copied. Complexity O(t) where t stands for
+ * number of tiles, O(s) on sparse board with s slots. Expects other fields
+ * of the clone to be copied already.
+ * @param[in, out] copy     - pointer to structure holding cloned game,
+ * @param[in, out] g        - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated, board of the clone
+ * is empty then.
+ */
+bool clone_board(gamma_t* copy, gamma_t* g);
+
+/** @brief Gives a view of owners of the board.
+ * Like clone_board, but only owners of fields are shared or copied, so
+ * the view can be used only for finding owners and must never be changed.
+ * Complexity O(t) where t stands for number of tiles, O(s) on sparse board
+ * with s slots.
+ * @param[in, out] view     - pointer to structure holding the view,
+ * @param[in, out] g        - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated, board of the view
+ * is empty then.
+ */
+bool view_board(gamma_t* view, gamma_t* g);
+
+/** @brief Reserves tiles for copying shared tiles changed later.
+ * Keeps at most given number of reserved tiles, and not more than there
+ * are shared tiles.
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in] count         - number of tiles the following changes may copy.
+ * @return False if memory couldn't be allocated.
+ */
+bool reserve_tiles(gamma_t* g, uint64_t count);
+
+/** @brief Makes the game the only user of every tile.
+ * Complexity O(t) where t stands for number of shared tiles.
+ * @param[in, out] g        - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated, some tiles can remain
+ * shared then.
+ */
+bool own_board(gamma_t* g);
+
+/** @brief Gives maximal number of find-and-union nodes.
+ * @param[in] g             - pointer to structure holding game status.
+ * @return Number of nodes which can be indexed on this board.
+ */
+uint64_t max_nodes(gamma_t* g);
+
+/** @brief Increases number of find-and-union nodes.
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in] capacity      - new number of nodes, at least current one and
+ *                            at most max_nodes.
+ * @return False if memory couldn't be allocated, nodes don't change then.
+ */
+bool resize_nodes(gamma_t* g, uint64_t capacity);
+
+/** @brief Makes place for one more busy field.
+ * Does nothing unless the board is sparse.
+ * @param[in, out] g        - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated.
+ */
+bool reserve_field(gamma_t* g);
+
+/** @brief Finds next busy field in order of storage.
+ * Visits every busy field once if started with position 0 and the board
+ * doesn't change in the meantime. Complexity of visiting all fields is
+ * O(storage_size).
+ * @param[in] g             - pointer to structure holding game status,
+ * @param[in, out] position - pointer to position in storage, it is moved
+ *                            after the found field,
+ * @param[out] board_num    - pointer to number of the found field.
+ * @return False if there are no more busy fields.
+ */
+bool next_busy_field(gamma_t* g, uint64_t* position, uint64_t* board_num);
+
+/** @brief Gives number of positions visited when looking for busy fields.
+ * @param[in] g             - pointer to structure holding game status.
+ * @return Number of fields on the board or slots on sparse board.
+ */
+uint64_t storage_size(gamma_t* g);
+
+#endif /* BOARD_H */
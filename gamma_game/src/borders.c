@@ -10,6 +10,40 @@
 #include <stdbool.h>
 
 #include "borders.h"
+#include "board.h"
+#include "events.h"
+#include "journal.h"
+
+/** @brief Counts adjacent fields lying on the board.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ * @return Number of those fields.
+ */
+static inline uint32_t neighbour_fields(gamma_t* g, uint32_t x, uint32_t y) {
+    return (x > 0) + (x < g->width - 1) + (y > 0) + (y < g->height - 1);
+}
+
+/** @brief Adds the field to frontier of the player or removes it.
+ * If memory for the field couldn't be allocated the frontier is marked as
+ * incomplete.
+ * @param[in, out] g     - pointer to structure holding game status,
+ * @param[in] player     - number of the player,
+ * @param[in] board_num  - number of the field on the board,
+ * @param[in] add        - if the field is added or removed.
+ */
+static void change_frontier(gamma_t* g, uint32_t player, uint64_t board_num,
+                            bool add) {
+    field_set* frontier = &g->players_array[player].frontier;
+    if (g->recording)
+        journal_word(g, JOURNAL_FRONTIER, player, board_num,
+                     field_set_contains(frontier, board_num));
+    if (add)
+        field_set_add(frontier, board_num);
+    else
+        field_set_remove(frontier, board_num);
+    emit_event(g, GAMMA_EVENT_FRONTIER, player, board_num, add);
+}
 
 uint32_t count_digits(uint32_t number) {
     if (number == 0)
@@ -22,31 +56,33 @@ uint32_t count_digits(uint32_t number) {
     return result;
 }
 
-void find_distinct_neighbours(gamma_t* g, uint32_t x, uint32_t y) {
+void find_distinct_neighbours(gamma_t* g, uint32_t x, uint32_t y,
+                              uint32_t result[4]) {
     uint32_t neighbours[4] = {0, 0, 0, 0}; 
     uint64_t board_num = y * (uint64_t)g->width + x;
+    STAT_ADD(g, STAT_NEIGHBOUR_PROBES, neighbour_fields(g, x, y));
 
     // finds neighbours numbers
     if (x > 0) 
-        neighbours[0] = g->board[board_num - 1].owner_number;
+        neighbours[0] = get_owner(g, board_num - 1);
     if (x < g->width - 1)
-        neighbours[1] = g->board[board_num + 1].owner_number;
+        neighbours[1] = get_owner(g, board_num + 1);
     if (y > 0)
-        neighbours[2] = g->board[board_num - g->width].owner_number;
+        neighbours[2] = get_owner(g, board_num - g->width);
     if (y < g->height - 1)
-        neighbours[3] = g->board[board_num + g->width].owner_number;
+        neighbours[3] = get_owner(g, board_num + g->width);
     int distinct_neighbours = 0;
 
     // takes each neighbour only once
     for (int i = 0; i < 4; i++) {
-        g->neighbours[i] = 0;
+        result[i] = 0;
         if (neighbours[i] != 0) {
             bool distinct = true;
             for (int j = 0; j < i; j++)
                 if (neighbours[i] == neighbours[j])
                     distinct = false;
             if (distinct) {
-                g->neighbours[distinct_neighbours] = neighbours[i];
+                result[distinct_neighbours] = neighbours[i];
                 distinct_neighbours++;
             }
         }
@@ -54,57 +90,68 @@ void find_distinct_neighbours(gamma_t* g, uint32_t x, uint32_t y) {
 }
 
 uint32_t count_neighbours(gamma_t* g, uint32_t player, uint32_t x, uint32_t y) {
-    field* board = g->board;
     uint64_t board_num = y * (uint64_t)g->width + x;
     uint32_t result = 0;
+    STAT_ADD(g, STAT_NEIGHBOUR_PROBES, neighbour_fields(g, x, y));
 
     // for every adjacent field check if player is it's owner
-    if (x > 0 && board[board_num - 1].owner_number == player)
+    if (x > 0 && get_owner(g, board_num - 1) == player)
         result++;
-    if (x < g->width - 1 && board[board_num + 1].owner_number == player)
+    if (x < g->width - 1 && get_owner(g, board_num + 1) == player)
         result++;
-    if (y > 0 && board[board_num - g->width].owner_number == player)
+    if (y > 0 && get_owner(g, board_num - g->width) == player)
         result++;
-    if (y < g->height - 1 && board[board_num + g->width].owner_number == player)
+    if (y < g->height - 1 && get_owner(g, board_num + g->width) == player)
         result++;
     return result;
 }
 
-uint32_t add_new_borders(gamma_t* g, uint32_t x, uint32_t y) {
-    field* board = g->board;
+uint32_t add_new_borders(gamma_t* g, uint32_t x, uint32_t y, bool taken) {
     uint64_t board_num = y * (uint64_t)g->width + x;
-    uint32_t player = board[board_num].owner_number;
+    uint32_t player = get_owner(g, board_num);
+    uint64_t adjacent[4];
     uint32_t result = 0;
+    STAT_ADD(g, STAT_NEIGHBOUR_PROBES, neighbour_fields(g, x, y));
     
     // for every adjecent field check if it is a new free adjacent field
     // or if it was counter already
-    if (x > 0 && board[board_num - 1].owner_number == 0 &&
+    if (x > 0 && get_owner(g, board_num - 1) == 0 &&
         2 > count_neighbours(g, player, x - 1, y))
-        result++;
-    if (x < g->width - 1 && board[board_num + 1].owner_number == 0 &&
+        adjacent[result++] = board_num - 1;
+    if (x < g->width - 1 && get_owner(g, board_num + 1) == 0 &&
         2 > count_neighbours(g, player, x + 1, y))
-        result++;
-    if (y > 0 && board[board_num - g->width].owner_number == 0 &&
+        adjacent[result++] = board_num + 1;
+    if (y > 0 && get_owner(g, board_num - g->width) == 0 &&
         2 > count_neighbours(g, player, x, y - 1))
-        result++;
-    if (y < g->height - 1 && board[board_num + g->width].owner_number == 0 &&
+        adjacent[result++] = board_num - g->width;
+    if (y < g->height - 1 && get_owner(g, board_num + g->width) == 0 &&
         2 > count_neighbours(g, player, x, y + 1))
-        result++;
+        adjacent[result++] = board_num + g->width;
+    for (uint32_t i = 0; i < result; i++)
+        change_frontier(g, player, adjacent[i], taken);
     return result;
 }
 
 void block_borders(gamma_t* g, uint32_t x, uint32_t y) {
-    find_distinct_neighbours(g, x, y);
+    uint32_t neighbours[4];
+    find_distinct_neighbours(g, x, y, neighbours);
     for (int i = 0; i < 4; i++) {
-        if (g->neighbours[i] != 0)
-            g->players_array[g->neighbours[i]].free_borders--;
+        if (neighbours[i] != 0) {
+            g->players_array[neighbours[i]].free_borders--;
+            change_frontier(g, neighbours[i], y * (uint64_t)g->width + x,
+                            false);
+        }
     }
 }
 
 void unblock_borders(gamma_t* g, uint32_t x, uint32_t y) {
-    find_distinct_neighbours(g, x, y);
+    uint32_t neighbours[4];
+    find_distinct_neighbours(g, x, y, neighbours);
     for (int i = 0; i < 4; i++) {
-        if (g->neighbours[i] != 0)
-            g->players_array[g->neighbours[i]].free_borders++;
+        if (neighbours[i] != 0) {
+            g->players_array[neighbours[i]].free_borders++;
+            change_frontier(g, neighbours[i], y * (uint64_t)g->width + x,
+                            true);
+        }
     }
 }
\ No newline at end of file
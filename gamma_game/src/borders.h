@@ -12,6 +12,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "field_set.h"
+#include "gamma.h"
+#include "stats.h"
+
 /** @brief Structure representing player.
  * Holds information about player's status in current moment.
  */
@@ -20,17 +24,20 @@ typedef struct player {
     uint32_t used_areas; ///< how many arreas does the player have.
     uint64_t free_borders; ///< free fields adjacent to player fields.
     uint64_t used_fields; ///< how many fields does the player have.
+    uint64_t golden_targets; ///< foreign adjacent fields safe to take.
+    field_set risky_targets; ///< foreign adjacent fields splitting area.
+    field_set frontier; ///< free fields adjacent to player fields.
 } player_t;
 
-/** @brief Structure representing field on the board.
- * Holds information about field's status in current moment,
- * including its find-and-union dependents.
+/** @brief Structure representing array divided into tiles.
+ * Tiles can be shared by games cloned from one another.
  */
-typedef struct field {
-    uint32_t owner_number; ///< number of field owner or 0 if field is free.
-    int64_t representative; ///< representative field in find-and-union.
-    uint64_t fields_in_area; ///< used only for area representant.
-} field;
+typedef struct tiled_array {
+    void** data; ///< elements of every tile.
+    struct tile** tiles; ///< every tile with number of games using it.
+    bool* writable; ///< if the game is the only user of the tile.
+    uint64_t count; ///< number of tiles.
+} tiled_array;
 
 /** @brief Structure representing game status.
  * Holds board size, game restrictions, game status in current moment.
@@ -41,10 +48,31 @@ typedef struct gamma {
     uint32_t players; ///< maximum number of players in this game.
     uint32_t areas; ///< macimum number of areas for a player.
     uint64_t free_fields; ///< fields not belonging to any player.
-    field *board; ///< data of every field on board.
-    uint32_t* neighbours; ///< supplementary array for players numbers.
+    tiled_array owners; ///< number of owner of every field or 0 if free.
+    tiled_array field_nodes; ///< find-and-union node of every field.
+    bool sparse; ///< if only busy fields are kept.
+    tiled_array field_keys; ///< busy fields in slots of sparse board.
+    uint64_t slots; ///< number of slots of sparse board, power of two.
+    uint32_t slots_shift; ///< shift of hash giving slot of the field.
+    uint64_t busy_slots; ///< number of busy slots of sparse board.
+    tiled_array nodes; ///< parent of every node or minus size of its area.
+    bool wide_indexes; ///< if node indexes are 64-bit instead of 32-bit.
+    uint64_t used_nodes; ///< number of nodes given to fields.
+    uint64_t nodes_capacity; ///< size of nodes array.
+    uint64_t shared_tiles; ///< number of tiles other games may use.
+    struct tile* spare_tiles; ///< tiles reserved for copying shared ones.
+    uint64_t spares; ///< number of reserved tiles.
     player_t *players_array; ///< data of every player.
     uint32_t field_print_size; ///< characters needed to print highest player.
+    struct journal* journal; ///< journal of moves or NULL if it isn't kept.
+    bool recording; ///< if changes of the game are written to the journal.
+    uint64_t* planes; ///< rows of fields of every player or NULL, see planes.h.
+    gamma_listener listener; ///< function receiving events or NULL.
+    void* listener_data; ///< data passed to the listener.
+    struct published* published; ///< state read by observers or NULL.
+#ifdef GAMMA_STATS
+    atomic_uint_fast64_t stats[STAT_COUNTERS]; ///< counters of hot paths.
+#endif
 } gamma_t;
 
 /** @brief Counts number of digits in given number
@@ -54,12 +82,15 @@ typedef struct gamma {
 uint32_t count_digits(uint32_t number);
 
 /** @brief Finds players with fields adjacent to given field.
- * Puts numbers of players with fields adjcent to given into g->neighbours.
- * @param[in, out] g - pointer to structure holding game status,
- * @param[in] x      - horizontal position on board,
- * @param[in] y      - vertical position on board.
+ * Puts numbers of players with fields adjcent to given into neighbours,
+ * remaining places are filled with zeros.
+ * @param[in] g           - pointer to structure holding game status,
+ * @param[in] x           - horizontal position on board,
+ * @param[in] y           - vertical position on board,
+ * @param[out] neighbours - array of four players numbers.
  */
-void find_distinct_neighbours(gamma_t* g, uint32_t x, uint32_t y);
+void find_distinct_neighbours(gamma_t* g, uint32_t x, uint32_t y,
+                              uint32_t neighbours[4]);
 
 /** @brief Count player's fields adjacent to given field.
  * @param[in] g      - pointer to structure holding game status,
@@ -72,15 +103,19 @@ uint32_t count_neighbours(gamma_t* g, uint32_t player, uint32_t x, uint32_t y);
 
 /** @brief Count new free fields adjacent for a player.
  * Counts free fields adjacent to a given one owned by a player, that are not
- * adjacent to any other field of this player.
- * @param[in] g      - pointer to structure holding game status,
+ * adjacent to any other field of this player. Those fields are added to
+ * frontier of the player if the field was just taken, otherwise the field
+ * is about to be freed and they are removed from it.
+ * @param[in, out] g - pointer to structure holding game status,
  * @param[in] x      - horizontal position on board,
- * @param[in] y      - vertical position on board.
+ * @param[in] y      - vertical position on board,
+ * @param[in] taken  - if the field was taken or is going to be freed.
  * @return Number of those fields.
  */
-uint32_t add_new_borders(gamma_t* g, uint32_t x, uint32_t y);
+uint32_t add_new_borders(gamma_t* g, uint32_t x, uint32_t y, bool taken);
 
 /** @brief Reduce number of free adjacent fields after aqcuireing this.
+ * The field is removed from frontiers of adjacent players.
  * @param[in] g      - pointer to structure holding game status,
  * @param[in] x      - horizontal position on board,
  * @param[in] y      - vertical position on board.
@@ -88,6 +123,7 @@ uint32_t add_new_borders(gamma_t* g, uint32_t x, uint32_t y);
 void block_borders(gamma_t* g, uint32_t x, uint32_t y);
 
 /** @brief Increase number of free adjacent fields after freeing this.
+ * The field is added to frontiers of adjacent players.
  * @param[in] g      - pointer to structure holding game status,
  * @param[in] x      - horizontal position on board,
  * @param[in] y      - vertical position on board.
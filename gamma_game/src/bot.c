@@ -0,0 +1,585 @@
+/** @file
+ * Implementation of computer player suggesting moves.
+ * Moves are chosen by Monte-Carlo tree search. Every thread searches its
+ * own clone of the game, applies moves of the tree and of a random game
+ * and takes them back with the journal of moves. Statistics of the tree
+ * are shared atomic counters, a node is expanded by the thread which
+ * first publishes its children.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "borders.h"
+#include "board.h"
+#include "field_set.h"
+#include "gamma.h"
+
+/** @brief Maximal number of children of a node. */
+#define MAX_CHILDREN 64
+
+/** @brief Maximal number of golden moves among children of a node. */
+#define MAX_GOLDEN 8
+
+/** @brief Number of visits of a node after which it gets children. */
+#define EXPAND_VISITS 8
+
+/** @brief Maximal depth of the path from the root. */
+#define MAX_DEPTH 256
+
+/** @brief Number of random fields tried by a player in a random game. */
+#define ROLLOUT_TRIES 16
+
+/** @brief Maximal number of turns of a random game. */
+#define MAX_ROLLOUT 1024
+
+/** @brief Exploration constant of UCT formula. */
+#define EXPLORATION 1.4
+
+/** @brief Reward of the player with the most fields in fixed point. */
+#define REWARD_UNIT (1 << 16)
+
+/** @brief Maximum number of threads searching one tree. */
+#define MAX_BOT_THREADS 256
+
+/** @brief Maximal size of blocks of children of one search in bytes. */
+#define MAX_TREE_BYTES ((uint64_t)64 << 20)
+
+/** @brief Structure representing move of a player.
+ */
+typedef struct bot_move {
+    uint32_t x; ///< horizontal position on board.
+    uint32_t y; ///< vertical position on board.
+    bool golden; ///< if it is a golden move.
+} bot_move;
+
+/** @brief Structure representing node of the search tree.
+ * Reward is the sum of rewards of the player who made the move in random
+ * games played through the node.
+ */
+typedef struct tree_node {
+    bot_move move; ///< move leading to the node.
+    uint32_t mover; ///< player who made the move, 0 for the root.
+    atomic_uint_least64_t visits; ///< number of games through the node.
+    atomic_uint_least64_t reward; ///< sum of rewards of the mover.
+    _Atomic(struct node_block*) children; ///< children or NULL.
+} tree_node;
+
+/** @brief Structure representing children of a node.
+ * Game ends in a node with no children.
+ */
+typedef struct node_block {
+    struct node_block* next; ///< next block allocated by the same thread.
+    uint32_t count; ///< number of children.
+    tree_node nodes[]; ///< children.
+} node_block;
+
+/** @brief Structure representing search shared by threads.
+ */
+typedef struct search {
+    gamma_t* g; ///< searched game, not changed by the search.
+    uint32_t player; ///< player choosing the move.
+    tree_node root; ///< root of the tree.
+    atomic_uint_least64_t tree_bytes; ///< size of allocated node blocks.
+    struct timespec deadline; ///< when the search ends.
+} search;
+
+/** @brief Structure representing thread of the search.
+ */
+typedef struct searcher {
+    search* shared; ///< shared search.
+    gamma_t* g; ///< copy of the game keeping journal of moves.
+    uint64_t random; ///< state of random number generator.
+    node_block* blocks; ///< blocks of children allocated by the thread.
+    tree_node* path[MAX_DEPTH]; ///< nodes visited by current game.
+    uint64_t number; ///< number of the thread.
+    pthread_t thread; ///< the thread.
+} searcher;
+
+/** @brief Gives next random number.
+ * @param[in, out] s    - pointer to the thread of the search.
+ * @return Random 64-bit number.
+ */
+static uint64_t next_random(searcher* s) {
+    // xorshift64*
+    s->random ^= s->random >> 12;
+    s->random ^= s->random << 25;
+    s->random ^= s->random >> 27;
+    return s->random * 0x2545F4914F6CDD1DULL;
+}
+
+/** @brief Checks if player can perform any move.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] player    - number of the player.
+ * @return True if player can perform a move or a golden move.
+ */
+static bool can_move(gamma_t* g, uint32_t player) {
+    return gamma_free_fields(g, player) > 0 ||
+           gamma_golden_possible(g, player);
+}
+
+/** @brief Finds the player moving after given one.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] player    - number of the player who has just moved.
+ * @return Number of next player who can move or 0 if game has ended.
+ */
+static uint32_t next_player(gamma_t* g, uint32_t player) {
+    for (uint32_t passed = 0; passed < g->players; passed++) {
+        player = player % g->players + 1;
+        if (can_move(g, player))
+            return player;
+    }
+    return 0;
+}
+
+/** @brief Checks if field is the first of player's fields around another.
+ * Fields around are checked in the same order for every field.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] player    - number of the player,
+ * @param[in] field     - number of the field surrounded by checked fields,
+ * @param[in] from      - number of player's field next to it.
+ * @return True if no earlier field next to it belongs to the player.
+ */
+static bool first_neighbour(gamma_t* g, uint32_t player, uint64_t field,
+                            uint64_t from) {
+    uint32_t x = field % g->width, y = field / g->width;
+    if (x > 0 && get_owner(g, field - 1) == player)
+        return from == field - 1;
+    if (y < g->height - 1 && get_owner(g, field + g->width) == player)
+        return from == field + g->width;
+    if (x < g->width - 1 && get_owner(g, field + 1) == player)
+        return from == field + 1;
+    return true; // only the field below is left
+}
+
+/** @brief Offers candidate move, keeping uniform sample of offered moves.
+ * @param[in, out] s        - pointer to the thread of the search,
+ * @param[in, out] moves    - array of chosen moves,
+ * @param[in, out] count    - pointer to number of chosen moves,
+ * @param[in, out] offered  - pointer to number of offered moves,
+ * @param[in] capacity      - maximal number of chosen moves,
+ * @param[in] move          - offered move.
+ */
+static void offer(searcher* s, bot_move* moves, uint32_t* count,
+                  uint64_t* offered, uint32_t capacity, bot_move move) {
+    (*offered)++;
+    if (*count < capacity)
+        moves[(*count)++] = move;
+    else {
+        uint64_t place = next_random(s) % *offered;
+        if (place < capacity)
+            moves[place] = move;
+    }
+}
+
+/** @brief Checks if the move is already chosen.
+ * @param[in] moves     - array of chosen moves,
+ * @param[in] count     - number of chosen moves,
+ * @param[in] move      - checked move.
+ * @return True if the move is in the array.
+ */
+static bool chosen(bot_move* moves, uint32_t count, bot_move move) {
+    for (uint32_t i = 0; i < count; i++)
+        if (moves[i].x == move.x && moves[i].y == move.y &&
+            moves[i].golden == move.golden)
+            return true;
+    return false;
+}
+
+/** @brief Finds candidate moves of the player.
+ * Candidates are fields next to player's areas and, if player can create
+ * a new area, random fields of the board. Golden moves are checked
+ * by performing and undoing them. Free fields next to player's areas are
+ * taken from player's frontier, so the board is scanned only for golden
+ * move targets or if the frontier isn't complete.
+ * Complexity O(n) where n stands for storage size of the board.
+ * @param[in, out] s        - pointer to the thread of the search,
+ * @param[in] player        - number of the player,
+ * @param[out] moves        - array of at least MAX_CHILDREN moves.
+ * @return Number of found moves.
+ */
+static uint32_t find_moves(searcher* s, uint32_t player, bot_move* moves) {
+    gamma_t* g = s->g;
+    bool normal = gamma_free_fields(g, player) > 0;
+    bool golden = gamma_golden_possible(g, player);
+    bool new_area = g->players_array[player].used_areas < g->areas;
+    bot_move targets[MAX_CHILDREN];
+    uint32_t count = 0, targets_count = 0;
+    uint64_t offered = 0, targets_offered = 0;
+
+    field_set* frontier = &g->players_array[player].frontier;
+    bool listed = normal && !frontier->incomplete;
+    for (uint64_t i = 0; listed && i < frontier->capacity; i++)
+        if (frontier->slots[i] != FIELD_SET_EMPTY)
+            offer(s, moves, &count, &offered, MAX_CHILDREN - MAX_GOLDEN,
+                  (bot_move){frontier->slots[i] % g->width,
+                             frontier->slots[i] / g->width, false});
+
+    uint64_t position = 0, board_num;
+    while ((golden || (normal && !listed)) &&
+           next_busy_field(g, &position, &board_num)) {
+        if (get_owner(g, board_num) != player)
+            continue;
+        uint32_t x = board_num % g->width, y = board_num / g->width;
+        uint64_t around[4];
+        int around_number = 0;
+        if (x > 0)
+            around[around_number++] = board_num - 1;
+        if (x < g->width - 1)
+            around[around_number++] = board_num + 1;
+        if (y > 0)
+            around[around_number++] = board_num - g->width;
+        if (y < g->height - 1)
+            around[around_number++] = board_num + g->width;
+        for (int i = 0; i < around_number; i++) {
+            uint32_t owner = get_owner(g, around[i]);
+            if (owner == player || !first_neighbour(g, player, around[i],
+                                                    board_num))
+                continue; // field is offered once
+            bot_move move = {around[i] % g->width, around[i] / g->width,
+                             owner != 0};
+            if (owner == 0 && normal && !listed)
+                offer(s, moves, &count, &offered, MAX_CHILDREN - MAX_GOLDEN,
+                      move);
+            else if (owner != 0 && golden)
+                offer(s, targets, &targets_count, &targets_offered,
+                      MAX_CHILDREN, move);
+        }
+    }
+    for (uint32_t i = 0; new_area && i < MAX_CHILDREN; i++) {
+        uint32_t x = next_random(s) % g->width, y = next_random(s) % g->height;
+        uint32_t owner = get_owner(g, y * (uint64_t)g->width + x);
+        bot_move move = {x, y, owner != 0};
+        if (owner == player || (owner == 0 && !normal) ||
+            (owner != 0 && !golden))
+            continue;
+        if (owner == 0 && count < MAX_CHILDREN - MAX_GOLDEN &&
+            !chosen(moves, count, move))
+            moves[count++] = move;
+        if (owner != 0 && targets_count < MAX_CHILDREN &&
+            !chosen(targets, targets_count, move))
+            targets[targets_count++] = move;
+    }
+
+    if (count == 0 && normal && !g->sparse) {
+        // no random field was free, every free field is offered
+        uint64_t board_size = g->width * (uint64_t)g->height;
+        for (board_num = 0; board_num < board_size; board_num++)
+            if (get_owner(g, board_num) == 0)
+                offer(s, moves, &count, &offered, MAX_CHILDREN - MAX_GOLDEN,
+                      (bot_move){board_num % g->width, board_num / g->width,
+                                 false});
+    }
+
+    uint32_t golden_count = 0;
+    for (uint32_t i = 0; i < targets_count && golden_count < MAX_GOLDEN; i++) {
+        if (gamma_golden_move(g, player, targets[i].x, targets[i].y)) {
+            gamma_undo(g);
+            moves[count++] = targets[i];
+            golden_count++;
+        }
+    }
+    return count;
+}
+
+/** @brief Gives the node its children.
+ * Children published by other thread first are used instead. When blocks
+ * of the search reach MAX_TREE_BYTES the tree stops growing, its leaves
+ * are then only played through by random games.
+ * @param[in, out] s    - pointer to the thread of the search,
+ * @param[in, out] node - pointer to expanded node.
+ * @return Children of the node or NULL if memory couldn't be allocated
+ * or the tree is too large.
+ */
+static node_block* expand(searcher* s, tree_node* node) {
+    atomic_uint_least64_t* tree_bytes = &s->shared->tree_bytes;
+    if (atomic_load(tree_bytes) >= MAX_TREE_BYTES)
+        return NULL; // node budget is spent, moves aren't searched
+    uint32_t player = node->mover == 0 ? s->shared->player :
+                                         next_player(s->g, node->mover);
+    bot_move moves[MAX_CHILDREN];
+    uint32_t count = player == 0 ? 0 : find_moves(s, player, moves);
+    size_t size = sizeof(node_block) + count * sizeof(tree_node);
+    if (atomic_fetch_add(tree_bytes, size) + size > MAX_TREE_BYTES) {
+        atomic_fetch_sub(tree_bytes, size);
+        return NULL; // other threads spent the budget meanwhile
+    }
+    node_block* block = malloc(size);
+    if (block == NULL) {
+        atomic_fetch_sub(tree_bytes, size);
+        return NULL; // failed to allocate memory
+    }
+    block->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        tree_node* child = &block->nodes[i];
+        child->move = moves[i];
+        child->mover = player;
+        atomic_init(&child->visits, 0);
+        atomic_init(&child->reward, 0);
+        atomic_init(&child->children, NULL);
+    }
+    node_block* expected = NULL;
+    if (!atomic_compare_exchange_strong(&node->children, &expected, block)) {
+        free(block);
+        atomic_fetch_sub(tree_bytes, size);
+        return expected; // other thread was first
+    }
+    block->next = s->blocks;
+    s->blocks = block;
+    return block;
+}
+
+/** @brief Chooses child of the node by UCT formula.
+ * Visits of games still being played count as lost games, so threads
+ * choose different paths.
+ * @param[in] block     - children of the node,
+ * @param[in] visits    - number of visits of the node.
+ * @return Pointer to chosen child.
+ */
+static tree_node* choose_child(node_block* block, uint64_t visits) {
+    double log_visits = log((double)visits + 1);
+    tree_node* best = &block->nodes[0];
+    double best_value = -1;
+    for (uint32_t i = 0; i < block->count; i++) {
+        tree_node* child = &block->nodes[i];
+        uint64_t child_visits = atomic_load(&child->visits);
+        if (child_visits == 0)
+            return child; // every child is tried first
+        double mean = (double)atomic_load(&child->reward) /
+                      ((double)child_visits * REWARD_UNIT);
+        double value = mean + EXPLORATION * sqrt(log_visits / child_visits);
+        if (value > best_value) {
+            best_value = value;
+            best = child;
+        }
+    }
+    return best;
+}
+
+/** @brief Performs the move.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] player    - number of the player,
+ * @param[in] move      - performed move.
+ * @return True if the move was performed.
+ */
+static bool perform(gamma_t* g, uint32_t player, bot_move move) {
+    if (move.golden)
+        return gamma_golden_move(g, player, move.x, move.y);
+    return gamma_move(g, player, move.x, move.y);
+}
+
+/** @brief Performs random move of the player if it finds one.
+ * @param[in, out] s    - pointer to the thread of the search,
+ * @param[in] player    - number of the player.
+ * @return True if a move was performed.
+ */
+static bool random_move(searcher* s, uint32_t player) {
+    gamma_t* g = s->g;
+    for (int i = 0; i < ROLLOUT_TRIES; i++) {
+        uint32_t x = next_random(s) % g->width, y = next_random(s) % g->height;
+        uint32_t owner = get_owner(g, y * (uint64_t)g->width + x);
+        // golden moves are rare, as every player has just one
+        bot_move move = {x, y, owner != 0 && owner != player &&
+                               next_random(s) % 8 == 0};
+        if ((owner == 0 || move.golden) && perform(g, player, move))
+            return true;
+    }
+    return false;
+}
+
+/** @brief Plays random game until nobody finds a move.
+ * @param[in, out] s    - pointer to the thread of the search,
+ * @param[in] player    - number of the player moving first.
+ * @return Number of performed moves.
+ */
+static uint64_t play_random(searcher* s, uint32_t player) {
+    uint64_t moves = 0;
+    uint32_t passed = 0;
+    for (int turn = 0; turn < MAX_ROLLOUT && passed < s->g->players; turn++) {
+        if (random_move(s, player)) {
+            moves++;
+            passed = 0;
+        }
+        else
+            passed++;
+        player = player % s->g->players + 1;
+    }
+    return moves;
+}
+
+/** @brief Plays one game from the root and updates the tree.
+ * Game goes down the tree, then is played randomly. Every node on the path
+ * gets reward of its mover: share of fields compared to the best player.
+ * All moves are undone afterwards.
+ * @param[in, out] s    - pointer to the thread of the search.
+ */
+static void play_game(searcher* s) {
+    gamma_t* g = s->g;
+    tree_node* node = &s->shared->root;
+    uint32_t depth = 0;
+    uint64_t moves = 0;
+    while (true) {
+        s->path[depth++] = node;
+        uint64_t visits = atomic_fetch_add(&node->visits, 1);
+        node_block* block = atomic_load(&node->children);
+        if (block == NULL && (node->mover == 0 || visits >= EXPAND_VISITS))
+            block = expand(s, node);
+        if (block == NULL || block->count == 0 || depth == MAX_DEPTH)
+            break; // leaf or end of the game
+        tree_node* child = choose_child(block, visits);
+        if (!perform(g, child->mover, child->move))
+            break; // can't happen, position is the same in every game
+        node = child;
+        moves++;
+    }
+    moves += play_random(s, node->mover == 0 ? s->shared->player :
+                                               node->mover % g->players + 1);
+
+    uint64_t best = 0;
+    for (uint64_t i = 1; i <= g->players; i++)
+        if (g->players_array[i].used_fields > best)
+            best = g->players_array[i].used_fields;
+    for (uint32_t i = 1; i < depth; i++) {
+        uint64_t fields = g->players_array[s->path[i]->mover].used_fields;
+        if (best > 0)
+            atomic_fetch_add(&s->path[i]->reward, fields * REWARD_UNIT / best);
+    }
+    for (uint64_t i = 0; i < moves; i++)
+        gamma_undo(g);
+}
+
+/** @brief Checks if time of the search has passed.
+ * @param[in] shared    - pointer to the search.
+ * @return True if the search should end.
+ */
+static bool time_passed(search* shared) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > shared->deadline.tv_sec ||
+           (now.tv_sec == shared->deadline.tv_sec &&
+            now.tv_nsec >= shared->deadline.tv_nsec);
+}
+
+/** @brief Prepares thread of the search.
+ * @param[out] s        - pointer to the thread of the search,
+ * @param[in] shared    - pointer to the search,
+ * @param[in] number    - number of the thread.
+ * @return False if memory couldn't be allocated.
+ */
+static bool start_searcher(searcher* s, search* shared, uint64_t number) {
+    s->shared = shared;
+    s->number = number;
+    s->random = 0x9E3779B97F4A7C15ULL * (number + 1);
+    s->blocks = NULL;
+    s->g = gamma_clone(shared->g);
+    if (s->g != NULL && gamma_journal(s->g, true))
+        return true;
+    gamma_delete(s->g);
+    s->g = NULL;
+    return false; // failed to allocate memory
+}
+
+/** @brief Plays games until time of the search passes.
+ * @param[in, out] data - pointer to the thread of the search.
+ * @return NULL.
+ */
+static void* run_searcher(void* data) {
+    searcher* s = data;
+    do {
+        play_game(s);
+    } while (!time_passed(s->shared));
+    return NULL;
+}
+
+/** @brief Frees thread of the search.
+ * @param[in, out] s    - pointer to the thread of the search.
+ */
+static void finish_searcher(searcher* s) {
+    while (s->blocks != NULL) {
+        node_block* next = s->blocks->next;
+        free(s->blocks);
+        s->blocks = next;
+    }
+    gamma_delete(s->g);
+}
+
+/** @brief Chooses number of threads of the search.
+ * @param[in] threads   - requested number of threads, 0 for every processor.
+ * @return Number of threads, at least one.
+ */
+static size_t threads_number(unsigned threads) {
+    size_t result = threads;
+    if (result == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        result = processors > 0 ? processors : 1;
+    }
+    return result > MAX_BOT_THREADS ? MAX_BOT_THREADS : result;
+}
+
+bool gamma_suggest_move(gamma_t *g, uint32_t player, uint64_t milliseconds,
+                        unsigned threads, uint32_t *x, uint32_t *y,
+                        bool *golden) {
+    if (g == NULL || player < 1 || g->players < player || x == NULL ||
+        y == NULL || golden == NULL)
+        return false; // incorrect parameter
+
+    search shared = {.g = g, .player = player};
+    atomic_init(&shared.root.visits, 0);
+    atomic_init(&shared.root.reward, 0);
+    atomic_init(&shared.root.children, NULL);
+    atomic_init(&shared.tree_bytes, 0);
+    clock_gettime(CLOCK_MONOTONIC, &shared.deadline);
+    shared.deadline.tv_sec += milliseconds / 1000;
+    shared.deadline.tv_nsec += milliseconds % 1000 * 1000000;
+    if (shared.deadline.tv_nsec >= 1000000000) {
+        shared.deadline.tv_sec++;
+        shared.deadline.tv_nsec -= 1000000000;
+    }
+    size_t count = threads_number(threads), started = 1;
+    searcher* searchers = malloc(count * sizeof(searcher));
+    if (searchers == NULL || !start_searcher(&searchers[0], &shared, 0)) {
+        free(searchers);
+        return false; // failed to allocate memory
+    }
+
+    // children of the root are the same for every thread
+    node_block* moves = expand(&searchers[0], &shared.root);
+    bool found = moves != NULL && moves->count > 0;
+    if (found && moves->count > 1) {
+        // the game is cloned before threads start, as cloning changes it
+        for (; started < count; started++) {
+            searcher* s = &searchers[started];
+            if (!start_searcher(s, &shared, started))
+                break; // fewer threads search the tree
+            if (pthread_create(&s->thread, NULL, run_searcher, s) != 0) {
+                finish_searcher(s);
+                break;
+            }
+        }
+        run_searcher(&searchers[0]);
+        for (size_t i = 1; i < started; i++)
+            pthread_join(searchers[i].thread, NULL);
+    }
+    if (found) {
+        tree_node* best = &moves->nodes[0];
+        for (uint32_t i = 1; i < moves->count; i++)
+            if (atomic_load(&moves->nodes[i].visits) >
+                atomic_load(&best->visits))
+                best = &moves->nodes[i];
+        *x = best->move.x;
+        *y = best->move.y;
+        *golden = best->move.golden;
+    }
+    for (size_t i = 0; i < started; i++)
+        finish_searcher(&searchers[i]);
+    free(searchers);
+    return found;
+}
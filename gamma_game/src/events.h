@@ -0,0 +1,36 @@
+/** @file
+ * Interface of reporting changes of the game to its listener.
+ * Events are reported where the engine changes words of the game, also
+ * while the journal applies its entries, so undone changes are reported as
+ * well and applying every event keeps a copy of the state up to date.
+ * Complexity of every function is O(1) besides work of the listener.
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+#include "gamma.h"
+
+/** @brief Reports a change of the game to its listener.
+ * Does nothing if the game has no listener.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] kind      - kind of the event, see gamma_event_kind,
+ * @param[in] player    - number of the player,
+ * @param[in] board_num - number of the field on the board,
+ * @param[in] value     - value depending on the kind.
+ */
+static inline void emit_event(gamma_t* g, uint8_t kind, uint32_t player,
+                              uint64_t board_num, uint64_t value) {
+    if (g->listener != NULL) {
+        gamma_event event = {kind, player, board_num, value};
+        g->listener(g->listener_data, &event);
+    }
+}
+
+#endif /* EVENTS_H */
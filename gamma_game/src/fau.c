@@ -1,5 +1,8 @@
 /** @file
  * Functions for dealing with fields owners on find-and-union level.
+ * Every field belonging to a player has its own node in find-and-union.
+ * Node of a freed field is not reused till nodes are compacted, so it still
+ * leads other nodes of its area to the area representative.
  */
 
 #include <stdio.h>
@@ -8,170 +11,570 @@
 #include <stdbool.h>
 
 #include "borders.h"
+#include "board.h"
+#include "events.h"
+#include "field_set.h"
 #include "fau.h"
+#include "golden.h"
+#include "planes.h"
+
+/** @brief Structure representing search through the area.
+ * Holds fields visited by bfs started from single field.
+ */
+typedef struct area_search {
+    uint64_t* fields; ///< visited fields in order of visiting.
+    uint64_t visited; ///< number of visited fields.
+    uint64_t expanded; ///< number of visited fields with checked neighbours.
+    uint64_t capacity; ///< size of fields array.
+    field_set members; ///< set of visited fields.
+    uint32_t group; ///< search representing group of connected searches.
+} area_search;
 
 /** @brief Finds the main representative in the area in find-and-union.
- * Recursive function with complexity O(log n) where n is the number
- * of fields in the area. 
- * @param[in] board        - pointer to an array of fields,
- * @param[in] field_number - number of an inspected field on a board.
- * @return Number of the field representing given area in find-and-union
+ * Iterative function which halves the path on its way, every visited node
+ * gets its grandparent as a new parent. Amortized complexity O(α(n))
+ * where n is the number of fields in the area.
+ * @param[in, out] g      - pointer to structure holding game status,
+ * @param[in] node_number - number of an inspected node.
+ * @return Number of the node representing given area in find-and-union
  */
-static uint64_t main_representative(field* board, uint64_t field_number) {
-    uint64_t representative_number = board[field_number].representative;
-    if (representative_number == field_number)
-        return field_number;
-    else
-        return(main_representative(board, representative_number));
+static uint64_t main_representative(gamma_t* g, uint64_t node_number) {
+    STAT_ADD(g, STAT_FINDS, 1);
+    int64_t parent = get_parent(g, node_number);
+    while (parent >= 0) {
+        STAT_ADD(g, STAT_FIND_STEPS, 1);
+        int64_t grandparent = get_parent(g, parent);
+        if (grandparent < 0)
+            return parent; // parent represents the area
+        if (!node_shared(g, node_number)) // tile isn't copied for this
+            set_parent(g, node_number, grandparent);
+        node_number = grandparent;
+        parent = get_parent(g, node_number);
+    }
+    return node_number;
 }
 
 /** @brief Join two areas in find-and-union report if succesful.
- * Finds main representatives of both areas then joins them if possible.
- * Complexity O(log n) where n stands for number of fields in joined areas.
- * @param[in] board  - pointer to an array of fields,
+ * Finds main representatives of both areas then joins them if possible,
+ * the smaller area is attached to the larger one.
+ * Amortized complexity O(α(n)) where n stands for number of fields
+ * in joined areas.
+ * @param[in, out] g - pointer to structure holding game status,
  * @param[in] field1 - number of the first field on the board,
  * @param[in] field2 - number of the second field on the board.
  * @return True if two areas where succesfully joind.
  */
-static bool join_areas(field* board, uint64_t field1, uint64_t field2) {
-    if (board[field1].owner_number == 0 || board[field2].owner_number == 0)
+static bool join_areas(gamma_t* g, uint64_t field1, uint64_t field2) {
+    uint32_t owner1 = get_owner(g, field1), owner2 = get_owner(g, field2);
+    if (owner1 == 0 || owner2 == 0)
         return false; // free fields
-    if (board[field1].owner_number != board[field2].owner_number)
+    if (owner1 != owner2)
         return false; // diffrent owners
-    field1 = main_representative(board, field1);
-    field2 = main_representative(board, field2);
-    if (field1 == field2)
+    uint64_t node1 = main_representative(g, get_node(g, field1));
+    uint64_t node2 = main_representative(g, get_node(g, field2));
+    if (node1 == node2)
         return false; // already in the same area
 
-    if (board[field1].fields_in_area > board[field2].fields_in_area) {
-        board[field2].representative = field1;
-        board[field1].fields_in_area += board[field2].fields_in_area;
+    // representatives hold minus sizes of their areas
+    int64_t size1 = get_parent(g, node1), size2 = get_parent(g, node2);
+    if (size1 < size2) {
+        set_parent(g, node2, node1);
+        set_parent(g, node1, size1 + size2);
     }
     else {
-        board[field1].representative = field2;
-        board[field2].fields_in_area += board[field1].fields_in_area;
+        set_parent(g, node1, node2);
+        set_parent(g, node2, size1 + size2);
     }
     return true;
 }
 
-/** @brief Sets field when acquired by a player.
- * Changes field's owner and sets default data neede by find-and-union,
- * Complexity O(1).
- * @param[in] board     - pointer to an array of fields,
- * @param[in] board_num - number of the field on the board,
- * @param[in] player    - number of the player acquiring the field.
+/** @brief Gives a field new node in find-and-union.
+ * Assumes there is unused node.
+ * @param[in, out] g         - pointer to structure holding game status,
+ * @param[in] board_num      - number of the field on the board,
+ * @param[in] representative - node representing field's area, new node
+ *                             represents a new area if it is NO_NODE or
+ *                             number of the new node.
+ * @return Number of the new node.
  */
-static void new_field(field* board, uint64_t board_num, uint32_t player) {
-    board[board_num].owner_number = player;
-    board[board_num].representative = board_num;
-    board[board_num].fields_in_area = 1;
+static uint64_t new_node(gamma_t* g, uint64_t board_num,
+                         uint64_t representative) {
+    uint64_t node_number = g->used_nodes++;
+    set_node(g, board_num, node_number);
+    if (representative == NO_NODE || representative == node_number) {
+        set_parent(g, node_number, -1);
+    }
+    else {
+        set_parent(g, node_number, representative);
+        set_parent(g, representative, get_parent(g, representative) - 1);
+    }
+    return node_number;
+}
 
+/** @brief Gives field waiting for a new node the next node of the area.
+ * Until the field's neighbours are queued, instead of its parent the node
+ * holds number of its field, so new nodes of the area serve as bfs queue.
+ * @param[in, out] g     - pointer to structure holding game status,
+ * @param[in] board_num  - number of the field on the board.
+ */
+static void queue_field(gamma_t* g, uint64_t board_num) {
+    uint64_t node_number = g->used_nodes++;
+    set_node(g, board_num, node_number);
+    set_parent(g, node_number, board_num);
 }
 
-void place(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
-    field* board = g->board;
+/** @brief Gives every field in the area new node.
+ * Bfs function that goes throw whole area, assuming that fields of the area
+ * are waiting for new nodes. Uses no memory besides the nodes, so it can't
+ * fail and doesn't depend on the shape of the area.
+ * Complexity O(n) where n stands for number of fields in the area.
+ * @param[in, out] g     - pointer to structure holding game status,
+ * @param[in] board_num  - number of some field of the area on the board.
+ */
+static void set_representative(gamma_t* g, uint64_t board_num) {
+    uint32_t my_owner = get_owner(g, board_num);
+    uint64_t root = g->used_nodes;
+    uint64_t next = root;
+    queue_field(g, board_num);
+
+    while (next < g->used_nodes) {
+        board_num = get_parent(g, next);
+        set_parent(g, next++, root);
+        uint32_t x = board_num % g->width, y = board_num / g->width;
+        // queue every adjacent field with the same owner
+        if (x > 0 && get_owner(g, board_num - 1) == my_owner &&
+            get_node(g, board_num - 1) == NO_NODE)
+            queue_field(g, board_num - 1);
+        if (x < g->width - 1 && get_owner(g, board_num + 1) == my_owner &&
+            get_node(g, board_num + 1) == NO_NODE)
+            queue_field(g, board_num + 1);
+        if (y > 0 && get_owner(g, board_num - g->width) == my_owner &&
+            get_node(g, board_num - g->width) == NO_NODE)
+            queue_field(g, board_num - g->width);
+        if (y < g->height - 1 &&
+            get_owner(g, board_num + g->width) == my_owner &&
+            get_node(g, board_num + g->width) == NO_NODE)
+            queue_field(g, board_num + g->width);
+    }
+    set_parent(g, root, -(int64_t)(g->used_nodes - root));
+    STAT_ADD(g, STAT_AREA_FIELDS, g->used_nodes - root);
+}
+
+/** @brief Builds find-and-union from scratch using as few nodes as possible.
+ * Frees nodes of freed fields.
+ * Complexity O(n) where n stands for storage size of the board.
+ * @param[in, out] g - pointer to structure holding game status.
+ */
+static void compact_nodes(gamma_t* g) {
+    uint64_t position = 0, board_num;
+    while (next_busy_field(g, &position, &board_num))
+        set_node(g, board_num, NO_NODE);
+    g->used_nodes = 0;
+
+    // first field of every area gets the node representing the area
+    position = 0;
+    while (next_busy_field(g, &position, &board_num))
+        if (get_node(g, board_num) == NO_NODE)
+            set_representative(g, board_num);
+}
+
+/** @brief Makes place for given number of new nodes if it is reasonable.
+ * Allocates more nodes only if there are few nodes of freed fields
+ * compared to the storage size. Otherwise nodes should be compacted.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] needed - number of needed nodes.
+ * @return True if there are enough unused nodes.
+ */
+static bool reserve_nodes(gamma_t* g, uint64_t needed) {
+    if (g->nodes_capacity - g->used_nodes >= needed)
+        return true;
+    uint64_t busy_fields = g->width * (uint64_t)g->height - g->free_fields;
+    // compacting shared board would copy every tile
+    if (g->shared_tiles == 0 &&
+        8 * (g->used_nodes - busy_fields) >= storage_size(g) &&
+        busy_fields + needed <= g->nodes_capacity)
+        return false; // compacting nodes would pay off
+
+    uint64_t capacity = g->nodes_capacity + g->nodes_capacity / 2 + 1;
+    if (capacity < g->used_nodes + needed)
+        capacity = g->used_nodes + needed;
+    if (capacity > max_nodes(g))
+        capacity = max_nodes(g);
+    if (capacity < g->used_nodes + needed)
+        return false; // can't index more nodes
+    return resize_nodes(g, capacity);
+}
+
+bool place(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
+    if (!reserve_field(g))
+        return false; // failed to allocate memory
+    if (!reserve_nodes(g, 1)) {
+        if (g->used_nodes == g->width * (uint64_t)g->height - g->free_fields)
+            return false; // every node is used by some field
+        if (!own_board(g))
+            return false; // failed to allocate memory
+        compact_nodes(g);
+    }
     uint64_t board_num = y * (uint64_t)g->width + x;
-    new_field(board, board_num, player);
+    set_owner(g, board_num, player);
+    new_node(g, board_num, NO_NODE);
     uint32_t reduced_areas = 0;
     
     // joins with evry adjacent field  
     if (x > 0)
-        reduced_areas += join_areas(board, board_num, board_num - 1);
+        reduced_areas += join_areas(g, board_num, board_num - 1);
     if (x < g->width - 1)
-        reduced_areas += join_areas(board, board_num, board_num + 1);
+        reduced_areas += join_areas(g, board_num, board_num + 1);
     if (y > 0)
-        reduced_areas += join_areas(board, board_num, board_num - g->width);
+        reduced_areas += join_areas(g, board_num, board_num - g->width);
     if (y < g->height - 1)
-        reduced_areas += join_areas(board, board_num, board_num + g->width);
+        reduced_areas += join_areas(g, board_num, board_num + g->width);
     g->players_array[player].used_areas += (1 - reduced_areas);
+    if (reduced_areas != 1)
+        emit_event(g, GAMMA_EVENT_AREAS, player, board_num,
+                   g->players_array[player].used_areas);
+    return true;
 }
 
-/** @brief Changes representative in whole area to given value.
- * Recursive dfs function that goes throw whole area, assuming that whole
- * find and union set was disjoind and needs to be joind again.
- * Complexity O(n) where n stands for number of fields in the area.
- * @param[in, out] g - pointer to structure holding game status,
+/** @brief Finds search representing group of given search.
+ * @param[in] searches - array of searches,
+ * @param[in] number   - number of given search.
+ * @return Number of search representing the group.
+ */
+static uint32_t search_group(area_search* searches, uint32_t number) {
+    while (searches[number].group != number)
+        number = searches[number].group;
+    return number;
+}
+
+/** @brief Adds field to the search.
+ * @param[in, out] search  - pointer to the search,
+ * @param[in] board_num    - number of the field on the board.
+ * @return False if memory couldn't be allocated.
+ */
+static bool visit(area_search* search, uint64_t board_num) {
+    if (search->visited == search->capacity) {
+        uint64_t capacity = search->capacity ? 2 * search->capacity : 16;
+        uint64_t* fields = realloc(search->fields, sizeof(uint64_t) * capacity);
+        if (fields == NULL)
+            return false; // failed to allocate memory
+        search->fields = fields;
+        search->capacity = capacity;
+    }
+    if (!field_set_add(&search->members, board_num))
+        return false; // failed to allocate memory
+    search->fields[search->visited++] = board_num;
+    return true;
+}
+
+/** @brief Checks neighbours of the next field visited by the search.
+ * Visits player's neighbours not visited by any search yet and joins
+ * groups of searches which have visited other neighbours.
+ * @param[in] g              - pointer to structure holding game status,
+ * @param[in] player         - owner of the area,
+ * @param[in] freed          - number of freed field on the board,
+ * @param[in, out] searches  - array of searches,
+ * @param[in] count          - number of searches,
+ * @param[in] number         - number of expanded search.
+ * @return False if memory couldn't be allocated.
+ */
+static bool expand(gamma_t* g, uint32_t player, uint64_t freed,
+                   area_search* searches, uint32_t count, uint32_t number) {
+    area_search* search = &searches[number];
+    uint64_t board_num = search->fields[search->expanded++];
+    uint32_t x = board_num % g->width, y = board_num / g->width;
+    uint64_t neighbours[4];
+    int neighbours_number = 0;
+    if (x > 0)
+        neighbours[neighbours_number++] = board_num - 1;
+    if (x < g->width - 1)
+        neighbours[neighbours_number++] = board_num + 1;
+    if (y > 0)
+        neighbours[neighbours_number++] = board_num - g->width;
+    if (y < g->height - 1)
+        neighbours[neighbours_number++] = board_num + g->width;
+
+    for (int i = 0; i < neighbours_number; i++) {
+        uint64_t neighbour = neighbours[i];
+        if (neighbour == freed || get_owner(g, neighbour) != player)
+            continue; // not part of the area
+        bool seen = false;
+        for (uint32_t j = 0; j < count && !seen; j++) {
+            if (field_set_contains(&searches[j].members, neighbour)) {
+                seen = true;
+                // searches met so they are in the same area
+                uint32_t group1 = search_group(searches, number);
+                uint32_t group2 = search_group(searches, j);
+                searches[group2].group = group1;
+            }
+        }
+        if (!seen && !visit(search, neighbour))
+            return false; // failed to allocate memory
+    }
+    return true;
+}
+
+/** @brief Checks if every search from the group has visited whole area.
+ * @param[in] searches - array of searches,
+ * @param[in] count    - number of searches,
+ * @param[in] group    - number of search representing the group.
+ * @return True if no search from the group has fields to expand.
+ */
+static bool group_finished(area_search* searches, uint32_t count,
+                           uint32_t group) {
+    for (uint32_t i = 0; i < count; i++)
+        if (search_group(searches, i) == group &&
+            searches[i].expanded < searches[i].visited)
+            return false;
+    return true;
+}
+
+/** @brief Counts groups of searches which haven't visited whole area.
+ * @param[in] searches - array of searches,
+ * @param[in] count    - number of searches.
+ * @return Number of those groups.
+ */
+static uint32_t unfinished_groups(area_search* searches, uint32_t count) {
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < count; i++)
+        if (searches[i].group == i && !group_finished(searches, count, i))
+            result++;
+    return result;
+}
+
+/** @brief Searches areas of player's fields adjacent to freed field.
+ * Runs parallel bfs from every player's field adjacent to freed one.
+ * Searches join in groups when they meet. Stops when at most one group
+ * hasn't visited its whole area, so the cost is proportional to the size
+ * of all areas but the largest one.
+ * @param[in] g              - pointer to structure holding game status,
+ * @param[in] player         - owner of the area,
+ * @param[in] x              - horizontal position of freed field on board,
+ * @param[in] y              - vertical position of freed field on board,
+ * @param[out] searches      - array of four searches,
+ * @param[out] count_ptr     - pointer to number of started searches.
+ * @return False if memory couldn't be allocated.
+ */
+static bool search_areas(gamma_t* g, uint32_t player, uint32_t x, uint32_t y,
+                         area_search* searches, uint32_t* count_ptr) {
+    uint64_t freed = y * (uint64_t)g->width + x;
+    uint32_t count = 0;
+    for (int i = 0; i < 4; i++)
+        searches[i] = (area_search){NULL, 0, 0, 0, {NULL, 0, 0, false}, i};
+
+    bool memory = true;
+    if (x > 0 && get_owner(g, freed - 1) == player)
+        memory &= visit(&searches[count++], freed - 1);
+    if (x < g->width - 1 && get_owner(g, freed + 1) == player)
+        memory &= visit(&searches[count++], freed + 1);
+    if (y > 0 && get_owner(g, freed - g->width) == player)
+        memory &= visit(&searches[count++], freed - g->width);
+    if (y < g->height - 1 && get_owner(g, freed + g->width) == player)
+        memory &= visit(&searches[count++], freed + g->width);
+    *count_ptr = count;
+
+    while (memory && unfinished_groups(searches, count) > 1) {
+        // every search makes one step so none of them goes far ahead
+        for (uint32_t i = 0; i < count && memory; i++)
+            if (searches[i].expanded < searches[i].visited)
+                memory = expand(g, player, freed, searches, count, i);
+    }
+    return memory;
+}
+
+/** @brief Frees memory used by searches.
+ * @param[in, out] searches - array of searches,
+ * @param[in] count         - number of searches.
+ */
+static void free_searches(area_search* searches, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        free(searches[i].fields);
+        field_set_clear(&searches[i].members);
+    }
+}
+
+/** @brief Counts groups of searches.
+ * @param[in] searches - array of searches,
+ * @param[in] count    - number of searches.
+ * @return Number of those groups.
+ */
+static uint32_t count_groups(area_search* searches, uint32_t count) {
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < count; i++)
+        if (searches[i].group == i)
+            result++;
+    return result;
+}
+
+/** @brief Finds group of searches which should keep area representative.
+ * That is the group which hasn't visited whole area or the largest one.
+ * @param[in] searches - array of searches,
+ * @param[in] count    - number of searches.
+ * @return Number of search representing this group.
+ */
+static uint32_t largest_group(area_search* searches, uint32_t count) {
+    uint64_t sizes[4] = {0, 0, 0, 0};
+    for (uint32_t i = 0; i < count; i++)
+        sizes[search_group(searches, i)] += searches[i].visited;
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (searches[i].group != i)
+            continue;
+        if (!group_finished(searches, count, i))
+            return i;
+        if (sizes[i] > sizes[result])
+            result = i;
+    }
+    return result;
+}
+
+int count_areas_after_freeing(gamma_t* g, uint32_t x, uint32_t y) {
+    uint64_t board_num = y * (uint64_t)g->width + x;
+    uint32_t player = get_owner(g, board_num);
+    uint32_t groups = count_area_groups(g, player, x, y);
+    if (groups <= 1)
+        return groups; // freeing the field can't split the area
+    if (g->planes != NULL)
+        return plane_areas_after_freeing(g, player, x, y);
+
+    area_search searches[4];
+    uint32_t count;
+    int result = -1;
+    if (search_areas(g, player, x, y, searches, &count))
+        result = count_groups(searches, count);
+    free_searches(searches, count);
+    return result;
+}
+
+/** @brief Counts fields of areas which are separated from the largest one.
+ * @param[in] searches   - array of searches,
+ * @param[in] count      - number of searches.
+ * @return Number of nodes needed for separating areas.
+ */
+static uint64_t separated_fields(area_search* searches, uint32_t count) {
+    uint32_t largest = largest_group(searches, count);
+    uint64_t needed = 0;
+    for (uint32_t i = 0; i < count; i++)
+        if (search_group(searches, i) != largest)
+            needed += searches[i].visited;
+    return needed;
+}
+
+/** @brief Separates areas found by searches from the largest one.
+ * Gives fields of separated areas new nodes and removes them from
+ * the area of freed field. Nodes have to be reserved before.
+ * @param[in, out] g     - pointer to structure holding game status,
+ * @param[in] searches   - array of searches,
+ * @param[in] count      - number of searches,
+ * @param[in] root       - node representing area of freed field.
+ */
+static void separate_areas(gamma_t* g, area_search* searches, uint32_t count,
+                           uint64_t root) {
+    uint32_t largest = largest_group(searches, count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (searches[i].group == i && i != largest) {
+            uint64_t new_root = g->used_nodes;
+            for (uint32_t j = 0; j < count; j++) {
+                if (search_group(searches, j) != i)
+                    continue; // search from other area
+                for (uint64_t k = 0; k < searches[j].visited; k++)
+                    new_node(g, searches[j].fields[k], new_root);
+            }
+            // sizes are negative
+            set_parent(g, root, get_parent(g, root) - get_parent(g, new_root));
+        }
+    }
+}
+
+/** @brief Counts distinct areas of player adjacent to given field.
+ * Amortized complexity O(α(n)) where n stands for number of fields
+ * in those areas.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] player - number of inspected player,
  * @param[in] x      - horizontal position on board,
- * @param[in] y      - vertical position on board,
- * @param[in] value  - value set as representative in evry area field
+ * @param[in] y      - vertical position on board.
+ * @return Number of those areas.
  */
-static void set_representative(gamma_t* g, uint32_t x,
-                               uint32_t y, int64_t value) {
-    // dfs function for setting fields representative in find-and-union to
-    // given one (-1 if just dijoining sets)
+static uint32_t count_neighbour_areas(gamma_t* g, uint32_t player,
+                                      uint32_t x, uint32_t y) {
     uint64_t board_num = y * (uint64_t)g->width + x;
-    field* board = g->board;
-    uint32_t my_owner = board[board_num].owner_number;
-    board[board_num].representative = value;
-    if (value >= 0)
-        board[value].fields_in_area++;
-
-    // dfs for every adjacent field with the same owner
-    if (x > 0 && board[board_num - 1].owner_number == my_owner &&
-        board[board_num - 1].representative != value)
-        set_representative(g, x - 1, y, value);
-    if (x < g->width - 1 && board[board_num + 1].owner_number == my_owner &&
-        board[board_num + 1].representative != value)
-        set_representative(g, x + 1, y, value);
-    if (y > 0 && board[board_num - g->width].owner_number == my_owner &&
-        board[board_num - g->width].representative != value)
-        set_representative(g, x, y - 1, value);
-    if (y < g->height - 1 && 
-        board[board_num + g->width].owner_number == my_owner &&
-        board[board_num + g->width].representative != value)
-        set_representative(g, x, y + 1, value);
-}
-
-void delete_field(gamma_t* g, uint32_t x, uint32_t y) {
+    uint64_t neighbours[4];
+    int neighbours_number = 0;
+    if (x > 0)
+        neighbours[neighbours_number++] = board_num - 1;
+    if (x < g->width - 1)
+        neighbours[neighbours_number++] = board_num + 1;
+    if (y > 0)
+        neighbours[neighbours_number++] = board_num - g->width;
+    if (y < g->height - 1)
+        neighbours[neighbours_number++] = board_num + g->width;
+
+    uint64_t roots[4];
+    uint32_t result = 0;
+    for (int i = 0; i < neighbours_number; i++) {
+        if (get_owner(g, neighbours[i]) != player)
+            continue;
+        uint64_t root = main_representative(g, get_node(g, neighbours[i]));
+        bool distinct = true;
+        for (uint32_t j = 0; j < result; j++)
+            if (roots[j] == root)
+                distinct = false;
+        if (distinct)
+            roots[result++] = root;
+    }
+    return result;
+}
+
+bool delete_field(gamma_t* g, uint32_t x, uint32_t y) {
     uint64_t board_num = y * (uint64_t)g->width + x;
-    field* board = g->board;
-    uint32_t previous_owner = board[board_num].owner_number;
+    uint32_t previous_owner = get_owner(g, board_num);
+    uint32_t groups = count_area_groups(g, previous_owner, x, y);
+
+    // if freed field could join areas they are searched before the board
+    // changes, so memory needed for separating them is known
+    area_search searches[4];
+    uint32_t count = 0;
+    bool searched = groups > 1 &&
+                    search_areas(g, previous_owner, x, y, searches, &count);
+    uint64_t needed = searched ? separated_fields(searches, count) : 0;
+    // one more node is left for placing the field again
+    bool compact = (groups > 1 && !searched) || !reserve_nodes(g, needed + 1);
+    // changed tiles: owner, representative, new nodes and their fields
+    uint64_t tiles = 2 + (needed >> TILE_SHIFT) + 2 +
+        (needed < g->field_nodes.count ? needed : g->field_nodes.count);
+    if (compact ? !own_board(g) : !reserve_tiles(g, tiles + PLACE_TILES)) {
+        free_searches(searches, count);
+        return false; // failed to allocate memory
+    }
+
     g->free_fields++;
     g->players_array[previous_owner].used_fields--;
-    g->players_array[previous_owner].free_borders -= add_new_borders(g, x, y);
+    uint32_t lost_borders = add_new_borders(g, x, y, false);
+    g->players_array[previous_owner].free_borders -= lost_borders;
     unblock_borders(g, x, y);
+    remove_golden_targets(g, x, y);
 
-    board[board_num].owner_number = 0;
+    uint64_t root = main_representative(g, get_node(g, board_num));
+    set_parent(g, root, get_parent(g, root) + 1); // area has one field less
+    set_owner(g, board_num, 0);
 
-    // disjoin all areas adjacent to given field
-    if (x > 0 && board[board_num - 1].owner_number == previous_owner) {
-        set_representative(g, x - 1, y, -1);
-    }
-    if (x < g->width - 1 && 
-        board[board_num + 1].owner_number == previous_owner) {
-        set_representative(g, x + 1, y, -1);
+    // after freeing given field the number of areas of previous_owner
+    // has changed
+    if (compact) {
+        compact_nodes(g); // all areas get new nodes
+        groups = searched ? count_groups(searches, count) :
+                            count_neighbour_areas(g, previous_owner, x, y);
     }
-    if (y > 0 && board[board_num - g->width].owner_number == previous_owner) {
-        set_representative(g, x, y - 1, -1);
+    else if (searched) {
+        groups = count_groups(searches, count);
+        separate_areas(g, searches, count, root);
     }
-    if (y < g->height - 1 && 
-        board[board_num + g->width].owner_number == previous_owner) {
-        set_representative(g, x, y + 1, -1);
-    } 
+    free_searches(searches, count);
+    g->players_array[previous_owner].used_areas += groups;
     g->players_array[previous_owner].used_areas--;
-
-    // after freeing given field the number of areas of previous_owner
-    // has changed, check how many new are there and joins areas again
-    if (x > 0 && board[board_num - 1].owner_number == previous_owner &&
-        board[board_num - 1].representative == -1) {
-        set_representative(g, x - 1, y, board_num - 1);
-        g->players_array[previous_owner].used_areas += 1;
-    }
-    if (x < g->width - 1
-        && board[board_num + 1].owner_number == previous_owner &&
-        board[board_num + 1].representative == -1) {
-        set_representative(g, x + 1, y, board_num + 1);
-        g->players_array[previous_owner].used_areas += 1;
-    }
-    if (y > 0 && board[board_num - g->width].owner_number == previous_owner &&
-        board[board_num - g->width].representative == -1) {
-        set_representative(g, x, y - 1, board_num - g->width);
-        g->players_array[previous_owner].used_areas += 1;
-    }
-    if (y < g->height - 1 && 
-        board[board_num + g->width].owner_number == previous_owner &&
-        board[board_num + g->width].representative == -1) {
-        set_representative(g, x, y + 1, board_num + g->width);
-        g->players_array[previous_owner].used_areas += 1;
-    }
-}
\ No newline at end of file
+    if (groups != 1)
+        emit_event(g, GAMMA_EVENT_AREAS, previous_owner, board_num,
+                   g->players_array[previous_owner].used_areas);
+    add_golden_targets(g, x, y);
+    return true;
+}
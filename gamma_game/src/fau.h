@@ -11,23 +11,51 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/** @brief Maximal number of shared tiles changed by place.
+ * Owner and node of the field, the new node and representatives of the field
+ * and its neighbours.
+ */
+#define PLACE_TILES 8
+
 /** @brief Change given field's owner to player
  * Changes field's owner and if necessary joins areas in find-and-union.
- * Complexity O(log n) where n stands for number of fields in joined areas.
+ * Amortized complexity O(α(n)) where n stands for number of fields
+ * in joined areas, including rebuilding find-and-union once its nodes
+ * run out.
  * @param[in] g      - pointer to structure holding game status,
  * @param[in] player - number of a new owner,
  * @param[in] x      - horizontal position on board,
  * @param[in] y      - vertical position on board.
+ * @return False if memory for find-and-union couldn't be allocated,
+ * in this case nothing changes. PLACE_TILES tiles have to be reserved
+ * before, see reserve_tiles.
  */
-void place(gamma_t *g, uint32_t player, uint32_t x, uint32_t y);
+bool place(gamma_t *g, uint32_t player, uint32_t x, uint32_t y);
 
 /** @brief Frees given field
  * Frees given field and if necessary disjoins areas in find-and-union.
- * Complexity O(n) where n stands for number of fields in disjoined areas. 
+ * Complexity O(n) where n stands for number of fields in disjoined areas
+ * except the largest one.
+ * Memory is allocated before the board changes, including tiles and
+ * a node needed for placing a field afterwards.
  * @param[in] g      - pointer to structure holding game status,
  * @param[in] x      - horizontal position on board,
  * @param[in] y      - vertical position on board.
+ * @return False if memory couldn't be allocated, in this case nothing
+ * changes.
+ */
+bool delete_field(gamma_t* g, uint32_t x, uint32_t y);
+
+/** @brief Counts areas which player's area would split into without given field.
+ * Doesn't change the board. Searches the area only as far as needed
+ * to separate all but the largest of new areas.
+ * Complexity O(n) where n stands for number of fields in disjoined areas
+ * except the largest one.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] x      - horizontal position of player's field on board,
+ * @param[in] y      - vertical position of player's field on board.
+ * @return Number of those areas or -1 if memory couldn't be allocated.
  */
-void delete_field(gamma_t* g, uint32_t x, uint32_t y);
+int count_areas_after_freeing(gamma_t* g, uint32_t x, uint32_t y);
 
 #endif /* FAU_H */
\ No newline at end of file
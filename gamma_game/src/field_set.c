@@ -0,0 +1,140 @@
+/** @file
+ * Implementation of set of field numbers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "field_set.h"
+
+/** @brief Minimal number of slots of nonempty set. */
+#define MIN_CAPACITY 8
+
+/** @brief Finds slot where field number should start being looked for.
+ * @param[in] field_number  - number of the field on the board,
+ * @param[in] capacity      - number of slots, power of two.
+ * @return Number of the slot.
+ */
+static uint64_t home_slot(uint64_t field_number, uint64_t capacity) {
+    // multiplicative hashing spreads neighbouring fields over the table
+    return (field_number * 0x9E3779B97F4A7C15ULL >> 17) & (capacity - 1);
+}
+
+/** @brief Puts field number into the first free slot.
+ * Assumes there is free slot and the field isn't in the set.
+ * @param[in, out] slots    - array of slots,
+ * @param[in] capacity      - number of slots, power of two,
+ * @param[in] field_number  - number of the field on the board.
+ */
+static void insert_slot(uint64_t* slots, uint64_t capacity,
+                        uint64_t field_number) {
+    uint64_t i = home_slot(field_number, capacity);
+    while (slots[i] != FIELD_SET_EMPTY)
+        i = (i + 1) & (capacity - 1);
+    slots[i] = field_number;
+}
+
+/** @brief Moves fields of the set to the new array of slots.
+ * @param[in, out] set      - pointer to the set,
+ * @param[in] capacity      - new number of slots, power of two.
+ * @return False if memory couldn't be allocated.
+ */
+static bool resize(field_set* set, uint64_t capacity) {
+    uint64_t* slots = malloc(sizeof(uint64_t) * capacity);
+    if (slots == NULL)
+        return false;
+    for (uint64_t i = 0; i < capacity; i++)
+        slots[i] = FIELD_SET_EMPTY;
+    for (uint64_t i = 0; i < set->capacity; i++)
+        if (set->slots[i] != FIELD_SET_EMPTY)
+            insert_slot(slots, capacity, set->slots[i]);
+    free(set->slots);
+    set->slots = slots;
+    set->capacity = capacity;
+    return true;
+}
+
+bool field_set_add(field_set* set, uint64_t field_number) {
+    if (field_set_contains(set, field_number))
+        return true;
+    // set is kept at most half full so probing sequences stay short
+    if (2 * (set->size + 1) > set->capacity) {
+        uint64_t capacity = set->capacity ? 2 * set->capacity : MIN_CAPACITY;
+        if (!resize(set, capacity)) {
+            set->incomplete = true;
+            return false;
+        }
+    }
+    insert_slot(set->slots, set->capacity, field_number);
+    set->size++;
+    return true;
+}
+
+void field_set_remove(field_set* set, uint64_t field_number) {
+    if (set->capacity == 0)
+        return; // empty set
+    uint64_t mask = set->capacity - 1;
+    uint64_t i = home_slot(field_number, set->capacity);
+    while (set->slots[i] != field_number) {
+        if (set->slots[i] == FIELD_SET_EMPTY)
+            return; // field is not in the set
+        i = (i + 1) & mask;
+    }
+    // shifts following fields back so no probing sequence is broken
+    uint64_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (set->slots[j] == FIELD_SET_EMPTY)
+            break;
+        uint64_t home = home_slot(set->slots[j], set->capacity);
+        // field from slot j can be moved to slot i if its home slot
+        // is not cyclically in range (i, j]
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            set->slots[i] = set->slots[j];
+            i = j;
+        }
+    }
+    set->slots[i] = FIELD_SET_EMPTY;
+    set->size--;
+
+    if (set->size == 0 && !set->incomplete)
+        field_set_clear(set); // releasing memory of no longer used set
+    else if (set->capacity > MIN_CAPACITY && 8 * set->size < set->capacity)
+        resize(set, set->capacity / 2); // set stays as it is if this fails
+}
+
+bool field_set_contains(field_set* set, uint64_t field_number) {
+    if (set->capacity == 0)
+        return false;
+    uint64_t i = home_slot(field_number, set->capacity);
+    while (set->slots[i] != FIELD_SET_EMPTY) {
+        if (set->slots[i] == field_number)
+            return true;
+        i = (i + 1) & (set->capacity - 1);
+    }
+    return false;
+}
+
+bool field_set_copy(field_set* copy, field_set* set) {
+    *copy = *set;
+    if (set->capacity == 0)
+        return true;
+    copy->slots = malloc(sizeof(uint64_t) * set->capacity);
+    if (copy->slots == NULL) {
+        *copy = (field_set){NULL, 0, 0, true};
+        return false; // failed to allocate memory
+    }
+    memcpy(copy->slots, set->slots, sizeof(uint64_t) * set->capacity);
+    return true;
+}
+
+void field_set_clear(field_set* set) {
+    free(set->slots);
+    set->slots = NULL;
+    set->capacity = 0;
+    set->size = 0;
+    set->incomplete = false;
+}
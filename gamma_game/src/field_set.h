@@ -0,0 +1,66 @@
+/** @file
+ * Interface of set of field numbers.
+ * Open addressing hash set with linear probing, used for keeping track of
+ * small subsets of the board. Memory used by the set is proportional to
+ * the number of fields in it. Expected complexity of every function is O(1)
+ */
+
+#ifndef FIELD_SET_H
+#define FIELD_SET_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Value marking empty slot in the set. */
+#define FIELD_SET_EMPTY UINT64_MAX
+
+/** @brief Structure representing set of field numbers.
+ * Set filled with zeros is a valid empty set.
+ */
+typedef struct field_set {
+    uint64_t* slots; ///< field numbers or FIELD_SET_EMPTY.
+    uint64_t capacity; ///< number of slots, zero or power of two.
+    uint64_t size; ///< number of fields in the set.
+    bool incomplete; ///< if some field couldn't be added due to memory.
+} field_set;
+
+/** @brief Adds field number to the set.
+ * If memory for the field couldn't be allocated the set is marked as
+ * incomplete and the field isn't added.
+ * @param[in, out] set      - pointer to the set,
+ * @param[in] field_number  - number of the field on the board.
+ * @return False if memory couldn't be allocated.
+ */
+bool field_set_add(field_set* set, uint64_t field_number);
+
+/** @brief Removes field number from the set.
+ * Nothing happens if the field isn't in the set.
+ * @param[in, out] set      - pointer to the set,
+ * @param[in] field_number  - number of the field on the board.
+ */
+void field_set_remove(field_set* set, uint64_t field_number);
+
+/** @brief Checks if field number is in the set.
+ * @param[in] set           - pointer to the set,
+ * @param[in] field_number  - number of the field on the board.
+ * @return True if the field is in the set.
+ */
+bool field_set_contains(field_set* set, uint64_t field_number);
+
+/** @brief Copies the set.
+ * If memory for the copy couldn't be allocated the copy is empty and
+ * marked as incomplete.
+ * @param[out] copy         - pointer to the copy,
+ * @param[in] set           - pointer to copied set.
+ * @return False if memory couldn't be allocated.
+ */
+bool field_set_copy(field_set* copy, field_set* set);
+
+/** @brief Frees memory used by the set and makes it empty.
+ * @param[in, out] set      - pointer to the set.
+ */
+void field_set_clear(field_set* set);
+
+#endif /* FIELD_SET_H */
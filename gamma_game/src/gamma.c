@@ -8,11 +8,34 @@
 #include <stdbool.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "borders.h"
+#include "board.h"
+#include "events.h"
 #include "fau.h"
+#include "golden.h"
+#include "journal.h"
+#include "planes.h"
+#include "publish.h"
+#include "render.h"
 #include "gamma.h"
 
+/** @brief Number of find-and-union nodes allocated for a new game. */
+#define INITIAL_NODES 1024
+
+/** @brief Size of buffer used by gamma_board_write. */
+#define BOARD_BUFFER_SIZE (64 * 1024)
+
+/** @brief Structure representing buffered board output.
+ */
+typedef struct board_writer {
+    int fd; ///< file descriptor the board is written to.
+    size_t used; ///< number of characters waiting in the buffer.
+    char buffer[BOARD_BUFFER_SIZE]; ///< characters waiting to be written.
+} board_writer;
+
 /** @brief Finds characters needed to fit the number.
  * Applies opperation: 1 + floor(log10(number))
  * @param[in] number - the number of player to put in string,
@@ -33,94 +56,209 @@ gamma_t* gamma_new(uint32_t width, uint32_t height,
         return NULL;
 
     player_t* players_array = calloc((uint64_t)players + 1, sizeof(player_t));
-    uint64_t board_size = width * (uint64_t)height;
-    field* board = calloc(board_size, sizeof(field));
-    uint32_t* neighbours = calloc(4, sizeof(uint32_t));
     gamma_t* game = malloc(sizeof(gamma_t));
-
-    if (players_array == NULL || board == NULL || neighbours == NULL ||
-        game == NULL) { // could not allocate memory
+    if (players_array == NULL || game == NULL) {
+        // could not allocate memory
         free(players_array);
-        free(board);
-        free(neighbours);
         free(game);
         return NULL;
     }
 
     game->width = width;
     game->height = height;
+    uint64_t board_size = width * (uint64_t)height;
+    uint64_t nodes_capacity = board_size < INITIAL_NODES ? board_size :
+                                                           INITIAL_NODES;
     game->players = players;
+    if (!init_board(game, nodes_capacity)) { // could not allocate memory
+        free(players_array);
+        free(game);
+        return NULL;
+    }
+    if (!init_planes(game)) { // could not allocate memory
+        free_board(game);
+        free(players_array);
+        free(game);
+        return NULL;
+    }
     game->areas = areas;
-    game->free_fields = width * height;
-    game->board = board;
+    game->free_fields = board_size;
     game->players_array = players_array;
-    game->neighbours = neighbours;
     game->field_print_size = find_number_characters(game->players);
+    game->journal = NULL;
+    game->recording = false;
+    game->listener = NULL;
+    game->listener_data = NULL;
+    game->published = NULL;
+    clear_stats(game);
     return game;
 } 
 
+gamma_t* gamma_clone(gamma_t *g) {
+    if (g == NULL)
+        return NULL;
+    gamma_t* copy = malloc(sizeof(gamma_t));
+    player_t* players_array = malloc(((uint64_t)g->players + 1) *
+                                     sizeof(player_t));
+    if (copy == NULL || players_array == NULL) {
+        free(copy);
+        free(players_array);
+        return NULL; // failed to allocate memory
+    }
+    lock_board(g); // observers sharing tiles change the game too
+    *copy = *g;
+    copy->journal = NULL;
+    copy->recording = false;
+    copy->planes = NULL;
+    copy->listener = NULL;
+    copy->listener_data = NULL;
+    copy->published = NULL;
+    clear_stats(copy);
+    copy->players_array = players_array;
+    for (uint64_t i = 0; i <= g->players; i++) {
+        players_array[i] = g->players_array[i];
+        // incomplete sets of risky targets and frontiers are correct too
+        field_set_copy(&players_array[i].risky_targets,
+                       &g->players_array[i].risky_targets);
+        field_set_copy(&players_array[i].frontier,
+                       &g->players_array[i].frontier);
+    }
+    bool cloned = clone_board(copy, g);
+    unlock_board(g);
+    if (!cloned || !clone_planes(copy, g)) {
+        gamma_delete(copy);
+        return NULL; // failed to allocate memory
+    }
+    return copy;
+}
+
 void gamma_delete(gamma_t *g) {
     if (g != NULL) {
-        free(g->board);
+        for (uint64_t i = 0; i <= g->players; i++) {
+            field_set_clear(&g->players_array[i].risky_targets);
+            field_set_clear(&g->players_array[i].frontier);
+        }
+        free_published(g);
+        free_board(g);
+        free_planes(g);
+        journal_free(g);
         free(g->players_array);
-        free(g->neighbours);
         free(g);
     }
 }
 
-bool gamma_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
-    if (g == NULL || player < 1 || g->players < player ||
-        x >= g-> width || y >= g->height)
+bool gamma_listen(gamma_t *g, gamma_listener listener, void *data) {
+    if (g == NULL)
         return false; // incorrect parameter
-    if (g->board[y * g->width + x].owner_number != 0)
+    g->listener = listener;
+    g->listener_data = listener != NULL ? data : NULL;
+    return true;
+}
+
+/** @brief Performs a move without recording it in the journal.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] player - number of player performing the move,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ * @return True if the move was performed.
+ */
+static bool move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
+    if (get_owner(g, y * (uint64_t)g->width + x) != 0)
         return false; // field already occupied
 
     if (!count_neighbours(g, player, x, y) &&
         g->players_array[player].used_areas == g->areas)
         return false; // new area while maximum areas is reached
 
-    place(g, player, x, y);
-    g->players_array[player].free_borders += add_new_borders(g, x, y);
+    if (!place(g, player, x, y))
+        return false; // failed to allocate memory
+    g->players_array[player].free_borders += add_new_borders(g, x, y, true);
     block_borders(g, x, y);
+    update_move_targets(g, player, x, y);
     g->players_array[player].used_fields++;
     g->free_fields--;
     return true;    
 }
 
-bool gamma_golden_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
+bool gamma_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
     if (g == NULL || player < 1 || g->players < player ||
         x >= g-> width || y >= g->height)
         return false; // incorrect parameter
+    publish_begin(g);
+    bool result = reserve_tiles(g, PLACE_TILES);
+    if (result) {
+        journal_begin(g, player, x, y);
+        result = move(g, player, x, y);
+        journal_end(g, result);
+        publish_area(g, x, y);
+    }
+    publish_end(g);
+    return result;
+}
+
+/** @brief Performs a golden move without recording it in the journal.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] player - number of player performing the move,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ * @return True if the move was performed.
+ */
+static bool golden_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
     if (g->players_array[player].used_golden)
         return false; // golden_move already performed
 
     uint64_t board_num = y * (uint64_t)g->width + x;
-    uint32_t previous_owner = g->board[board_num].owner_number;
+    uint32_t previous_owner = get_owner(g, board_num);
     if (previous_owner == 0 || previous_owner == player)
         return false; // field free or belongs to player
-    delete_field(g, x, y);
+    if (g->planes != NULL && field_can_be_taken(g, x, y) == 0)
+        return false; // checking areas is cheaper than freeing the field
+    if (!delete_field(g, x, y))
+        return false; // failed to allocate memory
 
     if (g->players_array[previous_owner].used_areas > g->areas) {
         // golden_move would create too many areas for previous_owner
         // so field is given back to previous_owner
-        gamma_move(g, previous_owner, x, y);
+        move(g, previous_owner, x, y);
         return false; 
     }
-    if (gamma_move(g, player, x, y)) {
+    if (move(g, player, x, y)) {
         // golden_move is possible so field is acquired by player
         g->players_array[player].used_golden = true;
+        emit_event(g, GAMMA_EVENT_GOLDEN, player, board_num, true);
         return true;
     }
     else {
         // maximum number of areas of player would be surpassed
-        gamma_move(g, previous_owner, x, y);
+        move(g, previous_owner, x, y);
         return false;
     }
 }
 
+bool gamma_golden_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
+    if (g == NULL || player < 1 || g->players < player ||
+        x >= g-> width || y >= g->height)
+        return false; // incorrect parameter
+    publish_begin(g);
+    uint32_t previous_owner = get_owner(g, y * (uint64_t)g->width + x);
+    journal_begin(g, player, x, y);
+    bool result = golden_move(g, player, x, y);
+    journal_end(g, result);
+    // previous owner may have no fields around the field afterwards
+    publish_player(g, previous_owner);
+    publish_area(g, x, y);
+    publish_end(g);
+    return result;
+}
+
 uint64_t gamma_busy_fields(gamma_t *g, uint32_t player) {
     if (g == NULL || player < 1 || g->players < player)
         return 0; // incorrect parameter
+    else if (g->published != NULL) {
+        uint64_t busy, available;
+        read_published(g, player, &busy, &available);
+        return busy;
+    }
     else {
         player_t analysed_player = g->players_array[player];
         return analysed_player.used_fields;
@@ -130,6 +268,11 @@ uint64_t gamma_busy_fields(gamma_t *g, uint32_t player) {
 uint64_t gamma_free_fields(gamma_t *g, uint32_t player) {
     if (g == NULL || player < 1 || g->players < player)
         return 0; // incorrect parameter
+    else if (g->published != NULL) {
+        uint64_t busy, available;
+        read_published(g, player, &busy, &available);
+        return available;
+    }
     else {
         player_t analysed_player = g->players_array[player];
         if (analysed_player.used_areas == g->areas)
@@ -139,125 +282,256 @@ uint64_t gamma_free_fields(gamma_t *g, uint32_t player) {
     }
 }
 
-bool gamma_golden_possible(gamma_t *g, uint32_t player) {
-    if (g == NULL || player < 1 || g->players < player)
-        return false; // incorrest parameter
-    player_t analysed_player = g->players_array[player];
-    if (analysed_player.used_golden)
-        return false; // golden move already used
-    
-    bool field_found = false;
-    // Now checking for every field if golden move can be performed on it
-    for (uint32_t y = 0; y < g->height; y++) {
-        for (uint32_t x = 0; x < g->width; x++) {
-            uint64_t board_num = y * (uint64_t)g->width + x;
-            uint32_t previous_owner = g->board[board_num].owner_number;
-            if (previous_owner == 0 || previous_owner == player)
-                continue; // field free or belongs to player
-
-            delete_field(g, x, y);
-            
-            if (g->players_array[previous_owner].used_areas > g->areas || 
-                (!count_neighbours(g, player, x, y) &&
-                g->players_array[player].used_areas == g->areas)) {
-                // golden_move on this field would create too many areas for 
-                // 'player' or for 'previous_owner'
-                field_found = false;
-            }
-            else
-                field_found = true;
-                
-            gamma_move(g, previous_owner, x, y);
-            if (field_found)
-                return true;
-        }
-    }
-    return false;
+/** @brief Checks if the field is the first adjacent field of the player.
+ * Adjacent fields are ordered by their numbers.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] player    - number of the player,
+ * @param[in] board_num - number of player's field on the board,
+ * @param[in] free_num  - number of adjacent free field.
+ * @return True if no adjacent field with lower number belongs to player.
+ */
+static bool first_adjacent(gamma_t *g, uint32_t player, uint64_t board_num,
+                           uint64_t free_num) {
+    uint32_t x = free_num % g->width, y = free_num / g->width;
+    if (y > 0 && free_num - g->width < board_num &&
+        get_owner(g, free_num - g->width) == player)
+        return false;
+    if (x > 0 && free_num - 1 < board_num &&
+        get_owner(g, free_num - 1) == player)
+        return false;
+    return !(x < g->width - 1 && free_num + 1 < board_num &&
+             get_owner(g, free_num + 1) == player);
 }
 
-/** @brief Puts given number into a string at given position
- * The char array that is going to be created by gamma_board needs to 
- * numbers of players owning every field and some representation of
- * free fields (zeros). For evry number there is a certain number of chars.
- * @param[in] number       - the number of player to put in string,
- * @param[in] size         - number of chars to fill,
- * @param[in, out] buffor  - string to change ,
- * @param[in] number_begin - index of the beginning of number space in string. 
+/** @brief Writes free fields adjacent to player's fields.
+ * Uses frontier of the player if it is complete, otherwise checks every
+ * busy field of the board.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] player    - number of the player,
+ * @param[out] out      - array for numbers of the fields,
+ * @param[in] size      - size of the array.
+ * @return Number of written fields.
  */
-static void put_in_string(uint32_t number, uint32_t size,
-                          char* buffor, uint64_t number_begin) {
-    if (number == 0) {
-        buffor[number_begin + size - 1] = '.';
-        for (int32_t i = size - 2; i >= 0; i--)
-            buffor[number_begin + i] = (char)32;
-        return; // one '.' for free field
+static uint64_t frontier_moves(gamma_t *g, uint32_t player, uint64_t *out,
+                               uint64_t size) {
+    field_set* frontier = &g->players_array[player].frontier;
+    uint64_t written = 0;
+    if (!frontier->incomplete) {
+        for (uint64_t i = 0; i < frontier->capacity && written < size; i++)
+            if (frontier->slots[i] != FIELD_SET_EMPTY)
+                out[written++] = frontier->slots[i];
+        return written;
     }
-    for (int32_t i = size - 1; i >= 0; i--) {
-        if (number != 0)
-            buffor[number_begin + i] = '0' + (number % 10);
-        else
-            buffor[number_begin + i] = (char)32; // fill space with spaces
-        number /= 10;
+    uint64_t position = 0, board_num;
+    while (written < size && next_busy_field(g, &position, &board_num)) {
+        if (get_owner(g, board_num) != player)
+            continue;
+        uint32_t x = board_num % g->width, y = board_num / g->width;
+        uint64_t adjacent[4];
+        int count = 0;
+        if (y > 0)
+            adjacent[count++] = board_num - g->width;
+        if (x > 0)
+            adjacent[count++] = board_num - 1;
+        if (x < g->width - 1)
+            adjacent[count++] = board_num + 1;
+        if (y < g->height - 1)
+            adjacent[count++] = board_num + g->width;
+        // field is written next to its first adjacent field of player
+        for (int i = 0; i < count && written < size; i++)
+            if (get_owner(g, adjacent[i]) == 0 &&
+                first_adjacent(g, player, board_num, adjacent[i]))
+                out[written++] = adjacent[i];
     }
+    return written;
 }
 
-/** @brief Generates gamma board for less then 10 players
- * Simplier version og gamma_board when g->players is less then 10
- * @param[in] g         - pointer to structure holding game status,
- * @param[in] buffor    - pointer to resulting string
+uint64_t gamma_legal_moves(gamma_t *g, uint32_t player, uint64_t *out,
+                           uint64_t size) {
+    if (g == NULL || player < 1 || g->players < player ||
+        (out == NULL && size > 0))
+        return 0; // incorrect parameter
+    uint64_t result = gamma_free_fields(g, player);
+    if (size > result)
+        size = result;
+    uint64_t written = frontier_moves(g, player, out, size);
+
+    // player can start a new area on any other free field
+    uint64_t board_size = g->width * (uint64_t)g->height;
+    for (uint64_t board_num = 0; written < size && board_num < board_size;
+         board_num++) {
+        uint32_t x = board_num % g->width, y = board_num / g->width;
+        if (get_owner(g, board_num) == 0 && !count_neighbours(g, player, x, y))
+            out[written++] = board_num;
+    }
+    return result;
+}
+
+/** @brief Checks if given field can be taken from its owner.
+ * If memory for checking it without changing the board couldn't be
+ * allocated, frees the field, checks if its previous owner wouldn't exceed
+ * maximum number of areas and gives the field back. Meanwhile the listener
+ * is detached and the journal doesn't record, so the check leaves no trace.
+ * Complexity O(n) where n stands for number of fields in disjoined areas.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ * @return True if freeing the field doesn't create too many areas.
  */
-void few_players_board(gamma_t *g, char* buffor) {
-    for (uint32_t line = 0; line < g->height; line++) {
-        uint64_t line_begin = (g->height - 1 - line) * (uint64_t)(g->width + 1);
-        for (uint32_t j = 0; j < g->width; j++) {
-            put_in_string(g->board[line * (uint64_t)g->width + j].owner_number,
-                          1, buffor, line_begin + j);
-        }
-        buffor[line_begin + g->width] = '\n';
+static bool field_can_be_freed(gamma_t *g, uint32_t x, uint32_t y) {
+    int result = field_can_be_taken(g, x, y);
+    if (result >= 0)
+        return result;
+
+    uint64_t board_num = y * (uint64_t)g->width + x;
+    uint32_t previous_owner = get_owner(g, board_num);
+    STAT_ADD(g, STAT_GOLDEN_CYCLES, 1);
+    gamma_listener listener = g->listener;
+    void* listener_data = g->listener_data;
+    bool recording = g->recording;
+    g->listener = NULL;
+    g->recording = false;
+    bool field_found = false;
+    if (delete_field(g, x, y)) {
+        // golden_move on this field could create too many areas for
+        // previous_owner
+        field_found = g->players_array[previous_owner].used_areas <= g->areas;
+        move(g, previous_owner, x, y);
     }
-    buffor[(g->width + 1) * (uint64_t)g->height] = '\0';
+    g->listener = listener;
+    g->listener_data = listener_data;
+    g->recording = recording;
+    return field_found;
+}
+
+/** @brief Checks every field freeing it if there is no memory to inspect it.
+ * Fallback of golden_board_scan changing the board.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] player - number of player performing golden move.
+ * @return True if golden move can be performed on some field.
+ */
+static bool golden_board_freeing_scan(gamma_t *g, uint32_t player) {
+    uint64_t position = 0, board_num;
+    while (next_busy_field(g, &position, &board_num)) {
+        uint32_t x = board_num % g->width, y = board_num / g->width;
+        if (get_owner(g, board_num) == player)
+            continue; // field belongs to player
+        if (!count_neighbours(g, player, x, y))
+            continue; // player would create too many areas
+        if (field_can_be_freed(g, x, y))
+            return true;
+    }
+    return false;
+}
+
+bool gamma_golden_possible(gamma_t *g, uint32_t player) {
+    if (g == NULL || player < 1 || g->players < player)
+        return false; // incorrest parameter
+    int result = golden_possible(g, player);
+    if (result >= 0)
+        return result;
+    // failed to allocate memory, fields are freed and given back
+    lock_board(g);
+    bool found = golden_board_freeing_scan(g, player);
+    unlock_board(g);
+    return found;
 }
 
 char* gamma_board(gamma_t *g) {
     if (g == NULL) 
         return NULL;
-    if (g->players < 10) {
-        // characters needed for whole board
-        uint64_t line_characters = (uint64_t)g->width + 1;
-        uint64_t total_characters = line_characters * (uint64_t)g->height;
-        char* buffor = malloc(sizeof(char) * total_characters + 1);
-        if (buffor == NULL)
+    if (g->published != NULL) { // observers render a view of the board
+        gamma_t* view = take_view(g);
+        if (view == NULL)
             return NULL; // failed to allocate memory
-        else {
-            few_players_board(g, buffor);
-            return buffor;
-        }
+        char* result = gamma_board(view);
+        release_view(view);
+        return result;
     }
-    // characters needed for single number
-    uint32_t number_characters = g->field_print_size;
     // characters needed for one line
-    uint64_t line_characters = g->width * (uint64_t)(number_characters + 1);
+    uint64_t line_characters = g->width * field_text_size(g) +
+                               (g->players < 10 ? 1 : 0);
     // characters needed for whole board
     uint64_t total_characters = line_characters * (uint64_t)g->height;
-    char* buffor = malloc(sizeof(char) * total_characters  + 1);
+    char* buffor = malloc(sizeof(char) * total_characters + 1);
+    STAT_ADD(g, STAT_BOARD_BYTES, total_characters + 1);
     if (buffor == NULL)
         return NULL; // failed to allocate memory
     buffor[total_characters] = '\0';
-    field *board = g->board;
 
+    field_texts texts;
+    prepare_field_texts(g, &texts);
     for (uint32_t line = 0; line < g->height; line++) {
         uint64_t line_begin = (g->height - 1 - line) * line_characters;
-        for (uint32_t j = 0; j < g->width; j++) {
-            uint64_t number_begin = line_begin + j * (number_characters + 1);
-            uint32_t number = board[line * (uint64_t)g->width + j].owner_number;
-            put_in_string(number, number_characters, buffor, number_begin);
-            // character ' ' separates fields
-            if (j < g->width - 1)
-                buffor[line_begin + (j + 1) * (number_characters + 1) - 1] = ' ';
-            else {
-                buffor[line_begin + line_characters - 1] = '\n';
+        render_fields(g, &texts, line * (uint64_t)g->width, g->width, true,
+                      buffor + line_begin);
+    }
+    free_field_texts(&texts);
+    return buffor;
+}
+
+/** @brief Writes all characters waiting in the buffer.
+ * @param[in, out] writer   - pointer to buffered output.
+ * @return False if writing failed.
+ */
+static bool flush_board(board_writer* writer) {
+    size_t written = 0;
+    while (written < writer->used) {
+        ssize_t result = write(writer->fd, writer->buffer + written,
+                               writer->used - written);
+        if (result < 0 && errno != EINTR)
+            return false; // failed to write
+        if (result > 0)
+            written += result;
+    }
+    writer->used = 0;
+    return true;
+}
+
+bool gamma_board_write(gamma_t *g, int fd) {
+    if (g == NULL || fd < 0)
+        return false; // incorrect parameter
+    if (g->published != NULL) { // observers write a view of the board
+        gamma_t* view = take_view(g);
+        if (view == NULL)
+            return false; // failed to allocate memory
+        bool result = gamma_board_write(view, fd);
+        release_view(view);
+        return result;
+    }
+    board_writer* writer = malloc(sizeof(board_writer));
+    STAT_ADD(g, STAT_BOARD_BYTES, sizeof(board_writer));
+    if (writer == NULL)
+        return false; // failed to allocate memory
+    writer->fd = fd;
+    writer->used = 0;
+
+    uint64_t field_size = field_text_size(g);
+    field_texts texts;
+    prepare_field_texts(g, &texts);
+    bool written = true;
+    for (uint32_t line = g->height; line-- > 0 && written;) {
+        uint64_t line_begin = line * (uint64_t)g->width;
+        uint64_t done = 0;
+        while (done < g->width && written) {
+            // one character is left for the end of line
+            if (writer->used + field_size + 1 > BOARD_BUFFER_SIZE) {
+                written = flush_board(writer);
+                continue;
             }
+            uint64_t fitting = (BOARD_BUFFER_SIZE - writer->used - 1) /
+                               field_size;
+            uint64_t part = g->width - done;
+            if (part > fitting)
+                part = fitting;
+            done += part;
+            writer->used += render_fields(g, &texts, line_begin + done - part,
+                                          part, done == g->width,
+                                          writer->buffer + writer->used);
         }
     }
-    return buffor;
-}  
\ No newline at end of file
+    written = written && flush_board(writer);
+    free_field_texts(&texts);
+    free(writer);
+    return written;
+}
@@ -10,6 +10,7 @@
 #define GAMMA_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -17,6 +18,40 @@
  */
 typedef struct gamma gamma_t;
 
+/**
+ * Struktura opisująca pytanie o stan gry.
+ */
+typedef struct gamma_query {
+    char type;          ///< rodzaj pytania: 'b', 'f' lub 'q'.
+    uint32_t player;    ///< numer gracza, którego dotyczy pytanie.
+    uint64_t answer;    ///< odpowiedź na pytanie.
+} gamma_query;
+
+/**
+ * Rodzaje zdarzeń zmieniających stan gry.
+ */
+typedef enum gamma_event_kind {
+    GAMMA_EVENT_OWNER,    ///< pole zmieniło właściciela, wartość to poprzedni.
+    GAMMA_EVENT_AREAS,    ///< zmieniła się liczba obszarów, wartość to nowa.
+    GAMMA_EVENT_GOLDEN,   ///< wartość mówi, czy gracz wykorzystał złoty ruch.
+    GAMMA_EVENT_FRONTIER  ///< wartość mówi, czy wolne pole sąsiaduje z graczem.
+} gamma_event_kind;
+
+/**
+ * Struktura opisująca zdarzenie zmieniające stan gry.
+ */
+typedef struct gamma_event {
+    uint8_t kind;       ///< rodzaj zdarzenia, @ref gamma_event_kind.
+    uint32_t player;    ///< gracz, a przy zmianie właściciela nowy właściciel.
+    uint64_t field;     ///< numer pola y * width + x lub UINT64_MAX.
+    uint64_t value;     ///< wartość zależna od rodzaju zdarzenia.
+} gamma_event;
+
+/**
+ * Funkcja odbierająca zdarzenia zmieniające stan gry.
+ */
+typedef void (*gamma_listener)(void *data, const gamma_event *event);
+
 /** @brief Tworzy strukturę przechowującą stan gry.
  * Alokuje pamięć na nową strukturę przechowującą stan gry.
  * Inicjuje tę strukturę tak, aby reprezentowała początkowy stan gry.
@@ -38,6 +73,20 @@ gamma_t* gamma_new(uint32_t width, uint32_t height,
  */
 void gamma_delete(gamma_t *g);
 
+/** @brief Tworzy kopię stanu gry.
+ * Kopia dzieli z grą @p g fragmenty planszy, dopóki któraś z nich ich nie
+ * zmieni, więc koszt utworzenia kopii jest proporcjonalny do liczby
+ * fragmentów, a nie pól planszy. Fragment jest kopiowany przy pierwszej
+ * zmianie. Kopia nie prowadzi dziennika ruchów. Kopii i gry @p g można
+ * używać w różnych wątkach, ale nie wolno tworzyć kopii gry używanej
+ * jednocześnie w innym wątku.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wskaźnik na kopię, którą należy usunąć funkcją @ref gamma_delete,
+ * lub NULL, gdy nie udało się zaalokować pamięci lub parametr jest
+ * niepoprawny.
+ */
+gamma_t* gamma_clone(gamma_t *g);
+
 /** @brief Wykonuje ruch.
  * Ustawia pionek gracza @p player na polu (@p x, @p y).
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
@@ -89,6 +138,26 @@ uint64_t gamma_busy_fields(gamma_t *g, uint32_t player);
  */
 uint64_t gamma_free_fields(gamma_t *g, uint32_t player);
 
+/** @brief Podaje pola, na których gracz może postawić pionek.
+ * Zapisuje w tablicy @p out numery co najwyżej @p size pól, na których
+ * gracz @p player może postawić pionek w następnym ruchu. Pole (x, y) ma
+ * numer y * width + x. Najpierw są podawane wolne pola sąsiadujące z polami
+ * gracza, a jeśli gracz może zająć jeszcze nowy obszar, także pozostałe
+ * wolne pola w kolejności numerów. Czas działania jest proporcjonalny do
+ * liczby pól sąsiadujących z polami gracza i liczby pól przejrzanych
+ * w poszukiwaniu pozostałych wolnych pól.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @param[out] out    – tablica na numery pól,
+ * @param[in] size    – rozmiar tablicy @p out.
+ * @return Liczba wszystkich takich pól, równa wyniku funkcji
+ * @ref gamma_free_fields, lub zero, jeśli któryś z parametrów jest
+ * niepoprawny.
+ */
+uint64_t gamma_legal_moves(gamma_t *g, uint32_t player, uint64_t *out,
+                           uint64_t size);
+
 /** @brief Sprawdza, czy gracz może wykonać złoty ruch.
  * Sprawdza, czy gracz @p player jeszcze nie wykonał w tej rozgrywce złotego
  * ruchu i jest przynajmniej jedno pole zajęte przez innego gracza.
@@ -101,6 +170,79 @@ uint64_t gamma_free_fields(gamma_t *g, uint32_t player);
  */
 bool gamma_golden_possible(gamma_t *g, uint32_t player);
 
+/** @brief Włącza lub wyłącza dziennik ruchów.
+ * Po włączeniu dziennika każdy wykonany ruch i złoty ruch jest w nim
+ * zapisywany i może zostać cofnięty funkcją @ref gamma_undo. Wyłączenie
+ * dziennika usuwa zapisane w nim ruchy.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] enabled – czy dziennik ma być prowadzony.
+ * @return Wartość @p true, jeśli udało się włączyć lub wyłączyć dziennik,
+ * a @p false, gdy nie udało się zaalokować pamięci lub parametr jest
+ * niepoprawny.
+ */
+bool gamma_journal(gamma_t *g, bool enabled);
+
+/** @brief Cofa ostatni ruch zapisany w dzienniku.
+ * Przywraca stan gry sprzed ostatniego niecofniętego ruchu. Czas działania
+ * jest proporcjonalny do liczby słów stanu gry zmienionych przez ten ruch.
+ * Jeśli nie udało się zaalokować pamięci na zapisanie ruchu, wcześniejsze
+ * ruchy nie mogą zostać cofnięte.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wartość @p true, jeśli ruch został cofnięty, a @p false, jeśli
+ * dziennik nie jest prowadzony, nie ma w nim ruchu do cofnięcia lub nie
+ * udało się zaalokować pamięci na kopie fragmentów planszy dzielonych
+ * z inną grą.
+ */
+bool gamma_undo(gamma_t *g);
+
+/** @brief Ponawia ostatni cofnięty ruch.
+ * Ruchy cofnięte funkcją @ref gamma_undo można ponowić, dopóki nie zostanie
+ * wykonany nowy ruch.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wartość @p true, jeśli ruch został ponowiony, a @p false, jeśli
+ * dziennik nie jest prowadzony, nie ma w nim ruchu do ponowienia lub nie
+ * udało się zaalokować pamięci na kopie fragmentów planszy dzielonych
+ * z inną grą.
+ */
+bool gamma_redo(gamma_t *g);
+
+/** @brief Ustawia funkcję odbierającą zdarzenia zmieniające stan gry.
+ * Funkcja @p listener jest wywoływana z argumentem @p data w trakcie
+ * ruchów, złotych ruchów, cofania i ponawiania ruchów dla każdej zmiany
+ * właściciela pola, liczby obszarów gracza, wykorzystania złotego ruchu
+ * i zbioru wolnych pól sąsiadujących z polami gracza. Zdarzenia są
+ * podawane także dla zmian odwracanych w trakcie tej samej funkcji, na
+ * przykład przy sprawdzaniu złotego ruchu, więc stosując je po kolei
+ * odbiorca zawsze zna aktualny stan gry, a koszt jego pracy jest
+ * proporcjonalny do liczby zmian. Funkcja @p listener nie może zmieniać
+ * stanu gry. Kopie gry nie dziedziczą odbiorcy.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] listener – funkcja odbierająca zdarzenia lub NULL, aby
+ *                      przestać je podawać,
+ * @param[in] data    – wskaźnik przekazywany funkcji @p listener.
+ * @return Wartość @p true, jeśli ustawiono odbiorcę zdarzeń, a @p false,
+ * jeśli parametr @p g jest niepoprawny.
+ */
+bool gamma_listen(gamma_t *g, gamma_listener listener, void *data);
+
+/** @brief Włącza lub wyłącza tryb współbieżny.
+ * W trybie współbieżnym jeden wątek zmienia stan gry, a dowolnie wiele
+ * innych wątków może jednocześnie wywoływać funkcje
+ * @ref gamma_busy_fields, @ref gamma_free_fields, @ref gamma_board
+ * i @ref gamma_board_write. Liczniki graczy są publikowane po każdym ruchu
+ * i czytane bez blokowania wątku wykonującego ruchy. Plansza jest
+ * wypisywana z widoku dzielącego z grą fragmenty planszy, tworzonego raz dla
+ * każdego jej stanu; wątek wykonujący ruchy czeka co najwyżej na podzielenie
+ * fragmentów z nowym widokiem. Wyłączyć tryb współbieżny można dopiero, gdy
+ * inne wątki przestały używać gry.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] enabled – czy tryb współbieżny ma być włączony.
+ * @return Wartość @p true, jeśli udało się włączyć lub wyłączyć tryb
+ * współbieżny, a @p false, gdy nie udało się zaalokować pamięci lub
+ * parametr jest niepoprawny.
+ */
+bool gamma_concurrent(gamma_t *g, bool enabled);
+
 /** @brief Daje napis opisujący stan planszy.
  * Alokuje w pamięci bufor, w którym umieszcza napis zawierający tekstowy
  * opis aktualnego stanu planszy. Przykład znajduje się w pliku gamma_test.c.
@@ -111,4 +253,79 @@ bool gamma_golden_possible(gamma_t *g, uint32_t player);
  */
 char* gamma_board(gamma_t *g);
 
+/** @brief Wypisuje napis opisujący stan planszy.
+ * Zapisuje do deskryptora @p fd ten sam napis, który daje funkcja
+ * @ref gamma_board, bez alokowania bufora na całą planszę. Plansza jest
+ * wypisywana wiersz po wierszu przez bufor stałego rozmiaru.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] fd      – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true, jeśli udało się wypisać planszę,
+ * a @p false w przeciwnym przypadku.
+ */
+bool gamma_board_write(gamma_t *g, int fd);
+
+/** @brief Zapisuje stan gry do pliku.
+ * Zapisuje w pliku @p path migawkę pełnego stanu gry, którą można później
+ * wczytać funkcją @ref gamma_load. Migawka jest zapisywana do pliku
+ * tymczasowego w tym samym katalogu, który zastępuje plik @p path dopiero
+ * po zapisaniu całości, więc nieudany zapis nie niszczy poprzedniej migawki.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] path    – ścieżka do pliku.
+ * @return Wartość @p true, jeśli udało się zapisać migawkę,
+ * a @p false w przeciwnym przypadku.
+ */
+bool gamma_save(gamma_t *g, const char *path);
+
+/** @brief Wczytuje stan gry z pliku.
+ * Odwzorowuje w pamięci migawkę zapisaną funkcją @ref gamma_save. Plansza
+ * nie jest kopiowana, strony pliku są wczytywane przy pierwszym dostępie.
+ * Zmiany stanu gry nie są zapisywane w pliku.
+ * @param[in] path    – ścieżka do pliku.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ * wczytać pliku lub nie zawiera on poprawnej migawki.
+ */
+gamma_t* gamma_load(const char *path);
+
+/** @brief Odpowiada na wiele pytań o stan gry jednocześnie.
+ * Dla każdego pytania z tablicy @p queries ustawia odpowiedź, jaką dałaby
+ * funkcja @ref gamma_busy_fields (pytanie 'b'), @ref gamma_free_fields
+ * (pytanie 'f') lub @ref gamma_golden_possible (pytanie 'q'). Na pytania
+ * innego rodzaju odpowiedzią jest zero. Pytania są dzielone między wątki,
+ * które nie zmieniają stanu gry. W trakcie działania funkcji stan gry nie
+ * może być zmieniany.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in,out] queries – tablica pytań,
+ * @param[in] count   – liczba pytań,
+ * @param[in] threads – liczba wątków lub zero, aby użyć wszystkich
+ *                      procesorów.
+ * @return Wartość @p true, jeśli udzielono odpowiedzi na pytania,
+ * a @p false, jeśli któryś z parametrów jest niepoprawny.
+ */
+bool gamma_queries(gamma_t *g, gamma_query *queries, size_t count,
+                   unsigned threads);
+
+/** @brief Proponuje ruch gracza.
+ * Wybiera ruch gracza @p player przeszukując drzewo gry metodą Monte-Carlo
+ * przez @p milliseconds milisekund. Przeszukiwanie odbywa się w wielu
+ * wątkach, z których każdy używa własnej kopii stanu gry. Stan gry nie jest
+ * zmieniany, ale nie może być zmieniany w trakcie działania funkcji.
+ * Drzewo zajmuje ograniczoną ilość pamięci, po jej wyczerpaniu liście
+ * drzewa nie są rozwijane, a jedynie rozgrywane losowo.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @param[in] milliseconds – czas przeszukiwania w milisekundach,
+ * @param[in] threads – liczba wątków lub zero, aby użyć wszystkich
+ *                      procesorów,
+ * @param[out] x      – numer kolumny proponowanego pola,
+ * @param[out] y      – numer wiersza proponowanego pola,
+ * @param[out] golden – czy proponowany ruch jest złotym ruchem.
+ * @return Wartość @p true, jeśli znaleziono ruch, a @p false, jeśli gracz
+ * nie może wykonać ruchu, nie udało się zaalokować pamięci lub któryś
+ * z parametrów jest niepoprawny.
+ */
+bool gamma_suggest_move(gamma_t *g, uint32_t player, uint64_t milliseconds,
+                        unsigned threads, uint32_t *x, uint32_t *y,
+                        bool *golden);
+
 #endif /* GAMMA_H */
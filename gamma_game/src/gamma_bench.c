@@ -0,0 +1,530 @@
+/** @file
+ * Benchmark of gamma engine functions.
+ * Usage: gamma_bench [seed [workload...]]
+ *
+ * Every workload runs in its own process, so peak memory usage is measured
+ * separately for each of them. For every engine function called by the
+ * workload one tab separated line is written: workload name, function name,
+ * number of calls, calls per second and 50th, 99th and 99.9th percentile of
+ * call time in nanoseconds, followed by peak resident memory of the
+ * workload in kilobytes. The first line names the columns. Call times
+ * include reading the clock, which matters only for the fastest functions.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "gamma.h"
+
+/** @brief Call times below it are counted exactly, larger in ranges. */
+#define EXACT_TIMES 32
+
+/** @brief Number of histogram buckets, enough for any 64-bit time. */
+#define TIME_BUCKETS (60 * EXACT_TIMES)
+
+/** @brief Seed used when none is given. */
+#define DEFAULT_SEED 1
+
+/** @brief Engine functions measured by the benchmark. */
+enum bench_function {
+    BENCH_MOVE, ///< gamma_move.
+    BENCH_GOLDEN_MOVE, ///< gamma_golden_move.
+    BENCH_GOLDEN_POSSIBLE, ///< gamma_golden_possible.
+    BENCH_BUSY_FIELDS, ///< gamma_busy_fields.
+    BENCH_FREE_FIELDS, ///< gamma_free_fields.
+    BENCH_UNDO, ///< gamma_undo.
+    BENCH_BOARD, ///< gamma_board.
+    BENCH_FUNCTIONS ///< number of measured functions.
+};
+
+/** @brief Names of measured functions. */
+static const char* function_names[BENCH_FUNCTIONS] = {
+    "gamma_move", "gamma_golden_move", "gamma_golden_possible",
+    "gamma_busy_fields", "gamma_free_fields", "gamma_undo", "gamma_board"
+};
+
+/** @brief Structure representing call times of one function.
+ * Times are kept in a histogram with relative error below 1/EXACT_TIMES,
+ * so memory used by the benchmark doesn't grow with number of calls.
+ */
+typedef struct call_times {
+    uint64_t calls; ///< number of calls.
+    uint64_t total; ///< sum of call times in nanoseconds.
+    uint64_t buckets[TIME_BUCKETS]; ///< number of calls in every bucket.
+} call_times;
+
+/** @brief Structure representing state of a running workload.
+ */
+typedef struct bench {
+    uint64_t random; ///< state of the pseudorandom generator.
+    call_times times[BENCH_FUNCTIONS]; ///< call times of every function.
+} bench;
+
+/** @brief Structure describing a workload.
+ */
+typedef struct workload {
+    const char* name; ///< name of the workload.
+    void (*run)(bench*); ///< function running the workload.
+} workload;
+
+/** @brief Gives next pseudorandom number, splitmix64 generator.
+ * @param[in, out] b    - pointer to state of the workload.
+ * @return Pseudorandom 64-bit number.
+ */
+static uint64_t next_random(bench* b) {
+    uint64_t z = (b->random += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/** @brief Gives pseudorandom number smaller than the bound.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in] bound     - positive bound of the number.
+ * @return Pseudorandom number from 0 to bound - 1.
+ */
+static uint32_t random_below(bench* b, uint32_t bound) {
+    return (next_random(b) >> 32) * bound >> 32;
+}
+
+/** @brief Gives current time.
+ * @return Monotonic time in nanoseconds.
+ */
+static uint64_t now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+/** @brief Finds histogram bucket of the time.
+ * @param[in] time      - call time in nanoseconds.
+ * @return Number of the bucket.
+ */
+static uint64_t time_bucket(uint64_t time) {
+    if (time < EXACT_TIMES)
+        return time;
+    int bits = 63 - __builtin_clzll(time); // at least 5
+    uint64_t range = (time >> (bits - 5)) & (EXACT_TIMES - 1);
+    return (bits - 4) * EXACT_TIMES + range;
+}
+
+/** @brief Finds the smallest time falling into the bucket.
+ * @param[in] bucket    - number of the bucket.
+ * @return Time in nanoseconds.
+ */
+static uint64_t bucket_time(uint64_t bucket) {
+    if (bucket < EXACT_TIMES)
+        return bucket;
+    int bits = bucket / EXACT_TIMES + 4;
+    return (EXACT_TIMES + bucket % EXACT_TIMES) << (bits - 5);
+}
+
+/** @brief Counts call of the function which started at given time.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in] function  - called function,
+ * @param[in] start     - time before the call.
+ */
+static void count_call(bench* b, enum bench_function function,
+                       uint64_t start) {
+    uint64_t time = now() - start;
+    call_times* times = &b->times[function];
+    times->calls++;
+    times->total += time;
+    times->buckets[time_bucket(time)]++;
+}
+
+/** @brief Measures gamma_move call.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] player    - number of player performing the move,
+ * @param[in] x         - horizontal position on board,
+ * @param[in] y         - vertical position on board.
+ * @return Result of gamma_move.
+ */
+static bool timed_move(bench* b, gamma_t* g, uint32_t player,
+                       uint32_t x, uint32_t y) {
+    uint64_t start = now();
+    bool result = gamma_move(g, player, x, y);
+    count_call(b, BENCH_MOVE, start);
+    return result;
+}
+
+/** @brief Measures gamma_golden_move call.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] player    - number of player performing the move,
+ * @param[in] x         - horizontal position on board,
+ * @param[in] y         - vertical position on board.
+ * @return Result of gamma_golden_move.
+ */
+static bool timed_golden_move(bench* b, gamma_t* g, uint32_t player,
+                              uint32_t x, uint32_t y) {
+    uint64_t start = now();
+    bool result = gamma_golden_move(g, player, x, y);
+    count_call(b, BENCH_GOLDEN_MOVE, start);
+    return result;
+}
+
+/** @brief Measures gamma_golden_possible call.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] player    - number of the player.
+ * @return Result of gamma_golden_possible.
+ */
+static bool timed_golden_possible(bench* b, gamma_t* g, uint32_t player) {
+    uint64_t start = now();
+    bool result = gamma_golden_possible(g, player);
+    count_call(b, BENCH_GOLDEN_POSSIBLE, start);
+    return result;
+}
+
+/** @brief Measures gamma_busy_fields and gamma_free_fields calls.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] player    - number of the player.
+ * @return Sum of results, so calls can't be optimised away.
+ */
+static uint64_t timed_fields(bench* b, gamma_t* g, uint32_t player) {
+    uint64_t start = now();
+    uint64_t result = gamma_busy_fields(g, player);
+    count_call(b, BENCH_BUSY_FIELDS, start);
+    start = now();
+    result += gamma_free_fields(g, player);
+    count_call(b, BENCH_FREE_FIELDS, start);
+    return result;
+}
+
+/** @brief Measures gamma_undo call.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in, out] g    - pointer to structure holding game status.
+ * @return Result of gamma_undo.
+ */
+static bool timed_undo(bench* b, gamma_t* g) {
+    uint64_t start = now();
+    bool result = gamma_undo(g);
+    count_call(b, BENCH_UNDO, start);
+    return result;
+}
+
+/** @brief Measures gamma_board call.
+ * @param[in, out] b    - pointer to state of the workload,
+ * @param[in, out] g    - pointer to structure holding game status.
+ * @return True if the board was rendered.
+ */
+static bool timed_board(bench* b, gamma_t* g) {
+    uint64_t start = now();
+    char* board = gamma_board(g);
+    count_call(b, BENCH_BOARD, start);
+    free(board);
+    return board != NULL;
+}
+
+/** @brief Creates a game, exits if it can't be created.
+ * @param[in] width     - width of the board,
+ * @param[in] height    - height of the board,
+ * @param[in] players   - number of players,
+ * @param[in] areas     - maximum number of areas of a player.
+ * @return Pointer to the game.
+ */
+static gamma_t* new_game(uint32_t width, uint32_t height, uint32_t players,
+                         uint32_t areas) {
+    gamma_t* g = gamma_new(width, height, players, areas);
+    if (g == NULL) {
+        fprintf(stderr, "Failed to create %ux%u game\n", width, height);
+        exit(1);
+    }
+    return g;
+}
+
+/** @brief Random moves of few players filling a big board.
+ * Queries about fields are asked between moves.
+ * @param[in, out] b    - pointer to state of the workload.
+ */
+static void random_fill(bench* b) {
+    uint32_t size = 1024, players = 8;
+    gamma_t* g = new_game(size, size, players, 64);
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < 2000000; i++) {
+        uint32_t player = 1 + random_below(b, players);
+        timed_move(b, g, player, random_below(b, size),
+                   random_below(b, size));
+        if (i % 16 == 0)
+            sum += timed_fields(b, g, player);
+    }
+    if (sum == 0)
+        fprintf(stderr, "No fields counted\n");
+    gamma_delete(g);
+}
+
+/** @brief Areas joined into one snake.
+ * Every other row is taken first, each becoming a separate area. Then rows
+ * are joined at alternating ends, so every move merges two long areas.
+ * @param[in, out] b    - pointer to state of the workload.
+ */
+static void snake(bench* b) {
+    uint32_t size = 1024;
+    gamma_t* g = new_game(size, size, 2, size);
+    for (uint32_t y = 0; y < size; y += 2)
+        for (uint32_t x = 0; x < size; x++)
+            timed_move(b, g, 1, x, y);
+    for (uint32_t y = 1; y < size; y += 2)
+        timed_move(b, g, 1, y % 4 == 1 ? size - 1 : 0, y);
+    for (uint32_t i = 0; i < 64; i++)
+        timed_golden_possible(b, g, 2);
+    gamma_delete(g);
+}
+
+/** @brief Areas of a spiral joined one by one.
+ * Fields are visited along a spiral from the edge to the centre. Every
+ * other field is taken first, then the gaps are filled merging areas.
+ * @param[in, out] b    - pointer to state of the workload.
+ */
+static void spiral(bench* b) {
+    uint32_t size = 1024;
+    uint64_t fields = size * (uint64_t)size;
+    uint32_t* xs = malloc(fields * sizeof(uint32_t));
+    uint32_t* ys = malloc(fields * sizeof(uint32_t));
+    if (xs == NULL || ys == NULL) {
+        fprintf(stderr, "Failed to allocate spiral\n");
+        exit(1);
+    }
+    uint64_t count = 0;
+    uint32_t left = 0, bottom = 0, right = size - 1, top = size - 1;
+    while (left <= right && bottom <= top) {
+        for (uint32_t x = left; x <= right; x++, count++)
+            xs[count] = x, ys[count] = bottom;
+        for (uint32_t y = bottom + 1; y <= top; y++, count++)
+            xs[count] = right, ys[count] = y;
+        if (bottom < top)
+            for (uint32_t x = right; x-- > left; count++)
+                xs[count] = x, ys[count] = top;
+        if (left < right)
+            for (uint32_t y = top; --y > bottom; count++)
+                xs[count] = left, ys[count] = y;
+        left++, bottom++, right--, top--;
+    }
+    gamma_t* g = new_game(size, size, 1, size * size);
+    for (uint64_t i = 0; i < count; i += 2)
+        timed_move(b, g, 1, xs[i], ys[i]);
+    for (uint64_t i = 1; i < count; i += 2)
+        timed_move(b, g, 1, xs[i], ys[i]);
+    free(xs);
+    free(ys);
+    gamma_delete(g);
+}
+
+/** @brief Golden moves on filled small boards.
+ * Every golden move is undone, so players can try them again.
+ * @param[in, out] b    - pointer to state of the workload.
+ */
+static void golden(bench* b) {
+    uint32_t size = 64, players = 16;
+    for (uint32_t game = 0; game < 50; game++) {
+        gamma_t* g = new_game(size, size, players, 32);
+        if (!gamma_journal(g, true)) {
+            fprintf(stderr, "Failed to start journal\n");
+            exit(1);
+        }
+        for (uint32_t i = 0; i < 4 * size * size; i++)
+            timed_move(b, g, 1 + random_below(b, players),
+                       random_below(b, size), random_below(b, size));
+        timed_board(b, g);
+        for (uint32_t i = 0; i < 4000; i++) {
+            uint32_t player = 1 + random_below(b, players);
+            timed_golden_possible(b, g, player);
+            if (timed_golden_move(b, g, player, random_below(b, size),
+                                  random_below(b, size)))
+                timed_undo(b, g);
+        }
+        gamma_delete(g);
+    }
+}
+
+/** @brief Golden moves splitting a snake on a small board.
+ * The only field of player 2 lies between two rows of the snake of player 1,
+ * taking any of its neighbours would split the snake, so every golden move
+ * and check searches the snake.
+ * @param[in, out] b    - pointer to state of the workload.
+ */
+static void small_snake(bench* b) {
+    uint32_t size = 64;
+    gamma_t* g = new_game(size, size, 2, 1);
+    // the snake is taken along its path, as a player can have one area
+    for (uint32_t y = 0; y < size; y++) {
+        if (y % 2 == 1)
+            timed_move(b, g, 1, y % 4 == 1 ? size - 1 : 0, y);
+        else
+            for (uint32_t i = 0; i < size; i++)
+                timed_move(b, g, 1, y % 4 == 0 ? i : size - 1 - i, y);
+    }
+    timed_move(b, g, 2, size / 2, size / 2 + 1);
+    for (uint32_t i = 0; i < 100000; i++) {
+        timed_golden_possible(b, g, 2);
+        timed_golden_move(b, g, 2, size / 2, size / 2 + 2 * (i % 2));
+    }
+    gamma_delete(g);
+}
+
+/** @brief Random moves of thousands of players.
+ * @param[in, out] b    - pointer to state of the workload.
+ */
+static void many_players(bench* b) {
+    uint32_t size = 512, players = 4096;
+    gamma_t* g = new_game(size, size, players, 2);
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < 1000000; i++) {
+        uint32_t player = 1 + random_below(b, players);
+        timed_move(b, g, player, random_below(b, size),
+                   random_below(b, size));
+        if (i % 16 == 0)
+            sum += timed_fields(b, g, player);
+    }
+    for (uint32_t i = 0; i < 256; i++)
+        timed_golden_possible(b, g, 1 + random_below(b, players));
+    if (sum == 0)
+        fprintf(stderr, "No fields counted\n");
+    gamma_delete(g);
+}
+
+/** @brief Moves clustered around random points of a huge board.
+ * @param[in, out] b    - pointer to state of the workload.
+ */
+static void huge_sparse(bench* b) {
+    uint32_t size = UINT32_MAX, players = 16, spread = 64;
+    gamma_t* g = new_game(size, size, players, 1000);
+    for (uint32_t cluster = 0; cluster < 1000; cluster++) {
+        uint32_t x = random_below(b, size - spread);
+        uint32_t y = random_below(b, size - spread);
+        for (uint32_t i = 0; i < 1000; i++)
+            timed_move(b, g, 1 + random_below(b, players),
+                       x + random_below(b, spread),
+                       y + random_below(b, spread));
+    }
+    for (uint32_t i = 0; i < 16; i++)
+        timed_golden_possible(b, g, 1 + random_below(b, players));
+    gamma_delete(g);
+}
+
+/** @brief Every workload of the benchmark. */
+static const workload workloads[] = {
+    {"random_fill", random_fill},
+    {"snake", snake},
+    {"spiral", spiral},
+    {"golden", golden},
+    {"small_snake", small_snake},
+    {"many_players", many_players},
+    {"huge_sparse", huge_sparse}
+};
+
+/** @brief Number of workloads. */
+#define WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+/** @brief Finds the smallest time not exceeded by given part of calls.
+ * @param[in] times     - call times of the function,
+ * @param[in] fraction  - part of calls, from 0 to 1.
+ * @return Time in nanoseconds.
+ */
+static uint64_t percentile(const call_times* times, double fraction) {
+    uint64_t wanted = fraction * times->calls, seen = 0;
+    for (uint64_t i = 0; i < TIME_BUCKETS; i++) {
+        seen += times->buckets[i];
+        if (seen > wanted)
+            return bucket_time(i);
+    }
+    return bucket_time(TIME_BUCKETS - 1);
+}
+
+/** @brief Runs the workload and writes its results.
+ * @param[in] w         - the workload,
+ * @param[in] seed      - seed of the pseudorandom generator.
+ */
+static void run_workload(const workload* w, uint64_t seed) {
+    bench* b = calloc(1, sizeof(bench));
+    if (b == NULL) {
+        fprintf(stderr, "Failed to allocate memory\n");
+        exit(1);
+    }
+    b->random = seed;
+    w->run(b);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    for (int i = 0; i < BENCH_FUNCTIONS; i++) {
+        call_times* times = &b->times[i];
+        if (times->calls == 0)
+            continue;
+        double total = times->total > 0 ? times->total : 1;
+        printf("%s\t%s\t%lu\t%.0f\t%lu\t%lu\t%lu\t%ld\n", w->name,
+               function_names[i], times->calls, times->calls * 1e9 / total,
+               percentile(times, 0.5), percentile(times, 0.99),
+               percentile(times, 0.999), usage.ru_maxrss);
+    }
+    free(b);
+}
+
+/** @brief Runs the workload in a separate process.
+ * @param[in] w         - the workload,
+ * @param[in] seed      - seed of the pseudorandom generator.
+ * @return True if the workload finished successfully.
+ */
+static bool run_process(const workload* w, uint64_t seed) {
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0)
+        return false; // failed to create process
+    if (child == 0) {
+        run_workload(w, seed);
+        exit(fflush(stdout) == 0 ? 0 : 1);
+    }
+    int status;
+    if (waitpid(child, &status, 0) != child)
+        return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/** @brief Main benchmark function.
+ * Runs given workloads, every one if none is given.
+ * @param[in] argc  - number of arguments,
+ * @param[in] argv  - seed and names of workloads.
+ * @return 0 if every workload finished, 1 otherwise.
+ */
+int main(int argc, char* argv[]) {
+    uint64_t seed = DEFAULT_SEED;
+    char* end = NULL;
+    if (argc > 1)
+        seed = strtoull(argv[1], &end, 10);
+    if (argc > 1 && (*argv[1] == '\0' || *end != '\0')) {
+        fprintf(stderr, "Usage: %s [seed [workload...]]\n", argv[0]);
+        return 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        bool found = false;
+        for (size_t k = 0; k < WORKLOADS; k++)
+            found = found || strcmp(argv[i], workloads[k].name) == 0;
+        if (!found) {
+            fprintf(stderr, "Unknown workload %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf("workload\tfunction\tcalls\tops_per_s\tp50_ns\tp99_ns\t"
+           "p999_ns\tpeak_rss_kb\n");
+    bool success = true;
+    for (size_t k = 0; k < WORKLOADS; k++) {
+        bool chosen = argc <= 2;
+        for (int i = 2; i < argc; i++)
+            chosen = chosen || strcmp(argv[i], workloads[k].name) == 0;
+        if (chosen && !run_process(&workloads[k], seed)) {
+            fprintf(stderr, "Workload %s failed\n", workloads[k].name);
+            success = false;
+        }
+    }
+    return success ? 0 : 1;
+}
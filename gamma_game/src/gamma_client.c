@@ -0,0 +1,179 @@
+/** @file
+ * Client of gamma server.
+ * Usage: gamma_client socket_path session
+ *
+ * Sends standard input as commands of the session and writes answers on
+ * standard output and errors on standard error output, like batch mode.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "output_writer.h"
+
+/** @brief Size of buffers for copying data. */
+#define COPY_SIZE (1 << 16)
+
+/** @brief Beginning of error lines sent by the server. */
+#define ERROR_PREFIX "ERROR "
+
+/** @brief Connects to the server and attaches to the session.
+ * @param[in] socket_path   - path of the server socket,
+ * @param[in] name          - name of the session.
+ * @return Descriptor of the connection or -1.
+ */
+static int connect_session(const char* socket_path, const char* name) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+        return -1; // path too long
+    strcpy(address.sun_path, socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    output_writer writer;
+    open_writer(&writer, fd);
+    write_text(&writer, "S ", 2);
+    write_text(&writer, name, strlen(name));
+    write_text(&writer, "\n", 1);
+    if (!close_writer(&writer)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** @brief Structure representing output of the client.
+ * Lines starting with ERROR_PREFIX are errors, other lines are answers.
+ * Beginning of a line is kept until it is known which one it is.
+ */
+typedef struct client_output {
+    output_writer answers; ///< writer of answers.
+    output_writer errors; ///< writer of errors.
+    char start[sizeof(ERROR_PREFIX)]; ///< kept beginning of a line.
+    size_t start_size; ///< number of kept characters.
+    bool line_start; ///< if beginning of a line is kept.
+    bool in_error; ///< if current line is an error.
+} client_output;
+
+/** @brief Writes part of a line to answers or errors.
+ * Errors are written immediately after answers given before them.
+ * @param[in, out] output   - pointer to output of the client,
+ * @param[in] data          - characters of the line,
+ * @param[in] size          - number of characters.
+ */
+static void write_part(client_output* output, const char* data, size_t size) {
+    if (output->in_error) {
+        flush_writer(&output->answers);
+        write_text(&output->errors, data, size);
+        flush_writer(&output->errors);
+    }
+    else {
+        write_text(&output->answers, data, size);
+    }
+}
+
+/** @brief Splits received text into answers and errors.
+ * @param[in, out] output   - pointer to output of the client,
+ * @param[in] data          - received characters,
+ * @param[in] size          - number of received characters.
+ */
+static void split_output(client_output* output, const char* data,
+                         size_t size) {
+    size_t prefix = strlen(ERROR_PREFIX);
+    while (size > 0) {
+        if (output->line_start) {
+            char character = *data++;
+            size--;
+            output->start[output->start_size++] = character;
+            if (output->start_size < prefix && character != '\n')
+                continue; // not known yet
+            output->in_error = output->start_size == prefix &&
+                memcmp(output->start, ERROR_PREFIX, prefix) == 0;
+            write_part(output, output->start, output->start_size);
+            output->line_start = character == '\n';
+            output->start_size = 0;
+            continue;
+        }
+        const char* end = memchr(data, '\n', size);
+        size_t length = end == NULL ? size : (size_t)(end - data) + 1;
+        write_part(output, data, length);
+        output->line_start = end != NULL;
+        data += length;
+        size -= length;
+    }
+}
+
+/** @brief Main client function.
+ * @param[in] argc  - number of arguments,
+ * @param[in] argv  - socket path and session name.
+ * @return 0 if all answers were received, 1 otherwise.
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s socket_path session\n", argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    int fd = connect_session(argv[1], argv[2]);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to connect to %s\n", argv[1]);
+        return 1;
+    }
+    char* buffer = malloc(COPY_SIZE);
+    if (buffer == NULL)
+        return 1;
+    client_output output = {.start_size = 0, .line_start = true};
+    open_writer(&output.answers, STDOUT_FILENO);
+    open_writer(&output.errors, STDERR_FILENO);
+
+    bool sending = true, failed = false;
+    while (true) {
+        struct pollfd fds[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        if (poll(fds, sending ? 2 : 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            failed = true;
+            break;
+        }
+        if (sending && fds[1].revents != 0) {
+            ssize_t result = read(STDIN_FILENO, buffer, COPY_SIZE);
+            if (result > 0) {
+                output_writer request = {.fd = fd};
+                write_text(&request, buffer, result); // unbuffered
+                failed = failed || request.failed;
+            }
+            if (result == 0 || (result < 0 && errno != EINTR)) {
+                sending = false;
+                shutdown(fd, SHUT_WR); // server answers the rest and closes
+            }
+        }
+        if (fds[0].revents != 0) {
+            ssize_t result = read(fd, buffer, COPY_SIZE);
+            if (result > 0)
+                split_output(&output, buffer, result);
+            if (result == 0 || (result < 0 && errno != EINTR))
+                break; // server closed the connection
+        }
+    }
+    close(fd);
+    free(buffer);
+    if (output.start_size > 0) // unfinished line at the end
+        write_part(&output, output.start, output.start_size);
+    bool written = close_writer(&output.errors);
+    written = close_writer(&output.answers) && written;
+    return written && !failed ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+/** @file
+ * Converter between text and binary protocol of batch mode.
+ * Usage:
+ * - gamma_convert -b   text commands into binary commands,
+ * - gamma_convert -t   binary commands into text commands,
+ * - gamma_convert -a   binary answers into text answers and errors.
+ *
+ * Input is read from standard input and written to standard output.
+ * Comments are kept as records doing nothing, so binary records have
+ * the same numbers as text lines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gamma.h"
+#include "batch_mode.h"
+#include "binary_mode.h"
+#include "line_reader.h"
+#include "output_writer.h"
+#include "stats.h"
+
+/** @brief Header of binary commands, text command starting binary protocol. */
+#define BINARY_HEADER "X\n"
+
+/** @brief Converts text commands into binary records.
+ * Lines which are not commands in any moment of the game become invalid
+ * records.
+ * @param[in, out] reader   - reader of the input,
+ * @param[in, out] writer   - writer of the output.
+ */
+static void text_to_binary(line_reader* reader, output_writer* writer) {
+    char* line;
+    size_t length;
+    uint32_t args[4];
+    command my_command = {0, args, 0, NULL};
+    write_text(writer, BINARY_HEADER, strlen(BINARY_HEADER));
+    while (next_line(reader, &line, &length)) {
+        binary_command record;
+        memset(&record, 0, sizeof(record));
+        if (parse_line(line, length, &my_command, true) ||
+            parse_line(line, length, &my_command, false)) {
+            record.command_type = (uint8_t)my_command.command_type;
+            record.arguments_number = my_command.arguments_number;
+            memcpy(record.args, args, sizeof(args));
+            if (my_command.path != NULL) // paths can't be written in records
+                record.command_type = BINARY_INVALID;
+        }
+        write_text(writer, (const char*)&record, sizeof(record));
+    }
+}
+
+/** @brief Converts binary records into text commands.
+ * Invalid records become lines which are never commands.
+ * @param[in, out] reader   - reader of the input,
+ * @param[in, out] writer   - writer of the output.
+ */
+static void binary_to_text(line_reader* reader, output_writer* writer) {
+    char* data;
+    size_t length;
+    if (next_bytes(reader, &data, strlen(BINARY_HEADER)) !=
+        strlen(BINARY_HEADER) || memcmp(data, BINARY_HEADER, strlen(BINARY_HEADER)))
+        return; // input doesn't start with binary protocol
+    while ((length = next_bytes(reader, &data, sizeof(binary_command))) > 0) {
+        binary_command record;
+        memcpy(&record, data, length);
+        char command_type = (char)record.command_type;
+        if (length < sizeof(record) || record.arguments_number > 4 ||
+            command_type <= ' ' || command_type > '~') {
+            write_text(writer, "?\n", 2);
+            continue; // invalid record
+        }
+        write_text(writer, &command_type, 1);
+        for (int i = 0; i < record.arguments_number; i++) {
+            write_text(writer, " ", 1);
+            write_number(writer, record.args[i]);
+        }
+        write_text(writer, "\n", 1);
+    }
+}
+
+/** @brief Converts binary answers into text answers and errors.
+ * @param[in, out] reader   - reader of the input,
+ * @param[in, out] answers  - writer of text answers,
+ * @param[in, out] errors   - writer of text errors.
+ */
+static void answers_to_text(line_reader* reader, output_writer* answers,
+                            output_writer* errors) {
+    char* data;
+    while (next_bytes(reader, &data, sizeof(binary_answer)) ==
+           sizeof(binary_answer)) {
+        binary_answer answer;
+        memcpy(&answer, data, sizeof(answer));
+        if (answer.answer_type == ANSWER_VALUE) {
+            write_number(answers, answer.value);
+            write_text(answers, "\n", 1);
+        }
+        if (answer.answer_type == ANSWER_OK) {
+            write_text(answers, "OK ", 3);
+            write_number(answers, answer.record);
+            write_text(answers, "\n", 1);
+        }
+        if (answer.answer_type == ANSWER_ERROR) {
+            write_text(errors, "ERROR ", 6);
+            write_number(errors, answer.record);
+            write_text(errors, "\n", 1);
+        }
+        if (answer.answer_type == ANSWER_MOVE ||
+            answer.answer_type == ANSWER_GOLDEN_MOVE) {
+            write_number(answers, (uint32_t)answer.value);
+            write_text(answers, " ", 1);
+            write_number(answers, answer.value >> 32);
+            write_text(answers, answer.answer_type == ANSWER_MOVE ?
+                       " 0\n" : " 1\n", 3);
+        }
+        if (answer.answer_type >= ANSWER_STAT &&
+            answer.answer_type < ANSWER_STAT + STAT_COUNTERS) {
+            const char* name = stat_names[answer.answer_type - ANSWER_STAT];
+            write_text(answers, name, strlen(name));
+            write_text(answers, " ", 1);
+            write_number(answers, answer.value);
+            write_text(answers, "\n", 1);
+        }
+        if (answer.answer_type == ANSWER_BOARD) {
+            uint64_t left = answer.value;
+            while (left > 0) {
+                size_t length = next_bytes(reader, &data, left);
+                if (length == 0)
+                    return; // board cut at the end of input
+                write_text(answers, data, length);
+                left -= length;
+            }
+        }
+    }
+}
+
+/** @brief Main converter function.
+ * @param[in] argc  - number of arguments,
+ * @param[in] argv  - arguments, the option chooses direction.
+ * @return 0 on success, 1 on incorrect usage or error.
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2 || (strcmp(argv[1], "-b") != 0 &&
+        strcmp(argv[1], "-t") != 0 && strcmp(argv[1], "-a") != 0)) {
+        fprintf(stderr, "Usage: %s -b|-t|-a\n", argv[0]);
+        return 1;
+    }
+    line_reader reader;
+    if (!open_reader(&reader, STDIN_FILENO))
+        return 1;
+    allow_read_ahead(&reader);
+    output_writer answers, errors;
+    open_writer(&answers, STDOUT_FILENO);
+    open_writer(&errors, STDERR_FILENO);
+
+    if (strcmp(argv[1], "-b") == 0)
+        text_to_binary(&reader, &answers);
+    else if (strcmp(argv[1], "-t") == 0)
+        binary_to_text(&reader, &answers);
+    else
+        answers_to_text(&reader, &answers, &errors);
+
+    close_reader(&reader);
+    bool written = close_writer(&errors);
+    written = close_writer(&answers) && written;
+    return written ? 0 : 1;
+}
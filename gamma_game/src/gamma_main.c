@@ -8,18 +8,41 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "borders.h"
 #include "fau.h"
 #include "gamma.h"
 #include "batch_mode.h"
 #include "inter_mode.h"
+#include "line_reader.h"
+#include "binary_mode.h"
+#include "pipeline.h"
 
-/** @brief Prints ERROR and line number for standard error output.
- * @param[in] line_number   - line where the error occured.
+/** @brief Checks if answers and errors should be kept in order.
+ * It is needed when both outputs go to the same file or terminal,
+ * or when GAMMA_STRICT_OUTPUT environment variable is set.
+ * @return True if order between outputs should be kept.
  */
-static void print_error(int line_number) {
-    fprintf(stderr, "ERROR %d\n", line_number);
+static bool strict_output() {
+    if (getenv("GAMMA_STRICT_OUTPUT") != NULL)
+        return true;
+    struct stat out_stat, err_stat;
+    return fstat(STDOUT_FILENO, &out_stat) == 0 &&
+           fstat(STDERR_FILENO, &err_stat) == 0 &&
+           out_stat.st_dev == err_stat.st_dev &&
+           out_stat.st_ino == err_stat.st_ino;
+}
+
+/** @brief Checks if batch mode should be run on separate threads.
+ * Parsing, running and writing are pipelined when GAMMA_PIPELINE
+ * environment variable is set and commands are not typed by user.
+ * @param[in] typed_input   - if commands are typed by user.
+ * @return True if batch mode should be pipelined.
+ */
+static bool pipelined_batch(bool typed_input) {
+    return !typed_input && getenv("GAMMA_PIPELINE") != NULL;
 }
 
 /** @brief Allocates memory for reading commands and returns pointer to it.
@@ -41,36 +64,66 @@ static command* prepare_command_reader() {
  * Reads input and activates batch or interactive mode if called.
  */
 int main() {
-    bool batch_mode = false, inter_mode = false;
+    bool batch_mode = false, inter_mode = false, binary_mode = false;
     char* input_line = NULL;
     size_t input_line_size;
     gamma_t* g = NULL;
     int line_number = 0;
     command* my_command = prepare_command_reader();
+    line_reader reader;
+    if (!open_reader(&reader, STDIN_FILENO))
+        exit(1);
+    batch_output output;
+    open_batch_output(&output, STDOUT_FILENO, STDERR_FILENO, strict_output());
+    // commands typed by user are answered immediately
+    bool typed_input = isatty(STDIN_FILENO);
 
     // Program will read line after line of input till input file ends
     // or interactive mode starts
-    while(!inter_mode && getline(&input_line, &input_line_size, stdin) != EOF) {
+    while(!inter_mode && !binary_mode &&
+          next_line(&reader, &input_line, &input_line_size)) {
         bool proper_line = true, proper_command = true;
         line_number++;
-        proper_line = parse_line(input_line, my_command, batch_mode);
+        proper_line = parse_line(input_line, input_line_size, my_command,
+                                 batch_mode);
         // proper_line means that input line can be interpreted as some command
 
         if (proper_line && my_command->command_type != '#') {
             // in this point my_command is a valid command, not a comment
-            proper_command = run_command(my_command, &g, line_number);
+            proper_command = run_command(my_command, &g, line_number,
+                                         &output);
             if (proper_command) {
                 // the command was fully valid and ERROR will NOT be printed
-                if (my_command->command_type == 'B')
+                if (my_command->command_type == 'B' ||
+                    my_command->command_type == 'L') {
                     batch_mode = true;
+                    // interactive mode can't start, rest of input is batch
+                    allow_read_ahead(&reader);
+                    // rest of input is run by the pipeline if it starts
+                    if (pipelined_batch(typed_input) &&
+                        run_pipeline(&reader, g, line_number, &output))
+                        break;
+                }
                 if (my_command->command_type == 'I')
                     inter_mode = true;
+                if (my_command->command_type == 'X') {
+                    binary_mode = true;
+                    allow_read_ahead(&reader);
+                }
             }
         }
         if (!proper_line || !proper_command)
-            print_error(line_number);
+            print_error(&output, line_number);
+        if (typed_input)
+            flush_batch_output(&output);
+    }
+    if (binary_mode) { // rest of input consists of binary records
+        flush_batch_output(&output);
+        output.binary = true;
+        run_binary(&reader, &output);
     }
-    free(input_line);
+    close_reader(&reader);
+    close_batch_output(&output);
     free(my_command->args);
     free(my_command);
 
@@ -0,0 +1,38 @@
+/** @file
+ * Gamma server main file.
+ * Usage: gamma_server socket_path [workers]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "server.h"
+
+/** @brief Maximum number of worker threads. */
+#define MAX_WORKERS 1024
+
+/** @brief Main gamma server function.
+ * Runs the server with given number of workers, by default one for every
+ * processor.
+ * @param[in] argc  - number of arguments,
+ * @param[in] argv  - socket path and optional number of workers.
+ * @return 0 after the server was stopped, 1 if it couldn't be started.
+ */
+int main(int argc, char* argv[]) {
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc == 3)
+        workers = strtol(argv[2], NULL, 10);
+    if (argc < 2 || argc > 3 || workers < 1 || workers > MAX_WORKERS) {
+        fprintf(stderr, "Usage: %s socket_path [workers]\n", argv[0]);
+        return 1;
+    }
+    if (!run_server(argv[1], (int)workers)) {
+        fprintf(stderr, "Failed to start server at %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
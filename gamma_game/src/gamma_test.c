@@ -1,3 +1,6 @@
+/* Deskryptory plików tymczasowych są potrzebne do testu wypisywania planszy. */
+#define _POSIX_C_SOURCE 200809L
+
 /* Ten plik włączamy na początku i dwa razy, aby sprawdzić, czy zawiera
  * wszystko, co jest potrzebne. */
 #include "gamma.h"
@@ -14,6 +17,22 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Wewnętrzne nagłówki silnika pozwalają sprawdzić liczniki graczy. */
+#include "board.h"
+#include "borders.h"
+#include "field_set.h"
+#include "golden.h"
+#include "planes.h"
+#include "batch_mode.h"
+#include "binary_mode.h"
+
+/* Programy uruchamiane przez testy są w katalogu wskazanym przez CMake. */
+#ifndef GAMMA_BINARY_DIR
+  #define GAMMA_BINARY_DIR "."
+#endif
 
 static void example(void) {
   static const char board[] =
@@ -77,14 +96,670 @@ static void example(void) {
   assert(gamma_busy_fields(g, 2) == 4);
   assert(gamma_free_fields(g, 2) == 10);
 
+  gamma_query queries[] = {{'b', 1, 7}, {'f', 2, 7}, {'q', 1, 7},
+                           {'q', 2, 7}, {'q', 3, 7}, {'x', 1, 7}};
+  assert(gamma_queries(g, queries, 6, 2));
+  assert(queries[0].answer == 5);
+  assert(queries[1].answer == 10);
+  assert(queries[2].answer == 0);
+  assert(queries[3].answer == 0);
+  assert(queries[4].answer == 0);
+  assert(queries[5].answer == 0);
+
   char *p = gamma_board(g);
   assert(p);
   assert(strcmp(p, board) == 0);
   free(p);
 
+  uint64_t legal[100];
+  assert(gamma_legal_moves(g, 1, NULL, 0) == gamma_free_fields(g, 1));
+  uint64_t legal_count = gamma_legal_moves(g, 1, legal, 100);
+  assert(legal_count == gamma_free_fields(g, 1));
+  for (uint64_t i = 0; i < legal_count; i++)
+    assert(board[(9 - legal[i] / 10) * 11 + legal[i] % 10] == '.');
+
+  gamma_t *copy = gamma_clone(g);
+  assert(copy != NULL);
+  assert(gamma_move(copy, 1, 1, 0));
+  assert(gamma_busy_fields(copy, 1) == 6);
+  assert(gamma_busy_fields(g, 1) == 5);
+  p = gamma_board(g);
+  assert(p);
+  assert(strcmp(p, board) == 0);
+  free(p);
+  gamma_delete(copy);
+
+  assert(gamma_journal(g, true));
+  assert(!gamma_undo(g));
+  assert(gamma_move(g, 1, 1, 0));
+  assert(gamma_busy_fields(g, 1) == 6);
+  assert(gamma_undo(g));
+  assert(gamma_busy_fields(g, 1) == 5);
+  assert(gamma_free_fields(g, 1) == 8);
+  p = gamma_board(g);
+  assert(p);
+  assert(strcmp(p, board) == 0);
+  free(p);
+  assert(gamma_redo(g));
+  assert(!gamma_redo(g));
+  assert(gamma_busy_fields(g, 1) == 6);
+
+  assert(gamma_concurrent(g, true));
+  assert(gamma_busy_fields(g, 1) == 6);
+  assert(gamma_undo(g));
+  assert(gamma_busy_fields(g, 1) == 5);
+  assert(gamma_free_fields(g, 1) == 8);
+  p = gamma_board(g);
+  assert(p);
+  assert(strcmp(p, board) == 0);
+  free(p);
+  assert(gamma_redo(g));
+  assert(gamma_busy_fields(g, 1) == 6);
+  assert(gamma_concurrent(g, false));
+
+  uint32_t x, y;
+  bool golden;
+  assert(gamma_suggest_move(g, 2, 10, 2, &x, &y, &golden));
+  if (golden)
+    assert(gamma_golden_move(g, 2, x, y));
+  else
+    assert(gamma_move(g, 2, x, y));
+  assert(gamma_busy_fields(g, 2) == 5);
+
+  gamma_delete(g);
+}
+
+static void ring(void) {
+  static const uint32_t xs[] = {0, 1, 2, 2, 2, 1, 0};
+  static const uint32_t ys[] = {0, 0, 0, 1, 2, 2, 2};
+
+  gamma_t *g = gamma_new(3, 3, 2, 1);
+  assert(g != NULL);
+  for (int i = 0; i < 7; i++)
+    assert(gamma_move(g, 1, xs[i], ys[i]));
+  assert(gamma_move(g, 2, 1, 1));
+  assert(!gamma_golden_possible(g, 2));
+  assert(!gamma_golden_move(g, 2, 1, 0));
+  assert(gamma_move(g, 1, 0, 1));
+  assert(gamma_golden_possible(g, 2));
+  assert(gamma_golden_move(g, 2, 1, 0));
+  assert(gamma_busy_fields(g, 1) == 7);
+  gamma_delete(g);
+}
+
+static void board_write_matches(uint32_t width, uint32_t height) {
+  gamma_t *g = gamma_new(width, height, 2, 1);
+  assert(g != NULL);
+  assert(gamma_move(g, 1, 0, 0));
+  assert(gamma_move(g, 2, width - 1, height - 1));
+  char *expected = gamma_board(g);
+  assert(expected != NULL);
+  size_t length = strlen(expected);
+
+  FILE *file = tmpfile();
+  assert(file != NULL);
+  assert(gamma_board_write(g, fileno(file)));
+  rewind(file);
+  char *written = malloc(length + 1);
+  assert(written != NULL);
+  assert(fread(written, 1, length + 1, file) == length);
+  assert(memcmp(written, expected, length) == 0);
+  fclose(file);
+  free(written);
+  free(expected);
+  gamma_delete(g);
+}
+
+static void board_write(void) {
+  // rows filling the buffer exactly with their ends of lines
+  board_write_matches(1, 40000);
+  board_write_matches(3, 20000);
+  board_write_matches(15, 5000);
+  board_write_matches(65535, 3);
+}
+
+static void mirror(void *data, const gamma_event *event) {
+  uint32_t *owners = data;
+  if (event->kind == GAMMA_EVENT_OWNER) {
+    assert(owners[event->field] == event->value);
+    owners[event->field] = event->player;
+  }
+}
+
+static void events(void) {
+  uint32_t owners[9] = {0};
+  gamma_t *g = gamma_new(3, 3, 2, 2);
+  assert(g != NULL);
+  assert(gamma_journal(g, true));
+  assert(gamma_listen(g, mirror, owners));
+  assert(gamma_move(g, 1, 0, 0));
+  assert(gamma_move(g, 1, 1, 0));
+  assert(gamma_move(g, 2, 2, 2));
+  assert(!gamma_golden_move(g, 2, 2, 0));
+  assert(gamma_golden_move(g, 2, 1, 0));
+  assert(owners[0] == 1 && owners[1] == 2 && owners[8] == 2);
+  assert(gamma_undo(g));
+  assert(owners[1] == 1);
+  assert(gamma_listen(g, NULL, NULL));
+  assert(gamma_redo(g));
+  assert(owners[1] == 1);
   gamma_delete(g);
 }
 
+// recounts targets of golden moves of every player from the whole board
+static void check_targets(gamma_t *g, uint64_t *safe, uint64_t *risky) {
+  uint32_t players = g->players;
+  memset(safe, 0, (players + 1) * sizeof(uint64_t));
+  memset(risky, 0, (players + 1) * sizeof(uint64_t));
+  for (uint32_t y = 0; y < g->height; y++)
+    for (uint32_t x = 0; x < g->width; x++) {
+      uint64_t field = (uint64_t)y * g->width + x;
+      uint32_t owner = get_owner(g, field);
+      if (owner == 0)
+        continue;
+      bool splits = count_area_groups(g, owner, x, y) > 1;
+      uint32_t neighbours[4];
+      find_distinct_neighbours(g, x, y, neighbours);
+      for (int i = 0; i < 4; i++) {
+        uint32_t player = neighbours[i];
+        if (player == 0 || player == owner)
+          continue;
+        if (!splits) {
+          safe[player]++;
+          continue;
+        }
+        risky[player]++;
+        field_set *set = &g->players_array[player].risky_targets;
+        assert(set->incomplete || field_set_contains(set, field));
+      }
+    }
+  for (uint32_t player = 1; player <= players; player++) {
+    assert(g->players_array[player].golden_targets == safe[player]);
+    field_set *set = &g->players_array[player].risky_targets;
+    assert(set->incomplete || set->size == risky[player]);
+  }
+}
+
+static void golden_targets(void) {
+  srand(2020);
+  for (int game = 0; game < 200; game++) {
+    uint32_t width = 1 + rand() % 12, height = 1 + rand() % 12;
+    uint32_t players = 1 + rand() % 4, areas = 1 + rand() % 5;
+    gamma_t *g = gamma_new(width, height, players, areas);
+    assert(g != NULL);
+    bool journal = game % 2 == 1;
+    assert(!journal || gamma_journal(g, true));
+    uint64_t safe[5], risky[5];
+    for (int i = 0; i < 500; i++) {
+      int kind = rand() % 10;
+      uint32_t player = 1 + rand() % players;
+      uint32_t x = rand() % width, y = rand() % height;
+      if (kind < 7)
+        gamma_move(g, player, x, y);
+      else if (kind < 8 || !journal)
+        gamma_golden_move(g, player, x, y);
+      else if (kind < 9)
+        gamma_undo(g);
+      else
+        gamma_redo(g);
+      check_targets(g, safe, risky);
+    }
+    gamma_delete(g);
+  }
+}
+
+static void planes(void) {
+  srand(2021);
+  for (int game = 0; game < 400; game++) {
+    // small boards get full quickly, so areas often have to be split
+    uint32_t size = game % 8 == 0 ? 64 : 12;
+    uint32_t width = 1 + rand() % size, height = 1 + rand() % size;
+    uint32_t players = 2 + rand() % 3, areas = 1 + rand() % 2;
+    gamma_t *g = gamma_new(width, height, players, areas);
+    gamma_t *generic = gamma_new(width, height, players, areas);
+    assert(g != NULL && generic != NULL);
+    free_planes(generic);
+    assert(g->planes != NULL);
+    // golden moves are undone, so players keep trying them on full boards
+    assert(gamma_journal(g, true) && gamma_journal(generic, true));
+    uint32_t x = 0, y = 0, walker = 1;
+    for (uint64_t i = 0; i < 2 * (uint64_t)width * height; i++) {
+      // walker takes fields next to the previous one, so its areas get
+      // long and wind around fields of other players
+      int step = rand() % 8;
+      if (step == 0)
+        x = (x + 1) % width;
+      else if (step == 1)
+        x = (x + width - 1) % width;
+      else if (step == 2)
+        y = (y + 1) % height;
+      else if (step == 3)
+        y = (y + height - 1) % height;
+      else if (step == 4) {
+        x = rand() % width;
+        y = rand() % height;
+        walker = 1 + rand() % players;
+      }
+      if (rand() % 4 == 0) {
+        // golden move is tried by a player not owning the field
+        uint32_t player = 1 + rand() % players;
+        if (get_owner(g, y * (uint64_t)width + x) == player)
+          player = player % players + 1;
+        bool moved = gamma_golden_move(g, player, x, y);
+        assert(moved == gamma_golden_move(generic, player, x, y));
+        if (moved && rand() % 16 != 0)
+          assert(gamma_undo(g) && gamma_undo(generic));
+      }
+      else
+        assert(gamma_move(g, walker, x, y) ==
+               gamma_move(generic, walker, x, y));
+      for (uint32_t p = 1; p <= players; p++)
+        assert(gamma_golden_possible(g, p) ==
+               gamma_golden_possible(generic, p));
+      char *board = gamma_board(g), *generic_board = gamma_board(generic);
+      assert(board != NULL && generic_board != NULL);
+      assert(strcmp(board, generic_board) == 0);
+      free(board);
+      free(generic_board);
+    }
+    gamma_delete(g);
+    gamma_delete(generic);
+  }
+}
+
+// writes data to the file in the current directory
+static void write_file(const char *name, const char *data, size_t length) {
+  FILE *file = fopen(name, "wb");
+  assert(file != NULL);
+  assert(fwrite(data, 1, length, file) == length);
+  assert(fclose(file) == 0);
+}
+
+// reads the whole file and ends it with '\0', length may be NULL
+static char *read_file(const char *name, size_t *file_length) {
+  FILE *file = fopen(name, "rb");
+  assert(file != NULL);
+  size_t length = 0, capacity = 4096;
+  char *data = malloc(capacity);
+  assert(data != NULL);
+  size_t read;
+  while ((read = fread(data + length, 1, capacity - length - 1, file)) > 0) {
+    length += read;
+    if (capacity - length == 1) {
+      capacity *= 2;
+      data = realloc(data, capacity);
+      assert(data != NULL);
+    }
+  }
+  fclose(file);
+  data[length] = '\0';
+  if (file_length != NULL)
+    *file_length = length;
+  return data;
+}
+
+// checks if the file holds exactly the expected text
+static void check_file(const char *name, const char *expected) {
+  char *data = read_file(name, NULL);
+  assert(strcmp(data, expected) == 0);
+  free(data);
+}
+
+// runs shell command finding programs of the build first
+static int run(const char *command) {
+  char line[1024];
+  int length = snprintf(line, sizeof(line), "PATH='%s':\"$PATH\"; %s",
+                        GAMMA_BINARY_DIR, command);
+  assert(length > 0 && (size_t)length < sizeof(line));
+  return system(line);
+}
+
+static const struct {
+  const char *line;
+  size_t length; // length of the line with '\0', 0 for others
+  bool before_game; // result before starting a batch mode game
+  bool in_game; // result after starting it
+  char type;
+  int arguments_number;
+  uint32_t args[4];
+} parse_cases[] = {
+  {"B 1 2 3 4\n", 0, true, false, 'B', 4, {1, 2, 3, 4}},
+  {"m 1 2 3\n", 0, false, true, 'm', 3, {1, 2, 3}},
+  {"m 1  2\t3 \r\n", 0, false, true, 'm', 3, {1, 2, 3}},
+  {" m 1 2 3\n", 0, false, false, 0, 0, {0}},
+  {"\tB 1 2 3 4\n", 0, false, false, 0, 0, {0}},
+  {"m 1 2 3", 0, false, false, 0, 0, {0}},
+  {"B 1 2 3 4", 0, false, false, 0, 0, {0}},
+  {"b 4294967295\n", 0, false, true, 'b', 1, {UINT32_MAX}},
+  {"b 4294967296\n", 0, false, false, 0, 0, {0}},
+  {"b 99999999999\n", 0, false, false, 0, 0, {0}},
+  {"b 0\n", 0, false, true, 'b', 1, {0}},
+  {"b 01\n", 0, false, false, 0, 0, {0}},
+  {"b -1\n", 0, false, false, 0, 0, {0}},
+  {"m 1 2 3 4\n", 0, false, false, 'm', 4, {1, 2, 3, 4}},
+  {"B 1 2 3 4 5\n", 0, false, false, 0, 0, {0}},
+  {"m1 2 3\n", 0, false, false, 0, 0, {0}},
+  {"m 1 2\0 3\n", 9, false, false, 0, 0, {0}},
+  {"p\n", 0, false, true, 'p', 0, {0}},
+  {"p 1\n", 0, false, false, 'p', 1, {1}},
+  {"X\n", 0, true, false, 'X', 0, {0}},
+  {"L game\n", 0, true, false, 'L', 0, {0}},
+  {"s a b\n", 0, false, false, 0, 0, {0}},
+  {"# m 1 2 3\n", 0, true, true, '#', 0, {0}},
+  {"\n", 0, true, true, '#', 0, {0}},
+};
+
+static void parse(void) {
+  for (size_t i = 0; i < sizeof(parse_cases) / sizeof(parse_cases[0]); i++) {
+    for (int in_game = 0; in_game < 2; in_game++) {
+      char line[32];
+      uint32_t args[4];
+      command my_command = {0, args, 0, NULL};
+      size_t length = parse_cases[i].length;
+      if (length == 0)
+        length = strlen(parse_cases[i].line);
+      memcpy(line, parse_cases[i].line, length);
+      bool expected = in_game ? parse_cases[i].in_game :
+                                parse_cases[i].before_game;
+      assert(parse_line(line, length, &my_command, in_game) == expected);
+      if (parse_cases[i].type == 0)
+        continue; // line isn't a command at all
+      assert(my_command.command_type == parse_cases[i].type);
+      if (my_command.command_type == '#')
+        continue; // comment has no parameters
+      assert(my_command.arguments_number ==
+             parse_cases[i].arguments_number);
+      for (int k = 0; k < my_command.arguments_number; k++)
+        assert(args[k] == parse_cases[i].args[k]);
+      // the same command is checked for the other moment
+      assert(check_command_type(&my_command, !in_game) ==
+             (in_game ? parse_cases[i].before_game :
+                        parse_cases[i].in_game));
+    }
+  }
+}
+
+static void line_numbers(void) {
+  static const char input[] =
+    "B 5 5 2 2\n"
+    "  m 1 0 0\n"
+    "m 1 0 0\n"
+    "b 4294967296\n"
+    "#\n"
+    "\n"
+    "b 4294967295\n"
+    "B 5 5 2 2\n"
+    "m 2 1 1";
+  write_file("lines.txt", input, sizeof(input) - 1);
+  assert(run("gamma < lines.txt > answers.txt 2> errors.txt") == 0);
+  check_file("answers.txt", "OK 1\n1\n0\n");
+  check_file("errors.txt", "ERROR 2\nERROR 4\nERROR 8\nERROR 9\n");
+}
+
+// checks if both files have the same contents
+static void check_same(const char *name, const char *other) {
+  size_t length, other_length;
+  char *data = read_file(name, &length);
+  char *other_data = read_file(other, &other_length);
+  assert(length == other_length && memcmp(data, other_data, length) == 0);
+  free(data);
+  free(other_data);
+}
+
+static void binary_protocol(void) {
+  static const char input[] =
+    "# binary protocol\n"
+    "B 6 6 3 2\n"
+    "m 1 0 0\n"
+    "m 2 1 1\n"
+    "  m 3 2 2\n"
+    "m 3 2 2\n"
+    "g 1 1 1\n"
+    "b 1\n"
+    "f 2\n"
+    "q 3\n"
+    "p\n"
+    "m 1 9 9\n"
+    "B 6 6 3 2\n"
+    "b 4294967296\n"
+    "m 2 5 5\n"
+    "p\n"
+    "q 1";
+  write_file("script.txt", input, sizeof(input) - 1);
+  assert(run("gamma < script.txt > text.txt 2> text_errors.txt") == 0);
+  check_file("text_errors.txt", "ERROR 5\nERROR 13\nERROR 14\nERROR 17\n");
+
+  // records have numbers of lines, so converted answers are the same
+  assert(run("gamma_convert -b < script.txt > commands.bin") == 0);
+  assert(run("gamma < commands.bin > answers.bin 2> errors.txt") == 0);
+  check_file("errors.txt", "");
+  assert(run("gamma_convert -a < answers.bin > binary.txt "
+             "2> binary_errors.txt") == 0);
+  check_same("binary.txt", "text.txt");
+  check_same("binary_errors.txt", "text_errors.txt");
+
+  // the last record cut at the end of input is answered with an error
+  size_t length;
+  char *commands = read_file("commands.bin", &length);
+  size_t records = (length - 2) / sizeof(binary_command);
+  assert(length == 2 + records * sizeof(binary_command) && records == 17);
+  write_file("cut.bin", commands, length - 7);
+  free(commands);
+  assert(run("gamma < cut.bin > cut_answers.bin") == 0);
+  char *answers = read_file("cut_answers.bin", &length);
+  binary_answer last;
+  assert(length >= sizeof(last));
+  memcpy(&last, answers + length - sizeof(last), sizeof(last));
+  assert(last.answer_type == ANSWER_ERROR && last.record == records);
+  free(answers);
+}
+
+static void pipeline(void) {
+  // each player has one possible move when it asks for a suggestion, so
+  // answers don't depend on time of the search
+  static const char start[] =
+    "B 3 1 2 1\n"
+    "m 1 0 0\n"
+    "m 2 2 0\n"
+    "a 1 50\n"
+    "a 2 50\n"
+    "p\n"
+    "m 1 1 0\n"
+    "a 2 50\n";
+  static const char *const lines[] = {
+    "m %u %u 0\n", "g %u %u 0\n", "b %u\n", "f %u\n", "q %u\n",
+    "  m %u %u 0\n", "m %u %u\n", "# comment %u %u\n", "\n", "p\n",
+    "a 3 %u\n", "b 4294967296\n"
+  };
+  // the script is longer than rings of the pipeline
+  size_t capacity = sizeof(start) + 20000 * 32;
+  char *script = malloc(capacity);
+  assert(script != NULL);
+  size_t length = sizeof(start) - 1;
+  memcpy(script, start, length);
+  for (uint32_t i = 0; i < 20000; i++) {
+    const char *format = lines[i * 7 % (sizeof(lines) / sizeof(lines[0]))];
+    length += snprintf(script + length, capacity - length, format,
+                       1 + i % 2, i / 2 % 3);
+  }
+  write_file("pipeline.txt", script, length);
+  free(script);
+
+  assert(run("unset GAMMA_PIPELINE; gamma < pipeline.txt > serial.txt "
+             "2> serial_errors.txt") == 0);
+  assert(run("GAMMA_PIPELINE=1 gamma < pipeline.txt > pipelined.txt "
+             "2> pipelined_errors.txt") == 0);
+  check_same("pipelined.txt", "serial.txt");
+  check_same("pipelined_errors.txt", "serial_errors.txt");
+  // both streams in one file keep the order of lines too
+  assert(run("unset GAMMA_PIPELINE; gamma < pipeline.txt > serial.txt "
+             "2>&1") == 0);
+  assert(run("GAMMA_PIPELINE=1 gamma < pipeline.txt > pipelined.txt "
+             "2>&1") == 0);
+  check_same("pipelined.txt", "serial.txt");
+}
+
+static void strict_output(void) {
+  static const char input[] =
+    "B 3 2 2 2\n"
+    "  m 1 0 0\n"
+    "m 1 0 0\n"
+    "p\n"
+    "b 4294967296\n"
+    "m 2 2 1\n"
+    "B 3 2 2 2\n"
+    "p\n"
+    "f 1\n"
+    "q 2";
+  static const char output[] =
+    "OK 1\n"
+    "ERROR 2\n"
+    "1\n"
+    "...\n"
+    "1..\n"
+    "ERROR 5\n"
+    "1\n"
+    "ERROR 7\n"
+    "..2\n"
+    "1..\n"
+    "4\n"
+    "ERROR 10\n";
+  static const char *const commands[] = {
+    "gamma < strict.txt > both.txt 2>&1",
+    "gamma < strict.txt >> both.txt 2>> both.txt",
+    "gamma < strict.txt 2>&1 | cat > both.txt",
+    "GAMMA_STRICT_OUTPUT=1 gamma < strict.txt > both.txt 2>&1",
+    "GAMMA_PIPELINE=1 gamma < strict.txt > both.txt 2>&1",
+  };
+  write_file("strict.txt", input, sizeof(input) - 1);
+  // answers and errors written to the same file are in order of lines
+  for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+    write_file("both.txt", "", 0);
+    assert(run(commands[i]) == 0);
+    check_file("both.txt", output);
+  }
+}
+
+// appends the text repeated given times, returns the new end
+static char *repeat(char *end, const char *text, int times) {
+  for (int i = 0; i < times; i++)
+    end = stpcpy(end, text);
+  return end;
+}
+
+// waits up to ten seconds until the file is created or removed
+static void wait_for_file(const char *name, bool exists) {
+  struct timespec pause = {0, 10000000};
+  for (int i = 0; i < 1000 && (access(name, F_OK) == 0) != exists; i++)
+    nanosleep(&pause, NULL);
+  assert((access(name, F_OK) == 0) == exists);
+}
+
+static void server(void) {
+  static const char one_input[] =
+    "B 3 2 2 2\n"
+    "I\n"
+    "m 1 0 0\n"
+    "X\n"
+    "s one.bin\n"
+    "L one.bin\n"
+    "p\n"
+    "m 2 2 1\n"
+    "f 1\n";
+  static const char one_output[] =
+    "OK 1\n"
+    "ERROR 2\n"
+    "1\n"
+    "ERROR 4\n"
+    "ERROR 5\n"
+    "ERROR 6\n"
+    "...\n"
+    "1..\n"
+    "1\n"
+    "4\n";
+  static const char two_input[] =
+    "L two.bin\n"
+    "B 4 1 2 1\n"
+    "m 1 0 0\n"
+    "# comment\n"
+    "m 2 3 0\n"
+    "I\n"
+    "m 1 2 0\n"
+    "b 1\n"
+    "p\n"
+    "s two.bin\n";
+  static const char two_output[] =
+    "ERROR 1\n"
+    "OK 2\n"
+    "1\n"
+    "1\n"
+    "ERROR 6\n"
+    "0\n"
+    "1\n"
+    "1..2\n"
+    "ERROR 10\n";
+  // many boards at the end keep both sessions running at the same time
+  int boards = 2000;
+  char *input = malloc(sizeof(one_input) + sizeof(two_input) + 2 * boards);
+  char *output = malloc(sizeof(one_output) + sizeof(two_output) +
+                        8 * boards);
+  assert(input != NULL && output != NULL);
+  repeat(stpcpy(input, one_input), "p\n", boards);
+  write_file("one.txt", input, strlen(input));
+  repeat(stpcpy(output, one_output), "..2\n1..\n", boards);
+  write_file("one_expected.txt", output, strlen(output));
+  repeat(stpcpy(input, two_input), "p\n", boards);
+  write_file("two.txt", input, strlen(input));
+  repeat(stpcpy(output, two_output), "1..2\n", boards);
+  write_file("two_expected.txt", output, strlen(output));
+  free(input);
+  free(output);
+
+  assert(run("gamma_server server.sock 2 > server.log 2>&1 & "
+             "echo $! > server.pid") == 0);
+  wait_for_file("server.sock", true);
+  // answers and errors of each session are in order of its lines
+  assert(run("gamma_client server.sock one < one.txt > one.out 2>&1 & "
+             "one=$!; "
+             "gamma_client server.sock two < two.txt > two.out 2>&1 & "
+             "two=$!; "
+             "wait $one && wait $two") == 0);
+  check_same("one.out", "one_expected.txt");
+  check_same("two.out", "two_expected.txt");
+  // files are not saved by the server and the game stays in the session
+  assert(access("one.bin", F_OK) != 0 && access("two.bin", F_OK) != 0);
+  write_file("board.txt", "p\n", 2);
+  assert(run("gamma_client server.sock one < board.txt > board.out") == 0);
+  check_file("board.out", "..2\n1..\n");
+  // connection without a proper session name is rejected, client may fail
+  // to send its lines after that
+  write_file("first.txt", "B 3 2 2 2\n", 10);
+  run("gamma_client server.sock '' < first.txt > first.out 2>&1");
+  check_file("first.out", "ERROR 0\n");
+
+  assert(run("kill $(cat server.pid)") == 0);
+  wait_for_file("server.sock", false);
+}
+
 int main() {
   example();
+  ring();
+  events();
+  board_write();
+  golden_targets();
+  planes();
+  parse();
+
+  // programs write their files into a temporary directory
+  char directory[] = "/tmp/gamma_test.XXXXXX";
+  assert(mkdtemp(directory) != NULL && chdir(directory) == 0);
+  line_numbers();
+  binary_protocol();
+  pipeline();
+  strict_output();
+  server();
+  assert(chdir("/") == 0);
+  char command[64];
+  snprintf(command, sizeof(command), "rm -r %s", directory);
+  assert(system(command) == 0);
 }
@@ -0,0 +1,357 @@
+/** @file
+ * Implementation of functions keeping track of fields available for
+ * golden move.
+ * Expected complexity of functions updating golden targets is O(1).
+ * Functions checking golden moves don't change the game, so they can be
+ * called concurrently.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+#include "board.h"
+#include "fau.h"
+#include "golden.h"
+#include "journal.h"
+
+/** @brief Checks if field at given position belongs to player.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] player - number of inspected player,
+ * @param[in] x      - horizontal position on board, may be outside of board,
+ * @param[in] y      - vertical position on board, may be outside of board.
+ * @return True if position is on board and player owns the field.
+ */
+static bool owned_by(gamma_t* g, uint32_t player, int64_t x, int64_t y) {
+    if (x < 0 || y < 0 || x >= g->width || y >= g->height)
+        return false;
+    return get_owner(g, y * (uint64_t)g->width + x) == player;
+}
+
+/** @brief Eight fields surrounding a field in circular order.
+ * Order starts from the upper field, so adjacent fields have even indexes
+ * and corners odd ones.
+ */
+static const int ring_dx[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+/** @brief Vertical offsets of fields in ring_dx order. */
+static const int ring_dy[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+/** @brief Counts groups of player's fields in the ring around a field.
+ * @param[in] ring  - if player owns every of eight surrounding fields,
+ *                    in order of ring_dx.
+ * @return Number of groups, see count_area_groups.
+ */
+static uint32_t ring_groups(const bool ring[8]) {
+    uint32_t sides = 0, links = 0;
+    for (int i = 0; i < 8; i += 2) {
+        if (ring[i]) {
+            sides++;
+            // corner joins this adjacent field with the next one
+            if (ring[i + 1] && ring[(i + 2) % 8])
+                links++;
+        }
+    }
+    if (sides == 0)
+        return 0;
+    if (links >= sides)
+        return 1; // whole ring belongs to player
+    return sides - links;
+}
+
+/** @brief Gives owner of field at given position.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] x      - horizontal position on board, may be outside of board,
+ * @param[in] y      - vertical position on board, may be outside of board.
+ * @return Owner of the field or 0 if it is free or outside of board.
+ */
+static uint32_t owned_at(gamma_t* g, int64_t x, int64_t y) {
+    if (x < 0 || y < 0 || x >= g->width || y >= g->height)
+        return 0;
+    return get_owner(g, y * (uint64_t)g->width + x);
+}
+
+uint32_t count_area_groups(gamma_t* g, uint32_t player, uint32_t x, uint32_t y) {
+    bool ring[8];
+    for (int i = 0; i < 8; i++)
+        ring[i] = owned_by(g, player, (int64_t)x + ring_dx[i],
+                           (int64_t)y + ring_dy[i]);
+    return ring_groups(ring);
+}
+
+/** @brief Changes golden target of a player given by a field.
+ * Field which can be taken without splitting its owner's area changes
+ * counter of the player, risky field is added to or removed from set of
+ * player's risky targets.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] player    - number of player adjacent to the field,
+ * @param[in] board_num - number of the field on the board,
+ * @param[in] risky     - if taking the field could split the area,
+ * @param[in] add       - if the target should be added or removed.
+ */
+static void change_target(gamma_t* g, uint32_t player, uint64_t board_num,
+                          bool risky, bool add) {
+    player_t* data = &g->players_array[player];
+    if (risky && g->recording)
+        journal_word(g, JOURNAL_RISKY, player, board_num,
+                     field_set_contains(&data->risky_targets, board_num));
+    if (risky && add)
+        field_set_add(&data->risky_targets, board_num);
+    else if (risky)
+        field_set_remove(&data->risky_targets, board_num);
+    else if (add)
+        data->golden_targets++;
+    else
+        data->golden_targets--;
+}
+
+/** @brief Changes golden targets around given field.
+ * For every field in 3x3 square around given field changes golden targets
+ * of every other player adjacent to it.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board,
+ * @param[in] add    - if counters should be increased or decreased.
+ */
+static void update_golden_targets(gamma_t* g, uint32_t x, uint32_t y,
+                                  bool add) {
+    uint32_t x_begin = x > 0 ? x - 1 : x;
+    uint32_t y_begin = y > 0 ? y - 1 : y;
+    uint32_t x_end = x < g->width - 1 ? x + 1 : x;
+    uint32_t y_end = y < g->height - 1 ? y + 1 : y;
+
+    for (uint32_t j = y_begin; j <= y_end; j++) {
+        for (uint32_t i = x_begin; i <= x_end; i++) {
+            uint64_t board_num = j * (uint64_t)g->width + i;
+            uint32_t owner = get_owner(g, board_num);
+            if (owner == 0)
+                continue; // free field
+            // taking the field could split the area
+            bool risky = count_area_groups(g, owner, i, j) > 1;
+            uint32_t neighbours[4];
+            find_distinct_neighbours(g, i, j, neighbours);
+            for (int k = 0; k < 4; k++)
+                if (neighbours[k] != 0 && neighbours[k] != owner)
+                    change_target(g, neighbours[k], board_num, risky, add);
+        }
+    }
+}
+
+void remove_golden_targets(gamma_t* g, uint32_t x, uint32_t y) {
+    update_golden_targets(g, x, y, false);
+}
+
+void add_golden_targets(gamma_t* g, uint32_t x, uint32_t y) {
+    update_golden_targets(g, x, y, true);
+}
+
+/** @brief Structure representing owners of 5x5 square around a field.
+ * Field at offset (i, j) from the middle is at owners[j + 2][i + 2], owner
+ * of field outside of the board is 0. The first and the last rows lie in
+ * other cache lines of wide boards, so they are read only when needed.
+ */
+typedef struct owners_window {
+    gamma_t* g; ///< pointer to structure holding game status.
+    uint32_t x; ///< horizontal position of the middle field.
+    uint32_t y; ///< vertical position of the middle field.
+    bool loaded[5]; ///< if row of the square was read.
+    uint32_t owners[5][5]; ///< owners of fields of read rows.
+} owners_window;
+
+/** @brief Reads row of the window unless it was read.
+ * @param[in, out] window   - pointer to the window,
+ * @param[in] j             - number of the row, 0 to 4.
+ */
+static void load_row(owners_window* window, int j) {
+    if (window->loaded[j])
+        return;
+    for (int i = 0; i < 5; i++)
+        window->owners[j][i] = owned_at(window->g, (int64_t)window->x + i - 2,
+                                        (int64_t)window->y + j - 2);
+    window->loaded[j] = true;
+}
+
+/** @brief Checks if taking a field in the window could split its area.
+ * @param[in, out] window   - pointer to the window,
+ * @param[in] i             - column of the field in the window, 1 to 3,
+ * @param[in] j             - row of the field in the window, 1 to 3.
+ * @return True if freeing the field could split area of its owner.
+ */
+static bool window_risky(owners_window* window, int i, int j) {
+    load_row(window, j - 1);
+    load_row(window, j + 1);
+    bool ring[8];
+    for (int k = 0; k < 8; k++)
+        ring[k] = window->owners[j + ring_dy[k]][i + ring_dx[k]] ==
+                  window->owners[j][i];
+    return ring_groups(ring) > 1;
+}
+
+/** @brief Gives distinct players adjacent to a field in the window.
+ * Owner of the field is not included.
+ * @param[in, out] window   - pointer to the window,
+ * @param[in] i             - column of the field in the window, 1 to 3,
+ * @param[in] j             - row of the field in the window, 1 to 3,
+ * @param[out] result       - distinct players, 0 in remaining places.
+ */
+static void window_neighbours(owners_window* window, int i, int j,
+                              uint32_t result[4]) {
+    load_row(window, j - 1);
+    load_row(window, j + 1);
+    uint32_t (*owners)[5] = window->owners;
+    uint32_t neighbours[4] = {owners[j][i - 1], owners[j][i + 1],
+                              owners[j - 1][i], owners[j + 1][i]};
+    int count = 0;
+    for (int k = 0; k < 4; k++) {
+        bool distinct = neighbours[k] != 0 && neighbours[k] != owners[j][i];
+        for (int l = 0; l < k; l++)
+            if (neighbours[k] == neighbours[l])
+                distinct = false;
+        if (distinct)
+            result[count++] = neighbours[k];
+    }
+    while (count < 4)
+        result[count++] = 0;
+}
+
+/** @brief Checks if player was adjacent to a field before taking the middle.
+ * @param[in, out] window   - pointer to the window,
+ * @param[in] player        - number of player who took the middle field,
+ * @param[in] i             - column of the field adjacent to the middle,
+ * @param[in] j             - row of the field adjacent to the middle.
+ * @return True if another field adjacent to the field is player's.
+ */
+static bool was_adjacent(owners_window* window, uint32_t player, int i,
+                         int j) {
+    // fields in rows of the middle are checked before other rows are read
+    int side = i - 2, row = j - 2;
+    uint32_t (*owners)[5] = window->owners;
+    if (row == 0)
+        return owners[j - 1][i] == player || owners[j + 1][i] == player ||
+               owners[j][i + side] == player;
+    if (owners[j][i - 1] == player || owners[j][i + 1] == player)
+        return true;
+    load_row(window, j + row);
+    return owners[j + row][i] == player;
+}
+
+void update_move_targets(gamma_t* g, uint32_t player, uint32_t x,
+                         uint32_t y) {
+    owners_window window = {g, x, y, {false}, {{0}}};
+    for (int j = 1; j <= 3; j++)
+        load_row(&window, j);
+    uint32_t (*owners)[5] = window.owners;
+
+    for (int j = 1; j <= 3; j++) {
+        for (int i = 1; i <= 3; i++) {
+            uint32_t owner = owners[j][i];
+            if (owner == 0)
+                continue; // free field
+            bool adjacent = i == 2 || j == 2;
+            if (owner != player && (!adjacent ||
+                                    was_adjacent(&window, player, i, j)))
+                continue; // targets given by the field didn't change
+            uint64_t board_num = (y + j - 2) * (uint64_t)g->width + x + i - 2;
+            bool risky = window_risky(&window, i, j);
+            if (owner != player) { // player is a new neighbour
+                change_target(g, player, board_num, risky, true);
+                continue;
+            }
+            uint32_t neighbours[4];
+            window_neighbours(&window, i, j, neighbours);
+            if (i == 2 && j == 2) { // taken field becomes target
+                for (int k = 0; k < 4; k++)
+                    if (neighbours[k] != 0)
+                        change_target(g, neighbours[k], board_num, risky,
+                                      true);
+                continue;
+            }
+            // other players adjacent to the field are the same
+            owners[2][2] = 0;
+            bool was_risky = window_risky(&window, i, j);
+            owners[2][2] = player;
+            for (int k = 0; k < 4 && risky != was_risky; k++) {
+                if (neighbours[k] == 0)
+                    continue;
+                change_target(g, neighbours[k], board_num, was_risky, false);
+                change_target(g, neighbours[k], board_num, risky, true);
+            }
+        }
+    }
+}
+
+int field_can_be_taken(gamma_t *g, uint32_t x, uint32_t y) {
+    uint64_t board_num = y * (uint64_t)g->width + x;
+    uint32_t previous_owner = get_owner(g, board_num);
+    player_t* owner_data = &g->players_array[previous_owner];
+
+    // freeing the field creates at most that many new areas, if it is few
+    // enough there is no need to inspect whole area
+    uint32_t groups = count_area_groups(g, previous_owner, x, y);
+    if (owner_data->used_areas + groups <= (uint64_t)g->areas + 1)
+        return 1;
+    STAT_ADD(g, STAT_GOLDEN_SEARCHES, 1);
+    int new_areas = count_areas_after_freeing(g, x, y);
+    if (new_areas < 0)
+        return -1; // failed to allocate memory
+    return owner_data->used_areas + new_areas <= (uint64_t)g->areas + 1;
+}
+
+/** @brief Checks every field if player can take it with golden move.
+ * Used when set of player's risky targets is not complete.
+ * Complexity O(n * m) where n stands for storage size of the board and m
+ * stands for number of fields in disjoined areas.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] player - number of player performing golden move.
+ * @return 1 if golden move can be performed on some field, 0 if it can't
+ * and -1 if memory for checking it couldn't be allocated.
+ */
+static int golden_board_scan(gamma_t *g, uint32_t player) {
+    // Now checking for every adjacent field of other player if golden move
+    // can be performed on it
+    uint64_t position = 0, board_num;
+    while (next_busy_field(g, &position, &board_num)) {
+        uint32_t x = board_num % g->width, y = board_num / g->width;
+        if (get_owner(g, board_num) == player)
+            continue; // field belongs to player
+        if (!count_neighbours(g, player, x, y))
+            continue; // player would create too many areas
+        int result = field_can_be_taken(g, x, y);
+        if (result != 0)
+            return result;
+    }
+    return 0;
+}
+
+int golden_possible(gamma_t *g, uint32_t player) {
+    player_t* analysed_player = &g->players_array[player];
+    if (analysed_player->used_golden)
+        return 0; // golden move already used
+
+    uint64_t busy_fields = g->width * (uint64_t)g->height - g->free_fields;
+    if (busy_fields == analysed_player->used_fields)
+        return 0; // no fields of other players
+    if (analysed_player->used_areas < g->areas)
+        return 1; // every area has a field which can be freed without
+                  // splitting it and player can take any field
+    if (analysed_player->golden_targets > 0)
+        return 1; // there is adjacent field safe to take
+    field_set* risky = &analysed_player->risky_targets;
+    if (risky->incomplete)
+        return golden_board_scan(g, player);
+
+    // checking every adjacent field which could split other player's area
+    for (uint64_t i = 0; i < risky->capacity; i++) {
+        if (risky->slots[i] == FIELD_SET_EMPTY)
+            continue;
+        int result = field_can_be_taken(g, risky->slots[i] % g->width,
+                                        risky->slots[i] / g->width);
+        if (result < 0)
+            return golden_board_scan(g, player); // failed to allocate memory
+        if (result > 0)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+/** @file
+ * Interface of functions keeping track of fields available for golden move.
+ * For every player counts foreign fields adjacent to his areas which can be
+ * taken away from their owner without splitting owner's area and keeps set
+ * of remaining foreign fields adjacent to his areas.
+ * Expected complexity of every function is O(1)
+ */
+
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+
+/** @brief Counts groups of player's fields adjacent to given field.
+ * Player's fields adjacent to given field belong to the same group if they
+ * are connected through player's fields among eight fields surrounding
+ * given field. Freeing given field can't split player's area into more
+ * parts than the returned number.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] player - number of inspected player,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ * @return Number of those groups.
+ */
+uint32_t count_area_groups(gamma_t* g, uint32_t player, uint32_t x, uint32_t y);
+
+/** @brief Removes golden targets around given field before it changes owner.
+ * Every field in 3x3 square around given field stops being counted
+ * as golden target of players adjacent to it.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ */
+void remove_golden_targets(gamma_t* g, uint32_t x, uint32_t y);
+
+/** @brief Adds golden targets around given field after it changed owner.
+ * Every field in 3x3 square around given field is counted as golden target
+ * of players adjacent to it.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ */
+void add_golden_targets(gamma_t* g, uint32_t x, uint32_t y);
+
+/** @brief Updates golden targets after player took a free field.
+ * Used instead of removing and adding targets around the field for moves.
+ * Only player's fields around the taken field may change whether taking
+ * them could split the area, and only foreign fields adjacent to it may
+ * get the player as a new neighbour, so only those fields are inspected.
+ * Owners of 5x5 square around the field are read once.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] player - number of player who took the field,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ */
+void update_move_targets(gamma_t* g, uint32_t player, uint32_t x,
+                         uint32_t y);
+
+/** @brief Checks if given field can be taken from its owner.
+ * Checks if its previous owner wouldn't exceed maximum number of areas
+ * without the field. Doesn't change the board.
+ * Complexity O(n) where n stands for number of fields in disjoined areas
+ * except the largest one.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ * @return 1 if freeing the field doesn't create too many areas, 0 if it does
+ * or -1 if memory couldn't be allocated.
+ */
+int field_can_be_taken(gamma_t *g, uint32_t x, uint32_t y);
+
+/** @brief Checks if player can perform golden move without changing the game.
+ * Assumes player number is correct.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] player - number of player performing golden move.
+ * @return 1 if golden move is possible, 0 if it isn't and -1 if memory
+ * for checking it couldn't be allocated.
+ */
+int golden_possible(gamma_t *g, uint32_t player);
+
+#endif /* GOLDEN_H */
@@ -2,173 +2,146 @@
  * Implementation for interactive mode operation.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
 #include <unistd.h>
-#include <sys/ioctl.h>
 #include <termios.h>
 
 #include "borders.h"
+#include "board.h"
 #include "fau.h"
 #include "gamma.h"
 #include "inter_mode.h"
+#include "output_writer.h"
+#include "screen.h"
 
-/** @brief Reprints given field.
- * After some field's status has changed it needs to be printed again
- * to update status on the screen, the field can have white background
- * with black letters (if cursor is there), black background with yellow letters
- * (if it is this field's owner turn) or black background with white letters
- * (default). If it's not known who's turn it is, 'active_player' should
- * be set to '0'.
- * @param[in] g             - pointer to structure holding game status,
- * @param[in] x             - horizontal position of field on board,
- * @param[in] y             - vertical position of field on board,
- * @param[in] light_up      - is the cursor on this field,
- * @param[in] active_player - number of a player whos turn is now.
- */
-static void update_field(gamma_t* g, uint32_t x, uint32_t y, 
-                         bool light_up, uint32_t active_player) {
-    uint32_t field_size = g->field_print_size;
-    uint64_t board_pos = y * (uint64_t)g->width + x;
-    uint32_t player = g->board[board_pos].owner_number;
-    if (light_up) {
-        // if cursor is on this field it is printed diffrently
-        printf("\x1b[47m"); // white background
-        printf("\x1b[30m"); // black letters
-    }
-    else if (active_player != 0 && player == active_player) {
-        // if field belongs to players whos turn it is it's printed diffrently
-        printf("\x1b[33m"); // yellow letters
-    }
-    if (field_size == 1) {
-        // printing boards with less then 10 players
-        printf("\x1b[%d;%df", y + 1, x + 1);
-        if (player == 0)
-            printf(".");
-        else
-            printf("%u", player);
-    }
-    else {
-        // printing boards with at least 10 players
-        printf("\x1b[%d;%df", y + 1, x * (field_size + 1) + 1);
-        int number_length = count_digits(player);
-        for (uint32_t i = 0; i < field_size - number_length; i++)
-            printf(" ");
-        if (player == 0)
-            printf(".");
-        else
-            printf("%u", player);
-    }
-    printf("\x1b[0m"); // color reset
-}
+/** @brief Default number of milliseconds a bot thinks over a move. */
+#define DEFAULT_BOT_TIME 1000
 
-/** @brief Updates fields of a given player.
- * Updates every field on the board which 'owner_number' is 'player', updates
- * fields diffrently if it is 'player''s turn now or not.
- * @param[in] g - Pointer to structure holding game status,
- * @param[in] player - Number of player to check,
- * @param[in] active - If this player's turn is now or if it has just ended.
- */
-static void update_player_fields(gamma_t* g, uint32_t player, bool active) {
-    for (uint32_t row = 0; row < g->height; row++) {
-        for (uint32_t column = 0; column < g->width; column++) {
-            uint64_t board_pos = row * (uint64_t)g->height + column;
-            if (g->board[board_pos].owner_number == player) {
-                if (active)
-                    update_field(g, column, row, false, player);
-                else
-                    update_field(g, column, row, false, 0);
-            }
-        }
-    }
-}
+/** @brief Number of characters of the longest description line. */
+#define MIN_WIDTH 55
+
+/** @brief If size of the terminal changed since the screen was fitted. */
+static volatile sig_atomic_t resized = 0;
 
-/** @brief Prints game board
- * @param[in] g - Pointer to struct holding game status.
+/** @brief Notes that size of the terminal changed.
+ * @param[in] signal_number - number of the signal.
  */
-static void set_board(gamma_t* g) {
-    printf("\x1b[2J");    // Clear the entire screen
-    printf("\x1b[%d;%df", 1, 1); // set cursor
-    for (uint32_t row = 0; row < g->height; row++)
-        for (uint32_t column = 0; column < g->width; column++)
-            update_field(g, column, row, false, 0);
+static void handle_resize(int signal_number) {
+    (void)signal_number;
+    resized = 1;
 }
 
 /** @brief Updates cursor position after pressing arrow.
  * Changes cursor position (if it is possible) updating
  * values '*x_ptr' and '*y_ptr' for arrow specified by
- * move_type. 
- * @param[in] g         - pointer to structure holding game status,
+ * move_type. In overview the cursor jumps by a block of fields.
+ * @param[in, out] s    - pointer to the screen,
  * @param[in] x_ptr     - pointer to integer holding horizontal cursor position,
  * @param[in] y_ptr     - pointer to integer holding vertical cursor position,
- * @param[in] move_type - last number in ANSI escape code of pressed arrow,
- * @param[in] player    - number of player who's move this is.
+ * @param[in] move_type - last number in ANSI escape code of pressed arrow.
  */
-static void change_position(gamma_t* g, uint32_t* x_ptr, 
-                     uint32_t* y_ptr, int move_type, uint32_t player) {
-    uint32_t x = *x_ptr;
-    uint32_t y = *y_ptr;
-    if (move_type == 65 && y > 0) {
-        // arrow up
-        update_field(g, x, y, false, player);
-        (*y_ptr)--;
-        update_field(g, x, --y, true, player);
-    }
-    if (move_type == 66 && y < g->height - 1) {
-        // arrow down
-        update_field(g, x, y, false, player);
-        (*y_ptr)++;
-        update_field(g, x, ++y, true, player);
-    }
-    if (move_type == 67 && x < g->width - 1) {
-        // arrow right
-        update_field(g, x, y, false, player);
-        (*x_ptr)++;
-        update_field(g, ++x, y, true, player);
-    }
-    if (move_type == 68 && x > 0) {
-        // arrow left
-        update_field(g, x, y, false, player);
-        (*x_ptr)--;
-        update_field(g, --x, y, true, player);
-    }
+static void change_position(screen* s, uint32_t* x_ptr, uint32_t* y_ptr,
+                            int move_type) {
+    uint64_t x = *x_ptr, y = *y_ptr;
+    uint64_t step_x = screen_step(s, false), step_y = screen_step(s, true);
+    if (move_type == 65) // arrow up
+        y = y > step_y ? y - step_y : 0;
+    if (move_type == 66) // arrow down
+        y = y + step_y < s->g->height ? y + step_y : s->g->height - 1;
+    if (move_type == 67) // arrow right
+        x = x + step_x < s->g->width ? x + step_x : s->g->width - 1;
+    if (move_type == 68) // arrow left
+        x = x > step_x ? x - step_x : 0;
+    *x_ptr = x;
+    *y_ptr = y;
+    screen_cursor(s, *x_ptr, *y_ptr, true);
+}
+
+/** @brief Adds a text ended with zero to the output.
+ * @param[in, out] out  - pointer to the output,
+ * @param[in] text      - the text.
+ */
+static void put_text(output_writer* out, const char* text) {
+    write_text(out, text, strlen(text));
+}
+
+/** @brief Adds a coloured number surrounded with spaces to the output.
+ * @param[in, out] out  - pointer to the output,
+ * @param[in] colour    - escape code of the colour,
+ * @param[in] number    - the number.
+ */
+static void put_number(output_writer* out, const char* colour,
+                       uint64_t number) {
+    put_text(out, colour);
+    put_text(out, " ");
+    write_number(out, number);
+    put_text(out, " \x1b[0m"); // color reset
 }
 
 /** @brief Prints information about given player below the board.
  * Prints player number, and results of functions
  * gamma_busy_fields, gamma_free_fields, gamma_golden_possible for them.
- * @param[in] g         - Pointer to structure holding game status,
+ * @param[in, out] s    - pointer to the screen,
  * @param[in] player    - Player to describe.
  */
-static void print_player_description(gamma_t* g, uint32_t player) {
-    printf("\x1b[%d;%df", g->height + 1, 1); // Set cursor below board
-    printf("\x1b[2K");    // Clear cursor line 
-
-    printf("PLAYER");
-    printf("\x1b[33m %u \x1b[0m", player); // yellow letters
-    
-    printf("POINTS");
-    printf("\x1b[32m %lu \x1b[0m", gamma_busy_fields(g, player));
+static void print_player_description(screen* s, uint32_t player) {
+    output_writer* out = screen_line(s, 0);
+    put_text(out, "PLAYER");
+    put_number(out, "\x1b[33m", player); // yellow letters
+    put_text(out, "POINTS");
+    put_number(out, "\x1b[32m", gamma_busy_fields(s->g, player));
+    put_text(out, "POSSIBLE MOVES");
+    put_number(out, "\x1b[31m", gamma_free_fields(s->g, player));
+    if (gamma_golden_possible(s->g, player))
+        put_text(out, "POSSIBLE GOLDEN");
+    put_text(out, "\n");
+}
 
-    printf("POSSIBLE MOVES");
-    printf("\x1b[31m %lu \x1b[0m", gamma_free_fields(g, player));
+/** @brief Prints position of the cursor in the second line below the board.
+ * @param[in, out] s    - pointer to the screen.
+ */
+static void print_position(screen* s) {
+    output_writer* out = screen_line(s, 1);
+    put_text(out, "FIELD");
+    put_number(out, "\x1b[36m", s->cursor_x); // cyan letters
+    put_number(out, "\x1b[36m", s->cursor_y);
+    if (s->overview)
+        put_text(out, "OVERVIEW");
+}
 
-    if (gamma_golden_possible(g, player))
-        printf("POSSIBLE GOLDEN");
-    printf("\n");
+/** @brief Fits the screen into resized terminal.
+ * Draws the board and text below it again if the terminal was resized.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] player    - Player whose turn it is or 0 if game ended.
+ */
+static void follow_terminal(screen* s, uint32_t player) {
+    if (!resized)
+        return; // nothing changed
+    resized = 0;
+    screen_resize(s);
+    if (player != 0)
+        print_player_description(s, player);
+    print_position(s);
 }
 
 /** @brief Finds number of next player which can maka a move in given game.
  * For given player checks who can make a move after him and returns his
- * number or 0 if there are no moves possible.
- * @param[in] g         - Pointer to structure holding game status,
+ * number or 0 if there are no moves possible. Fields of that player
+ * are highlighted.
+ * @param[in, out] s    - pointer to the screen,
  * @param[in] player    - Player that have just moved.
  * @return Returns number of player of 0 if there are no moves possible.
  */
-static uint32_t next_player(gamma_t* g, uint32_t player) {
+static uint32_t next_player(screen* s, uint32_t player) {
+    gamma_t* g = s->g;
     uint32_t new_player = player;
     uint32_t passed = 0;
     while (passed < g->players) {
@@ -178,38 +151,96 @@ static uint32_t next_player(gamma_t* g, uint32_t player) {
             new_player = 1;
         if (gamma_free_fields(g, new_player) > 0 || 
             gamma_golden_possible(g, new_player)) {
-            update_player_fields(g, player, false);
-            update_player_fields(g, new_player, true);
+            screen_active(s, new_player);
             return new_player; // found somebody who can move
         }
     }
-    update_player_fields(g, player, false);
+    screen_active(s, 0);
     return 0; // no moves possible
 }
 
+/** @brief Reads players controlled by the program from environment.
+ * Variable GAMMA_BOTS holds numbers of players separated by commas,
+ * GAMMA_BOT_TIME holds number of milliseconds a bot thinks over a move.
+ * @param[in] g         - Pointer to structure holding game status,
+ * @param[out] bot_time - Pointer to number of milliseconds of thinking.
+ * @return Array telling which players are bots or NULL if there are none.
+ */
+static bool* read_bots(gamma_t* g, uint64_t* bot_time) {
+    const char* players = getenv("GAMMA_BOTS");
+    const char* time = getenv("GAMMA_BOT_TIME");
+    *bot_time = time != NULL ? strtoull(time, NULL, 10) : DEFAULT_BOT_TIME;
+    if (players == NULL)
+        return NULL;
+    bool* bots = calloc((uint64_t)g->players + 1, sizeof(bool));
+    if (bots == NULL)
+        return NULL; // failed to allocate memory, everybody plays by hand
+    char* end;
+    while (*players != '\0') {
+        unsigned long player = strtoul(players, &end, 10);
+        if (end == players) {
+            players++; // separator
+            continue;
+        }
+        if (player <= g->players)
+            bots[player] = true;
+        players = end;
+    }
+    return bots;
+}
+
+/** @brief Performs moves of players controlled by the program.
+ * Bots move one after another until it is turn of a player playing by hand
+ * or nobody can move. A bot which doesn't find any move is skipped.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] bots      - Array telling which players are bots or NULL,
+ * @param[in] bot_time  - Number of milliseconds a bot thinks over a move,
+ * @param[in] player    - Player whose turn it is.
+ * @return Player whose turn it is or 0 if there are no moves possible.
+ */
+static uint32_t play_bots(screen* s, bool* bots, uint64_t bot_time,
+                          uint32_t player) {
+    gamma_t* g = s->g;
+    uint32_t skipped = 0;
+    while (bots != NULL && player != 0 && bots[player]) {
+        uint32_t move_x, move_y;
+        bool golden, moved = false;
+        if (gamma_suggest_move(g, player, bot_time, 0, &move_x, &move_y,
+                               &golden))
+            moved = golden ? gamma_golden_move(g, player, move_x, move_y) :
+                             gamma_move(g, player, move_x, move_y);
+        skipped = moved ? 0 : skipped + 1;
+        if (skipped == g->players)
+            return 0; // no bot can move, game ends
+        player = next_player(s, player);
+        if (player != 0)
+            print_player_description(s, player);
+        follow_terminal(s, player);
+        screen_flush(s); // move is shown while next bot thinks
+    }
+    return player;
+}
+
 /** @brief Prints information about all players after game ends.
  * Prints description of every players taken fields below the board.
- * @param[in] g - Pointer to structure holding game status. 
+ * @param[in, out] s    - pointer to the screen.
  */
-static void summary(gamma_t* g) {
-    printf("\x1b[%d;%df", g->height + 1, 1);
-    printf("\x1b[2K"); // clears line after board
-    for (uint32_t i = 1; i <= g->players; i++) {
-        printf("PLAYER");
-        printf("\x1b[33m %u \x1b[0m", i);
-        printf("POINTS");
-        printf("\x1b[32m %lu \x1b[0m", gamma_busy_fields(g, i));
-        printf("\n");
+static void summary(screen* s) {
+    output_writer* out = screen_line(s, 0);
+    for (uint32_t i = 1; i <= s->g->players; i++) {
+        put_text(out, "PLAYER");
+        put_number(out, "\x1b[33m", i);
+        put_text(out, "POINTS");
+        put_number(out, "\x1b[32m", gamma_busy_fields(s->g, i));
+        put_text(out, "\n");
     }
 }
 
-/** @brief Prints board and prepers proper key reading.
- * Enables input readin without enter key by changing to raw mode, 
- * prints board, prints player description, hides cursor.
- * @param[in] g             - Pointer to structure holding game status,
- * @param[in] termios_ptr   - Pointer to structure with terminal settings.
+/** @brief Prepares proper key reading.
+ * Enables input readin without enter key by changing to raw mode.
+ * @param[out] termios_ptr  - Pointer to structure with terminal settings.
  */
-static void prepare_board(gamma_t* g, struct termios* termios_ptr) {
+static void prepare_terminal(struct termios* termios_ptr) {
     // get terminal settings
     if (tcgetattr(STDIN_FILENO, termios_ptr) == -1)
         exit(1); // error while reading terminal settings
@@ -217,68 +248,48 @@ static void prepare_board(gamma_t* g, struct termios* termios_ptr) {
     raw.c_lflag &= ~(ECHO | ICANON); // change terminal settings
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1)
         exit(1); // error while changing terminal settings
-  
-    set_board(g);
-    printf("\x1b[?25l"); // hide the cursor
-    print_player_description(g, 1);
 }
 
 /** @brief Disables earlier key reading and prints summary.
  * Disables reading input without enter key, prints summary and shows cursor.
- * @param[in] g             - Pointer to structure holding game status,
+ * @param[in, out] s        - pointer to the screen,
  * @param[in] termios_ptr   - Pointer to structure with terminal settings.
  */
-static void finish_interactive(gamma_t* g, struct termios* termios_ptr) {
+static void finish_interactive(screen* s, struct termios* termios_ptr) {
     // disable reading input without need for enter key
     if (tcsetattr(STDIN_FILENO, TCSAFLUSH, termios_ptr) == -1)
         exit(1); // error while changing terminal settings
 
-    printf("\x1b[?25h"); // show the cursor
-    summary(g);
-}
-
-/** @brief Checks if terminal window is large enough to perform this game.
- * @param[in] g -   Pointer to structure holding game status.
- */
-static bool proper_terminal_size(gamma_t* g) {
-    struct winsize terminal_window;
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &terminal_window);
-    uint32_t terminal_height = terminal_window.ws_row;
-    uint32_t terminal_width = terminal_window.ws_col;
-
-    // Check if terminal can show all rows plus one description row
-    if (terminal_height <= g->height + 1)
-        return false;
-
-    // Check if terminal can show all columns
-    if (g->players < 10) { // for less then 10 players
-        if (terminal_width < g->width)
-            return false;
-    }
-    else { // for at leas 10 players (so including spaces between fields)
-        if ((uint64_t)terminal_width < g->width * ((uint64_t)g->field_print_size + 1))
-            return false;
-    }
-
-    // Check if terminal can show description line
-    const uint32_t MIN_WIDTH = 55;
-    if (terminal_width < MIN_WIDTH)
-        return false;
-
-    return true;
+    summary(s);
+    close_screen(s);
 }
 
 void run_interactive(gamma_t* g) {
-    if (!proper_terminal_size(g)) {
+    if (!screen_fits(g, MIN_WIDTH)) {
         printf("Terminal not large enough!\n");
         return;
     }
+    screen s;
+    if (!open_screen(&s, g)) {
+        printf("Not enough memory for the screen!\n");
+        return;
+    }
     struct termios original_termios;
-    prepare_board(g, &original_termios);
+    prepare_terminal(&original_termios);
+    // reading keys is interrupted when the terminal is resized
+    struct sigaction action, original_action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_resize;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGWINCH, &action, &original_action);
     uint32_t x = g->width / 2;
     uint32_t y = g->height / 2;
-    int player = 1;
-    update_field(g, x, y, true, 0);
+    uint32_t player = 1;
+    screen_cursor(&s, x, y, true);
+    screen_active(&s, player);
+    print_player_description(&s, player);
+    print_position(&s);
+    screen_flush(&s);
     // now board and first players description are printed
     // starts listening for pressed keys
 
@@ -288,32 +299,48 @@ void run_interactive(gamma_t* g) {
     // pressed key was processed properly and program is listening to next key.
     // When 'input' is set to something else that means there was
     // some unfinished escape sequence so program will process parts of it
+    uint64_t bot_time;
+    bool* bots = read_bots(g, &bot_time);
     while (true) {
+        player = play_bots(&s, bots, bot_time, player);
+        if (player == 0)
+            break; // nobody can move after moves of bots
         if (input == READY_TO_READ)
             input = getchar();
+        if (input == EOF) {
+            if (errno != EINTR || !resized)
+                break; // input ended so game ends
+            clearerr(stdin);
+            input = READY_TO_READ; // resize is handled below
+        }
 
+        // description changes only when the game or the player changes
+        bool changed = false;
         if (input == 4) { // ctrl + D 
-            update_player_fields(g, player, false);
-            update_field(g, x, y, false, 0);
             break; // ctrl + D pressed game ends
         }
         else if (input == ' ') { // SPACE
             if (gamma_move(g, player, x, y)) {
-                player = next_player(g, player);
-                update_field(g, x, y, true, player);
+                player = next_player(&s, player);
+                changed = true;
             }
             input = READY_TO_READ;
         }
         else if (input == 'G' || input == 'g') { // g or G
             if (gamma_golden_move(g, player, x, y)) {
-                player = next_player(g, player);
-                update_field(g, x, y, true, player);
+                player = next_player(&s, player);
+                changed = true;
             }
             input = READY_TO_READ;
         }
         else if (input == 'C' || input == 'c') { 
-            player = next_player(g, player);
-            update_field(g, x, y, true, player);
+            player = next_player(&s, player);
+            changed = true;
+            input = READY_TO_READ;
+        }
+        else if (input == 'M' || input == 'm') { // overview of the board
+            screen_overview(&s);
+            print_position(&s);
             input = READY_TO_READ;
         }
         else if (input == 27) { // ESC so some escape code starts
@@ -321,7 +348,8 @@ void run_interactive(gamma_t* g) {
             if (second_input == '[') { // ] so code continoues
                 int move_type = getchar();
                 if (move_type >= 65 && move_type <= 68) { // proper arror code
-                    change_position(g, &x, &y, move_type, player);
+                    change_position(&s, &x, &y, move_type);
+                    print_position(&s);
                     input = READY_TO_READ; 
                 }
                 else // not finished escape sequence ESC + ?
@@ -332,12 +360,18 @@ void run_interactive(gamma_t* g) {
         }
         else // key not supported
             input = READY_TO_READ;
-        if (player == 0) {
-            update_field(g, x, y, false, 0);
+        if (player == 0)
             break; // function find_next_player didn't find player that can move
-        }
-        print_player_description(g, player);
+        if (changed)
+            print_player_description(&s, player);
+        follow_terminal(&s, player);
+        screen_flush(&s); // whole key is shown with one write
     }
     // game finished 
-    finish_interactive(g, &original_termios);  
+    screen_cursor(&s, x, y, false);
+    screen_active(&s, 0);
+    screen_flush(&s);
+    sigaction(SIGWINCH, &original_action, NULL);
+    free(bots);
+    finish_interactive(&s, &original_termios);
 }
\ No newline at end of file
@@ -13,8 +13,14 @@
 
 /** @brief Prints gamma_board, listens to key pressing and acts accordingly.
  * Prints board on screen and for any proper action updates board accordingly
- * and prints necessary changes. After game is finished (Ctrl+D or no moves
- * possible) prints summery below board.
+ * and prints necessary changes. Board larger than the terminal is shown
+ * in a view following the cursor, key M switches to overview of the whole
+ * board and back, the view follows resizes of the terminal. After game is
+ * finished (Ctrl+D, end of input or no moves possible) prints summery below
+ * board. Players listed in environment
+ * variable GAMMA_BOTS (numbers separated by commas) are moved by the program,
+ * which thinks over every move for GAMMA_BOT_TIME milliseconds (1000 if not
+ * set).
  * @param[in, out] g    - Pointer to structure holding game status.
  */
 void run_interactive(gamma_t* g);
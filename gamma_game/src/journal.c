@@ -0,0 +1,354 @@
+/** @file
+ * Implementation of journal of moves.
+ * Board words are written to the journal by functions changing them.
+ * Counters of players are compared with their values remembered at the
+ * beginning of the move, only changed ones are written.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "borders.h"
+#include "board.h"
+#include "field_set.h"
+#include "events.h"
+#include "journal.h"
+#include "publish.h"
+#include "gamma.h"
+
+/** @brief Maximal number of players affected by a move.
+ * A move changes counters of players owning fields in 5x5 square around
+ * the field and of the player performing it.
+ */
+#define MAX_AFFECTED 26
+
+/** @brief Structure representing changed word of the game.
+ */
+typedef struct journal_entry {
+    uint64_t index; ///< number of field, node or player of the word.
+    uint64_t value; ///< value the word has when the entry isn't applied.
+    uint32_t kind; ///< kind of the word, see journal_kind.
+    uint32_t player; ///< number of the player for risky targets.
+} journal_entry;
+
+/** @brief Structure representing counters of player before the move.
+ */
+typedef struct player_counters {
+    uint32_t player; ///< number of the player.
+    bool used_golden; ///< if player already used golden move.
+    uint32_t used_areas; ///< how many arreas does the player have.
+    uint64_t free_borders; ///< free fields adjacent to player fields.
+    uint64_t used_fields; ///< how many fields does the player have.
+    uint64_t golden_targets; ///< foreign adjacent fields safe to take.
+} player_counters;
+
+/** @brief Structure representing journal of moves.
+ * Entries of step i end at steps[i], steps from done onwards are undone.
+ */
+typedef struct journal {
+    journal_entry* entries; ///< entries of every step one after another.
+    uint64_t entries_size; ///< number of entries.
+    uint64_t entries_capacity; ///< size of entries array.
+    uint64_t* steps; ///< end of entries of every step.
+    uint64_t steps_size; ///< number of steps, done and undone.
+    uint64_t steps_capacity; ///< size of steps array.
+    uint64_t done; ///< number of done steps.
+    uint64_t step_begin; ///< first entry of recorded move.
+    bool lost; ///< if some entry of recorded move couldn't be written.
+    uint64_t free_fields; ///< free fields before recorded move.
+    uint64_t used_nodes; ///< used nodes before recorded move.
+    uint32_t affected; ///< number of players affected by recorded move.
+    player_counters counters[MAX_AFFECTED]; ///< counters before the move.
+} journal;
+
+/** @brief Makes place for one more element of an array.
+ * @param[in, out] array    - pointer to the array,
+ * @param[in, out] capacity - pointer to size of the array,
+ * @param[in] size          - number of used elements,
+ * @param[in] element       - size of single element.
+ * @return False if memory couldn't be allocated.
+ */
+static bool reserve(void** array, uint64_t* capacity, uint64_t size,
+                    size_t element) {
+    if (size < *capacity)
+        return true;
+    uint64_t new_capacity = *capacity ? 2 * *capacity : 64;
+    void* new_array = realloc(*array, new_capacity * element);
+    if (new_array == NULL)
+        return false; // failed to allocate memory
+    *array = new_array;
+    *capacity = new_capacity;
+    return true;
+}
+
+void journal_word(gamma_t* g, enum journal_kind kind, uint32_t player,
+                  uint64_t index, uint64_t value) {
+    journal* j = g->journal;
+    if (j->lost || !reserve((void**)&j->entries, &j->entries_capacity,
+                            j->entries_size, sizeof(journal_entry))) {
+        j->lost = true;
+        return;
+    }
+    j->entries[j->entries_size++] = (journal_entry){index, value, kind,
+                                                    player};
+}
+
+/** @brief Remembers counters of the player unless they are remembered.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] player - number of the player, 0 is skipped.
+ */
+static void remember_player(gamma_t* g, uint32_t player) {
+    journal* j = g->journal;
+    if (player == 0)
+        return;
+    for (uint32_t i = 0; i < j->affected; i++)
+        if (j->counters[i].player == player)
+            return;
+    player_t* data = &g->players_array[player];
+    j->counters[j->affected++] = (player_counters){player, data->used_golden,
+        data->used_areas, data->free_borders, data->used_fields,
+        data->golden_targets};
+}
+
+void journal_begin(gamma_t* g, uint32_t player, uint32_t x, uint32_t y) {
+    journal* j = g->journal;
+    if (j == NULL)
+        return;
+    g->recording = true;
+    j->step_begin = j->entries_size;
+    j->free_fields = g->free_fields;
+    j->used_nodes = g->used_nodes;
+    j->affected = 0;
+    remember_player(g, player);
+    for (int64_t i = (int64_t)y - 2; i <= (int64_t)y + 2; i++)
+        for (int64_t k = (int64_t)x - 2; k <= (int64_t)x + 2; k++)
+            if (i >= 0 && k >= 0 && i < g->height && k < g->width)
+                remember_player(g, get_owner(g, i * (uint64_t)g->width + k));
+}
+
+/** @brief Writes counters changed since the beginning of the move.
+ * @param[in, out] g - pointer to structure holding game status.
+ */
+static void write_counters(gamma_t* g) {
+    journal* j = g->journal;
+    if (g->free_fields != j->free_fields)
+        journal_word(g, JOURNAL_FREE_FIELDS, 0, 0, j->free_fields);
+    if (g->used_nodes != j->used_nodes)
+        journal_word(g, JOURNAL_USED_NODES, 0, 0, j->used_nodes);
+    for (uint32_t i = 0; i < j->affected; i++) {
+        player_counters* before = &j->counters[i];
+        player_t* data = &g->players_array[before->player];
+        if (data->used_golden != before->used_golden)
+            journal_word(g, JOURNAL_USED_GOLDEN, 0, before->player,
+                         before->used_golden);
+        if (data->used_areas != before->used_areas)
+            journal_word(g, JOURNAL_USED_AREAS, 0, before->player,
+                         before->used_areas);
+        if (data->free_borders != before->free_borders)
+            journal_word(g, JOURNAL_FREE_BORDERS, 0, before->player,
+                         before->free_borders);
+        if (data->used_fields != before->used_fields)
+            journal_word(g, JOURNAL_USED_FIELDS, 0, before->player,
+                         before->used_fields);
+        if (data->golden_targets != before->golden_targets)
+            journal_word(g, JOURNAL_GOLDEN_TARGETS, 0, before->player,
+                         before->golden_targets);
+    }
+}
+
+/** @brief Swaps value of player's counter with value kept in the entry.
+ * @param[in, out] g     - pointer to structure holding game status,
+ * @param[in, out] entry - pointer to applied entry.
+ */
+static void apply_counter(gamma_t* g, journal_entry* entry) {
+    uint64_t value = entry->value;
+    player_t* data = &g->players_array[entry->index];
+    switch (entry->kind) {
+    case JOURNAL_USED_GOLDEN:
+        entry->value = data->used_golden;
+        data->used_golden = value;
+        emit_event(g, GAMMA_EVENT_GOLDEN, entry->index, NO_FIELD, value);
+        break;
+    case JOURNAL_USED_AREAS:
+        entry->value = data->used_areas;
+        data->used_areas = value;
+        emit_event(g, GAMMA_EVENT_AREAS, entry->index, NO_FIELD, value);
+        break;
+    case JOURNAL_FREE_BORDERS:
+        entry->value = data->free_borders;
+        data->free_borders = value;
+        break;
+    case JOURNAL_USED_FIELDS:
+        entry->value = data->used_fields;
+        data->used_fields = value;
+        break;
+    default: // golden targets
+        entry->value = data->golden_targets;
+        data->golden_targets = value;
+    }
+}
+
+/** @brief Swaps value of the word with value kept in the entry.
+ * On sparse board the field must have place, which it has as it was
+ * busy when number of busy fields was the same.
+ * @param[in, out] g     - pointer to structure holding game status,
+ * @param[in, out] entry - pointer to applied entry.
+ */
+static void apply(gamma_t* g, journal_entry* entry) {
+    uint64_t value = entry->value, index = entry->index;
+    field_set* set;
+    switch (entry->kind) {
+    case JOURNAL_OWNER:
+        entry->value = get_owner(g, index);
+        set_owner(g, index, value);
+        break;
+    case JOURNAL_NODE:
+        entry->value = get_node(g, index);
+        set_node(g, index, value);
+        break;
+    case JOURNAL_PARENT:
+        entry->value = get_parent(g, index);
+        set_parent(g, index, value);
+        break;
+    case JOURNAL_RISKY:
+    case JOURNAL_FRONTIER:
+        set = entry->kind == JOURNAL_RISKY ?
+              &g->players_array[entry->player].risky_targets :
+              &g->players_array[entry->player].frontier;
+        entry->value = field_set_contains(set, index);
+        if (value)
+            field_set_add(set, index); // set is incomplete if this fails
+        else
+            field_set_remove(set, index);
+        if (entry->kind == JOURNAL_FRONTIER)
+            emit_event(g, GAMMA_EVENT_FRONTIER, entry->player, index, value);
+        break;
+    case JOURNAL_FREE_FIELDS:
+        entry->value = g->free_fields;
+        g->free_fields = value;
+        break;
+    case JOURNAL_USED_NODES:
+        entry->value = g->used_nodes;
+        g->used_nodes = value;
+        break;
+    default:
+        apply_counter(g, entry);
+    }
+}
+
+/** @brief Forgets every step of the journal.
+ * @param[in, out] j - pointer to the journal.
+ */
+static void forget(journal* j) {
+    j->entries_size = 0;
+    j->steps_size = 0;
+    j->done = 0;
+}
+
+void journal_end(gamma_t* g, bool keep) {
+    journal* j = g->journal;
+    if (j == NULL)
+        return;
+    g->recording = false;
+    write_counters(g);
+    uint64_t begin = j->step_begin;
+    if (!j->lost && !keep) {
+        // changes are undone in reverse order
+        for (uint64_t i = j->entries_size; i-- > begin;)
+            apply(g, &j->entries[i]);
+        j->entries_size = begin;
+        return;
+    }
+    if (!j->lost && reserve((void**)&j->steps, &j->steps_capacity, j->done,
+                            sizeof(uint64_t))) {
+        // entries of undone steps are replaced with the new step
+        uint64_t done_end = j->done > 0 ? j->steps[j->done - 1] : 0;
+        if (done_end < begin)
+            memmove(j->entries + done_end, j->entries + begin,
+                    (j->entries_size - begin) * sizeof(journal_entry));
+        j->entries_size -= begin - done_end;
+        j->steps[j->done++] = j->entries_size;
+        j->steps_size = j->done;
+        return;
+    }
+    // state of the game is right, but the move can't be undone
+    j->lost = false;
+    forget(j);
+}
+
+void journal_free(gamma_t* g) {
+    if (g->journal != NULL) {
+        free(g->journal->entries);
+        free(g->journal->steps);
+        free(g->journal);
+        g->journal = NULL;
+    }
+}
+
+bool gamma_journal(gamma_t *g, bool enabled) {
+    if (g == NULL)
+        return false; // incorrect parameter
+    if (!enabled)
+        journal_free(g);
+    else if (g->journal == NULL)
+        g->journal = calloc(1, sizeof(journal));
+    return !enabled || g->journal != NULL;
+}
+
+/** @brief Publishes counters of players changed by the step.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] begin     - first entry of the step,
+ * @param[in] end       - entry after the last one of the step.
+ */
+static void publish_step(gamma_t* g, uint64_t begin, uint64_t end) {
+    if (g->published == NULL)
+        return;
+    for (uint64_t i = begin; i < end; i++) {
+        journal_entry* entry = &g->journal->entries[i];
+        if (entry->kind == JOURNAL_USED_AREAS ||
+            entry->kind == JOURNAL_FREE_BORDERS ||
+            entry->kind == JOURNAL_USED_FIELDS)
+            publish_player(g, entry->index);
+    }
+}
+
+bool gamma_undo(gamma_t *g) {
+    if (g == NULL || g->journal == NULL || g->journal->done == 0)
+        return false; // nothing to undo
+    journal* j = g->journal;
+    uint64_t end = j->steps[j->done - 1];
+    uint64_t begin = j->done > 1 ? j->steps[j->done - 2] : 0;
+    publish_begin(g);
+    // every entry changes at most one shared tile
+    bool result = reserve_tiles(g, end - begin);
+    if (result) {
+        j->done--;
+        for (uint64_t i = end; i-- > begin;)
+            apply(g, &j->entries[i]);
+        publish_step(g, begin, end);
+    }
+    publish_end(g);
+    return result;
+}
+
+bool gamma_redo(gamma_t *g) {
+    if (g == NULL || g->journal == NULL ||
+        g->journal->done == g->journal->steps_size)
+        return false; // nothing to redo
+    journal* j = g->journal;
+    uint64_t begin = j->done > 0 ? j->steps[j->done - 1] : 0;
+    uint64_t end = j->steps[j->done];
+    publish_begin(g);
+    bool result = reserve_tiles(g, end - begin);
+    if (result) {
+        j->done++;
+        for (uint64_t i = begin; i < end; i++)
+            apply(g, &j->entries[i]);
+        publish_step(g, begin, end);
+    }
+    publish_end(g);
+    return result;
+}
@@ -0,0 +1,71 @@
+/** @file
+ * Interface of journal of moves.
+ * Every move is a step of the journal holding previous values of words of
+ * the game changed by the move. Applying an entry swaps the value of the
+ * word with the kept one, so the same entries undo and redo the step.
+ * Complexity of undoing and redoing a step is proportional to the number of
+ * words changed by it.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+
+/** @brief Kinds of words of the game kept in the journal. */
+enum journal_kind {
+    JOURNAL_OWNER, ///< owner of the field.
+    JOURNAL_NODE, ///< find-and-union node of the field.
+    JOURNAL_PARENT, ///< parent of find-and-union node.
+    JOURNAL_RISKY, ///< if the field is a risky target of the player.
+    JOURNAL_FRONTIER, ///< if the field is in frontier of the player.
+    JOURNAL_USED_GOLDEN, ///< if the player used golden move.
+    JOURNAL_USED_AREAS, ///< number of areas of the player.
+    JOURNAL_FREE_BORDERS, ///< free fields adjacent to the player.
+    JOURNAL_USED_FIELDS, ///< number of fields of the player.
+    JOURNAL_GOLDEN_TARGETS, ///< foreign fields safe for the player to take.
+    JOURNAL_FREE_FIELDS, ///< number of free fields.
+    JOURNAL_USED_NODES ///< number of used find-and-union nodes.
+};
+
+/** @brief Writes previous value of a word changed during the step.
+ * If memory for the entry couldn't be allocated whole journal is forgotten
+ * when the step ends.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] kind      - kind of the word,
+ * @param[in] player    - number of the player for risky targets,
+ * @param[in] index     - number of field, node or player of the word,
+ * @param[in] value     - value of the word before the change.
+ */
+void journal_word(gamma_t* g, enum journal_kind kind, uint32_t player,
+                  uint64_t index, uint64_t value);
+
+/** @brief Starts recording changes made by a move.
+ * Does nothing if the journal isn't kept. Remembers state of every player
+ * who can be affected by a move on given field.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] player - number of player performing the move,
+ * @param[in] x      - horizontal position on board,
+ * @param[in] y      - vertical position on board.
+ */
+void journal_begin(gamma_t* g, uint32_t player, uint32_t x, uint32_t y);
+
+/** @brief Ends recording changes made by a move.
+ * Kept move becomes a new step of the journal and steps undone before are
+ * forgotten. Otherwise every change made since journal_begin is undone.
+ * @param[in, out] g - pointer to structure holding game status,
+ * @param[in] keep   - if the move was performed.
+ */
+void journal_end(gamma_t* g, bool keep);
+
+/** @brief Frees the journal of the game.
+ * @param[in, out] g - pointer to structure holding game status.
+ */
+void journal_free(gamma_t* g);
+
+#endif /* JOURNAL_H */
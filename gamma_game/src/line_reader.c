@@ -0,0 +1,143 @@
+/** @file
+ * Implementation of reading input lines in batch mode.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "line_reader.h"
+
+/** @brief Initial size of buffer for input which is not mapped. */
+#define INITIAL_BUFFER (1 << 16)
+
+bool open_reader(line_reader* reader, int fd) {
+    reader->fd = fd;
+    reader->position = 0;
+    reader->read_ahead = false;
+    reader->finished = false;
+
+    struct stat input_stat;
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (fstat(fd, &input_stat) == 0 && S_ISREG(input_stat.st_mode) &&
+        offset >= 0 && input_stat.st_size > offset) {
+        void* data = mmap(NULL, input_stat.st_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, input_stat.st_size, MADV_SEQUENTIAL);
+            reader->data = data;
+            reader->size = input_stat.st_size;
+            reader->capacity = 0;
+            reader->position = offset;
+            return true;
+        }
+    }
+    reader->data = malloc(INITIAL_BUFFER);
+    reader->size = 0;
+    reader->capacity = INITIAL_BUFFER;
+    return reader->data != NULL;
+}
+
+/** @brief Reads more input into the buffer.
+ * Moves unfinished line to the beginning of the buffer and enlarges
+ * the buffer if it is full. Without read ahead reads single byte.
+ * @param[in, out] reader   - pointer to the reader.
+ * @return False if input ended or couldn't be read.
+ */
+static bool fill_buffer(line_reader* reader) {
+    if (reader->position > 0) {
+        memmove(reader->data, reader->data + reader->position,
+                reader->size - reader->position);
+        reader->size -= reader->position;
+        reader->position = 0;
+    }
+    if (reader->size == reader->capacity) {
+        char* data = realloc(reader->data, reader->capacity * 2);
+        if (data == NULL)
+            return false; // failed to allocate memory
+        reader->data = data;
+        reader->capacity *= 2;
+    }
+    size_t wanted = reader->read_ahead ? reader->capacity - reader->size : 1;
+    while (true) {
+        ssize_t result = read(reader->fd, reader->data + reader->size, wanted);
+        if (result > 0) {
+            reader->size += result;
+            return true;
+        }
+        if (result == 0 || errno != EINTR)
+            return false; // end of input or reading error
+    }
+}
+
+bool next_line(line_reader* reader, char** line, size_t* length) {
+    if (reader->capacity == 0) { // mapped file
+        if (reader->position == reader->size)
+            return false; // end of input
+        char* begin = reader->data + reader->position;
+        size_t left = reader->size - reader->position;
+        char* end = memchr(begin, '\n', left);
+        *line = begin;
+        *length = end == NULL ? left : (size_t)(end - begin) + 1;
+        reader->position += *length;
+        return true;
+    }
+
+    size_t searched = reader->position;
+    while (true) {
+        char* end = memchr(reader->data + searched, '\n',
+                           reader->size - searched);
+        if (end != NULL || (reader->finished &&
+                            reader->position < reader->size)) {
+            size_t line_end = end == NULL ? reader->size :
+                              (size_t)(end - reader->data) + 1;
+            *line = reader->data + reader->position;
+            *length = line_end - reader->position;
+            reader->position = line_end;
+            return true;
+        }
+        if (reader->finished)
+            return false; // end of input
+        searched = reader->size - reader->position; // offset after moving
+        if (!fill_buffer(reader)) {
+            reader->finished = true;
+            searched = reader->position;
+        }
+    }
+}
+
+size_t next_bytes(line_reader* reader, char** data, size_t size) {
+    while (reader->size - reader->position < size && !reader->finished) {
+        if (reader->capacity == 0 || !fill_buffer(reader))
+            reader->finished = true; // end of input
+    }
+    size_t left = reader->size - reader->position;
+    if (size > left)
+        size = left;
+    *data = reader->data + reader->position;
+    reader->position += size;
+    return size;
+}
+
+void allow_read_ahead(line_reader* reader) {
+    reader->read_ahead = true;
+}
+
+void close_reader(line_reader* reader) {
+    if (reader->capacity == 0) {
+        munmap(reader->data, reader->size);
+        // further input is read from the descriptor
+        lseek(reader->fd, reader->position, SEEK_SET);
+    }
+    else {
+        free(reader->data);
+    }
+    reader->data = NULL;
+}
@@ -0,0 +1,67 @@
+/** @file
+ * Interface of reading input lines in batch mode.
+ */
+
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Structure representing input split into lines.
+ * Regular files are mapped into memory, other inputs are read into
+ * a buffer. Until read ahead is allowed pipes are read byte by byte,
+ * so input after the last given line can be read by someone else.
+ */
+typedef struct line_reader {
+    int fd; ///< descriptor of the input.
+    char* data; ///< mapped file or buffer with read input.
+    size_t size; ///< size of mapped file or number of bytes in buffer.
+    size_t capacity; ///< size of buffer, zero for mapped file.
+    size_t position; ///< offset of the first byte not given as line.
+    bool read_ahead; ///< if input may be read after the current line.
+    bool finished; ///< if end of input was reached.
+} line_reader;
+
+/** @brief Prepares reading lines from given descriptor.
+ * @param[out] reader   - pointer to initialized reader,
+ * @param[in] fd        - descriptor of the input.
+ * @return False if memory couldn't be allocated.
+ */
+bool open_reader(line_reader* reader, int fd);
+
+/** @brief Gives next line of input.
+ * The line ends with '\n' unless it is the last line of input. It may
+ * contain '\0' characters and it is not ended with '\0'. The line can
+ * be modified and stays valid until the next call.
+ * @param[in, out] reader   - pointer to the reader,
+ * @param[out] line         - pointer to the beginning of the line,
+ * @param[out] length       - number of characters of the line.
+ * @return False if there are no more lines.
+ */
+bool next_line(line_reader* reader, char** line, size_t* length);
+
+/** @brief Gives next bytes of input.
+ * The bytes can be modified and stay valid until the next call.
+ * @param[in, out] reader   - pointer to the reader,
+ * @param[out] data         - pointer to the first byte,
+ * @param[in] size          - number of wanted bytes.
+ * @return Number of given bytes, less then @p size only at the end of input.
+ */
+size_t next_bytes(line_reader* reader, char** data, size_t size);
+
+/** @brief Allows reading input after the current line.
+ * @param[in, out] reader   - pointer to the reader.
+ */
+void allow_read_ahead(line_reader* reader);
+
+/** @brief Frees the reader.
+ * Unless read ahead was allowed the descriptor is left just after
+ * the last given line.
+ * @param[in, out] reader   - pointer to the reader.
+ */
+void close_reader(line_reader* reader);
+
+#endif /* LINE_READER_H */
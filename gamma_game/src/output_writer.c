@@ -0,0 +1,94 @@
+/** @file
+ * Implementation of buffered output of batch mode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "output_writer.h"
+
+/** @brief Size of output buffer. */
+#define WRITER_BUFFER (1 << 16)
+
+/** @brief Maximum number of digits of uint64_t. */
+#define MAX_DIGITS 20
+
+void open_writer(output_writer* writer, int fd) {
+    writer->fd = fd;
+    writer->sink = NULL;
+    writer->sink_data = NULL;
+    writer->buffer = malloc(WRITER_BUFFER);
+    writer->used = 0;
+    writer->capacity = writer->buffer == NULL ? 0 : WRITER_BUFFER;
+    writer->failed = false;
+}
+
+void open_sink_writer(output_writer* writer, output_sink sink, void* data) {
+    open_writer(writer, -1);
+    writer->sink = sink;
+    writer->sink_data = data;
+}
+
+/** @brief Writes characters directly to the descriptor or the sink.
+ * @param[in, out] writer   - pointer to the writer,
+ * @param[in] text          - pointer to the characters,
+ * @param[in] length        - number of characters.
+ */
+static void write_all(output_writer* writer, const char* text, size_t length) {
+    if (writer->sink != NULL) {
+        if (length > 0)
+            writer->sink(writer->sink_data, text, length);
+        return; // output is given to the sink
+    }
+    while (length > 0 && !writer->failed) {
+        ssize_t result = write(writer->fd, text, length);
+        if (result > 0) {
+            text += result;
+            length -= result;
+        }
+        else if (result < 0 && errno != EINTR) {
+            writer->failed = true; // output can't be written
+        }
+    }
+}
+
+bool flush_writer(output_writer* writer) {
+    write_all(writer, writer->buffer, writer->used);
+    writer->used = 0;
+    return !writer->failed;
+}
+
+void write_text(output_writer* writer, const char* text, size_t length) {
+    if (writer->used + length > writer->capacity) {
+        flush_writer(writer);
+        if (length > writer->capacity) {
+            write_all(writer, text, length);
+            return; // text doesn't fit in the buffer
+        }
+    }
+    memcpy(writer->buffer + writer->used, text, length);
+    writer->used += length;
+}
+
+void write_number(output_writer* writer, uint64_t number) {
+    char digits[MAX_DIGITS];
+    char* begin = digits + MAX_DIGITS;
+    do {
+        *--begin = (char)('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+    write_text(writer, begin, digits + MAX_DIGITS - begin);
+}
+
+bool close_writer(output_writer* writer) {
+    bool written = flush_writer(writer);
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->capacity = 0;
+    return written;
+}
@@ -0,0 +1,73 @@
+/** @file
+ * Interface of buffered output of batch mode.
+ */
+
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Function receiving output instead of a descriptor.
+ * @param[in, out] data - data given when the writer was opened,
+ * @param[in] text      - pointer to the characters,
+ * @param[in] length    - number of characters.
+ */
+typedef void (*output_sink)(void* data, const char* text, size_t length);
+
+/** @brief Structure representing buffered output to a descriptor.
+ * Characters are kept in the buffer until it is full or flushed.
+ */
+typedef struct output_writer {
+    int fd; ///< descriptor the output is written to, -1 for a sink.
+    output_sink sink; ///< function receiving the output or NULL.
+    void* sink_data; ///< data passed to the sink.
+    char* buffer; ///< characters waiting to be written.
+    size_t used; ///< number of characters in the buffer.
+    size_t capacity; ///< size of the buffer.
+    bool failed; ///< if some output couldn't be written.
+} output_writer;
+
+/** @brief Prepares buffered output to given descriptor.
+ * If memory couldn't be allocated output is not buffered.
+ * @param[out] writer   - pointer to initialized writer,
+ * @param[in] fd        - descriptor of the output.
+ */
+void open_writer(output_writer* writer, int fd);
+
+/** @brief Prepares buffered output given to a function.
+ * Flushed characters are passed to the sink instead of a descriptor.
+ * @param[out] writer   - pointer to initialized writer,
+ * @param[in] sink      - function receiving the output,
+ * @param[in] data      - data passed to the sink.
+ */
+void open_sink_writer(output_writer* writer, output_sink sink, void* data);
+
+/** @brief Writes all buffered characters to the descriptor.
+ * @param[in, out] writer   - pointer to the writer.
+ * @return False if some output couldn't be written.
+ */
+bool flush_writer(output_writer* writer);
+
+/** @brief Adds characters to the output.
+ * @param[in, out] writer   - pointer to the writer,
+ * @param[in] text          - pointer to the characters,
+ * @param[in] length        - number of characters.
+ */
+void write_text(output_writer* writer, const char* text, size_t length);
+
+/** @brief Adds decimal representation of the number to the output.
+ * @param[in, out] writer   - pointer to the writer,
+ * @param[in] number        - written number.
+ */
+void write_number(output_writer* writer, uint64_t number);
+
+/** @brief Flushes and frees the writer.
+ * @param[in, out] writer   - pointer to the writer.
+ * @return False if some output couldn't be written.
+ */
+bool close_writer(output_writer* writer);
+
+#endif /* OUTPUT_WRITER_H */
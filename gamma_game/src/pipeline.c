@@ -0,0 +1,198 @@
+/** @file
+ * Implementation of pipelined batch mode.
+ * The parser thread puts parsed lines into one ring, the calling thread
+ * runs them and puts answers into another ring taken by the writer thread.
+ * Commands writing more than a number, or writing to a file, are run by
+ * the calling thread while the writer waits, after it wrote every earlier
+ * answer, so outputs are given in order of input lines.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "gamma.h"
+#include "batch_mode.h"
+#include "line_reader.h"
+#include "pipeline.h"
+#include "ring.h"
+
+/** @brief Number of records kept in every ring. */
+#define RING_CAPACITY 4096
+
+/** @brief Line number of the record closing a ring. */
+#define END_OF_INPUT 0
+
+/** @brief Kinds of records taken by the writer thread. */
+enum {
+    RESULT_ANSWER, ///< answer of a command.
+    RESULT_ERROR, ///< ERROR for the line.
+    RESULT_PAUSE, ///< writer waits while the calling thread writes.
+    RESULT_END ///< no more records.
+};
+
+/** @brief Structure representing parsed line of input.
+ */
+typedef struct parsed_line {
+    int line_number; ///< number of the line, END_OF_INPUT after the last.
+    bool proper; ///< if the line is a valid command or a comment.
+    command my_command; ///< the command, its arguments are in args.
+    uint32_t args[4]; ///< integer parameters of the command.
+} parsed_line;
+
+/** @brief Structure representing record taken by the writer thread.
+ */
+typedef struct result {
+    int line_number; ///< number of the line the record answers.
+    int kind; ///< kind of the record, see RESULT_ANSWER.
+    uint64_t answer; ///< answer of the command.
+} result;
+
+/** @brief Structure representing state shared by threads of the pipeline.
+ */
+typedef struct pipeline {
+    spsc_ring lines; ///< parsed lines given to the calling thread.
+    spsc_ring results; ///< answers given to the writer thread.
+    line_reader* reader; ///< reader of input used by the parser thread.
+    int line_number; ///< number of the last line read before the pipeline.
+    batch_output* output; ///< outputs used by the writer thread.
+    atomic_bool paused; ///< if the writer gave outputs to the calling thread.
+} pipeline;
+
+/** @brief Reads and parses lines till the end of input.
+ * Path of 's' command is copied, as the line is valid only until the next
+ * one is read. If it can't be copied the line is not proper.
+ * @param[in, out] data - pointer to the pipeline.
+ * @return NULL.
+ */
+static void* parse_lines(void* data) {
+    pipeline* stages = data;
+    parsed_line line;
+    char* input_line;
+    size_t length;
+    line.line_number = stages->line_number;
+    while (next_line(stages->reader, &input_line, &length)) {
+        line.line_number++;
+        line.my_command.args = line.args;
+        line.proper = parse_line(input_line, length, &line.my_command, true);
+        if (line.proper && line.my_command.command_type == 's') {
+            line.my_command.path = strdup(line.my_command.path);
+            line.proper = line.my_command.path != NULL;
+        }
+        ring_put(&stages->lines, &line);
+    }
+    line.line_number = END_OF_INPUT;
+    ring_put(&stages->lines, &line);
+    return NULL;
+}
+
+/** @brief Writes answers and errors till the end record.
+ * After a pause record the thread waits until outputs are given back.
+ * @param[in, out] data - pointer to the pipeline.
+ * @return NULL.
+ */
+static void* write_results(void* data) {
+    pipeline* stages = data;
+    result record;
+    while (true) {
+        ring_take(&stages->results, &record);
+        if (record.kind == RESULT_END)
+            return NULL;
+        if (record.kind == RESULT_ANSWER)
+            print_answer(stages->output, record.line_number, record.answer);
+        if (record.kind == RESULT_ERROR)
+            print_error(stages->output, record.line_number);
+        if (record.kind == RESULT_PAUSE) {
+            atomic_store_explicit(&stages->paused, true, memory_order_release);
+            unsigned rounds = 0;
+            while (atomic_load_explicit(&stages->paused, memory_order_acquire))
+                ring_wait(&rounds);
+        }
+    }
+}
+
+/** @brief Gives record to the writer thread.
+ * @param[in, out] stages   - pointer to the pipeline,
+ * @param[in] line_number   - number of the line the record answers,
+ * @param[in] kind          - kind of the record,
+ * @param[in] answer        - answer of the command.
+ */
+static void put_result(pipeline* stages, int line_number, int kind,
+                       uint64_t answer) {
+    result record = {line_number, kind, answer};
+    ring_put(&stages->results, &record);
+}
+
+/** @brief Runs command writing to outputs or files itself.
+ * The writer thread writes earlier answers first and waits meanwhile.
+ * @param[in, out] stages   - pointer to the pipeline,
+ * @param[in, out] line     - pointer to the parsed line,
+ * @param[in, out] g        - pointer to structure holding game status.
+ */
+static void run_paused(pipeline* stages, parsed_line* line, gamma_t* g) {
+    put_result(stages, line->line_number, RESULT_PAUSE, 0);
+    unsigned rounds = 0;
+    while (!atomic_load_explicit(&stages->paused, memory_order_acquire))
+        ring_wait(&rounds);
+    if (!run_command(&line->my_command, &g, line->line_number, stages->output))
+        print_error(stages->output, line->line_number);
+    atomic_store_explicit(&stages->paused, false, memory_order_release);
+    if (line->my_command.command_type == 's')
+        free(line->my_command.path);
+}
+
+bool run_pipeline(line_reader* reader, gamma_t* g, int line_number,
+                  batch_output* output) {
+    pipeline stages;
+    if (!open_ring(&stages.lines, RING_CAPACITY, sizeof(parsed_line)))
+        return false; // failed to allocate memory
+    if (!open_ring(&stages.results, RING_CAPACITY, sizeof(result))) {
+        close_ring(&stages.lines);
+        return false; // failed to allocate memory
+    }
+    stages.reader = reader;
+    stages.line_number = line_number;
+    stages.output = output;
+    atomic_init(&stages.paused, false);
+
+    pthread_t parser, writer;
+    if (pthread_create(&writer, NULL, write_results, &stages) != 0) {
+        close_ring(&stages.results);
+        close_ring(&stages.lines);
+        return false; // failed to start the writer
+    }
+    if (pthread_create(&parser, NULL, parse_lines, &stages) != 0) {
+        put_result(&stages, END_OF_INPUT, RESULT_END, 0);
+        pthread_join(writer, NULL);
+        close_ring(&stages.results);
+        close_ring(&stages.lines);
+        return false; // failed to start the parser, no input was read
+    }
+
+    parsed_line line;
+    while (true) {
+        ring_take(&stages.lines, &line);
+        if (line.line_number == END_OF_INPUT)
+            break; // parser read the whole input
+        // record was copied, so arguments have to be pointed again
+        line.my_command.args = line.args;
+        if (!line.proper)
+            put_result(&stages, line.line_number, RESULT_ERROR, 0);
+        else if (number_command(&line.my_command))
+            put_result(&stages, line.line_number, RESULT_ANSWER,
+                       run_number_command(&line.my_command, g));
+        else if (line.my_command.command_type != '#')
+            run_paused(&stages, &line, g);
+    }
+    put_result(&stages, END_OF_INPUT, RESULT_END, 0);
+    pthread_join(parser, NULL);
+    pthread_join(writer, NULL);
+    close_ring(&stages.results);
+    close_ring(&stages.lines);
+    return true;
+}
@@ -0,0 +1,35 @@
+/** @file
+ * Interface of pipelined batch mode.
+ * Input lines are parsed on one thread, commands are run on the calling
+ * thread and answers are written on another one. Stages are connected by
+ * lock-free rings, so long inputs are run at about the speed of the game
+ * instead of the sum of all stages. Answers and errors are written in the
+ * same order and with the same line numbers as in serial batch mode.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gamma.h"
+#include "batch_mode.h"
+#include "line_reader.h"
+
+/** @brief Runs the rest of batch mode input on three threads.
+ * Input is read till its end, every line is run like in serial batch mode.
+ * Commands printing the board, saving the game, suggesting moves and
+ * printing counters wait until earlier answers are written.
+ * @param[in, out] reader   - pointer to the reader of input,
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in] line_number   - number of the last line read so far,
+ * @param[in, out] output   - pointer to outputs of batch mode.
+ * @return False if threads couldn't be started, no input is read then.
+ */
+bool run_pipeline(line_reader* reader, gamma_t* g, int line_number,
+                  batch_output* output);
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,221 @@
+/** @file
+ * Implementation of bit planes of small boards.
+ * Plane of every player, including player 0 holding free fields, takes
+ * height consecutive words of one array. Bit x of word y is set if the field
+ * (x, y) belongs to the player.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "borders.h"
+#include "board.h"
+#include "planes.h"
+
+/** @brief Structure representing fill of the area from single field.
+ * Fields of every row reached so far always make whole runs of the area.
+ */
+typedef struct plane_fill {
+    uint64_t rows[PLANE_SIZE]; ///< reached fields of every row.
+    uint32_t low; ///< first row with reached fields.
+    uint32_t high; ///< last row with reached fields.
+    uint32_t x; ///< horizontal position of the first field.
+    uint32_t y; ///< vertical position of the first field.
+    bool growing; ///< if the last sweep reached new fields.
+    uint32_t group; ///< fill representing group of connected fills.
+} plane_fill;
+
+bool init_planes(gamma_t* g) {
+    g->planes = NULL;
+    if (g->width > PLANE_SIZE || g->height > PLANE_SIZE ||
+        g->players > PLANE_PLAYERS || g->sparse)
+        return true; // board too large for planes
+    uint64_t* planes = calloc(((uint64_t)g->players + 1) * g->height,
+                              sizeof(uint64_t));
+    if (planes == NULL)
+        return false; // failed to allocate memory
+
+    for (uint32_t y = 0; y < g->height; y++) {
+        for (uint32_t x = 0; x < g->width; x++) {
+            uint32_t owner = get_owner(g, y * (uint64_t)g->width + x);
+            if (owner <= g->players)
+                planes[(uint64_t)owner * g->height + y] |= 1ULL << x;
+        }
+    }
+    g->planes = planes;
+    return true;
+}
+
+bool clone_planes(gamma_t* copy, gamma_t* g) {
+    copy->planes = NULL;
+    if (g->planes == NULL)
+        return true; // nothing to copy
+    size_t size = ((uint64_t)g->players + 1) * g->height * sizeof(uint64_t);
+    copy->planes = malloc(size);
+    if (copy->planes == NULL)
+        return false; // failed to allocate memory
+    memcpy(copy->planes, g->planes, size);
+    return true;
+}
+
+void free_planes(gamma_t* g) {
+    free(g->planes);
+    g->planes = NULL;
+}
+
+/** @brief Spreads fields of the row along runs of the area.
+ * Kogge-Stone fill, after the step with given shift every field at most
+ * twice the shift away from a seed along its run is set.
+ * @param[in] seeds - reached fields of the row, all of them in the area,
+ * @param[in] mask  - fields of the area in the row.
+ * @return Fields of runs holding any seed.
+ */
+static inline uint64_t fill_row(uint64_t seeds, uint64_t mask) {
+    uint64_t left = seeds, right = seeds;
+    uint64_t left_pass = mask, right_pass = mask;
+    for (int shift = 1; shift < 64; shift *= 2) {
+        left |= left_pass & (left << shift);
+        left_pass &= left_pass << shift;
+        right |= right_pass & (right >> shift);
+        right_pass &= right_pass >> shift;
+    }
+    return left | right;
+}
+
+/** @brief Spreads the fill into the row from the row and rows around it.
+ * @param[in, out] fill - pointer to the fill,
+ * @param[in] mask      - rows of the area,
+ * @param[in] height    - number of rows,
+ * @param[in] row       - number of the row.
+ * @return True if new fields were reached.
+ */
+static bool spread(plane_fill* fill, const uint64_t* mask, uint32_t height,
+                   uint32_t row) {
+    uint64_t seeds = fill->rows[row];
+    if (row > 0)
+        seeds |= fill->rows[row - 1];
+    if (row + 1 < height)
+        seeds |= fill->rows[row + 1];
+    seeds &= mask[row];
+    if ((seeds & ~fill->rows[row]) == 0)
+        return false; // runs of the row are reached already
+    fill->rows[row] = fill_row(seeds, mask[row]);
+    if (row < fill->low)
+        fill->low = row;
+    if (row > fill->high)
+        fill->high = row;
+    return true;
+}
+
+/** @brief Sweeps the fill down and up the board once.
+ * Fill grows along any path which turns at most twice, so area is filled
+ * after number of sweeps proportional to turns of its paths.
+ * @param[in, out] fill - pointer to the fill,
+ * @param[in] mask      - rows of the area,
+ * @param[in] height    - number of rows.
+ */
+static void sweep(plane_fill* fill, const uint64_t* mask, uint32_t height) {
+    bool grown = false;
+    uint32_t row = fill->low > 0 ? fill->low - 1 : 0;
+    for (; row < height && row <= fill->high + 1; row++)
+        grown |= spread(fill, mask, height, row);
+
+    row = fill->high + 1 < height ? fill->high + 1 : height - 1;
+    while (true) {
+        grown |= spread(fill, mask, height, row);
+        if (row == 0 || row < fill->low)
+            break; // row above the fill is checked
+        row--;
+    }
+    fill->growing = grown;
+}
+
+/** @brief Finds fill representing group of given fill.
+ * @param[in] fills    - array of fills,
+ * @param[in] number   - number of given fill.
+ * @return Number of fill representing the group.
+ */
+static uint32_t fill_group(plane_fill* fills, uint32_t number) {
+    while (fills[number].group != number)
+        number = fills[number].group;
+    return number;
+}
+
+/** @brief Starts fill from the field.
+ * @param[in, out] fill - pointer to the fill,
+ * @param[in] mask      - rows of the area,
+ * @param[in] height    - number of rows,
+ * @param[in] x         - horizontal position of the field,
+ * @param[in] y         - vertical position of the field,
+ * @param[in] number    - number of the fill.
+ */
+static void start_fill(plane_fill* fill, const uint64_t* mask,
+                       uint32_t height, uint32_t x, uint32_t y,
+                       uint32_t number) {
+    memset(fill->rows, 0, height * sizeof(uint64_t));
+    fill->rows[y] = fill_row(1ULL << x, mask[y]);
+    fill->low = fill->high = y;
+    fill->x = x;
+    fill->y = y;
+    fill->growing = true;
+    fill->group = number;
+}
+
+int plane_areas_after_freeing(gamma_t* g, uint32_t player, uint32_t x,
+                              uint32_t y) {
+    uint32_t height = g->height;
+    uint64_t mask[PLANE_SIZE];
+    memcpy(mask, g->planes + (uint64_t)player * height,
+           height * sizeof(uint64_t));
+    mask[y] &= ~(1ULL << x);
+
+    uint32_t xs[4], ys[4], neighbours = 0;
+    if (x > 0)
+        xs[neighbours] = x - 1, ys[neighbours++] = y;
+    if (x + 1 < g->width)
+        xs[neighbours] = x + 1, ys[neighbours++] = y;
+    if (y > 0)
+        xs[neighbours] = x, ys[neighbours++] = y - 1;
+    if (y + 1 < height)
+        xs[neighbours] = x, ys[neighbours++] = y + 1;
+
+    plane_fill fills[4];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < neighbours; i++) {
+        if (mask[ys[i]] >> xs[i] & 1) {
+            start_fill(&fills[count], mask, height, xs[i], ys[i], count);
+            count++;
+        }
+    }
+
+    uint32_t growing = count;
+    while (growing > 1) {
+        // every growing fill makes one sweep so none of them goes far ahead
+        for (uint32_t i = 0; i < count; i++)
+            if (fills[i].group == i && fills[i].growing)
+                sweep(&fills[i], mask, height);
+        for (uint32_t i = 0; i < count; i++) {
+            if (fills[i].group != i)
+                continue;
+            for (uint32_t j = 0; j < count; j++) {
+                uint32_t group = fill_group(fills, j);
+                if (group != i && (fills[i].rows[fills[j].y] >>
+                                   fills[j].x & 1))
+                    fills[group].group = i; // fills met in the same area
+            }
+        }
+        growing = 0;
+        for (uint32_t i = 0; i < count; i++)
+            if (fills[i].group == i && fills[i].growing)
+                growing++;
+    }
+
+    int result = 0;
+    for (uint32_t i = 0; i < count; i++)
+        if (fills[i].group == i)
+            result++;
+    return result;
+}
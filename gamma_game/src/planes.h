@@ -0,0 +1,79 @@
+/** @file
+ * Interface of bit planes of small boards.
+ * On boards at most PLANE_SIZE fields wide and high every player's fields
+ * are also kept as rows of bits, one 64-bit word per row. Areas are then
+ * searched with shifts of whole rows instead of visiting single fields.
+ * Planes are changed together with owners of fields, so they follow moves,
+ * undoing and redoing them without separate journal entries.
+ */
+
+#ifndef PLANES_H
+#define PLANES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+
+/** @brief Maximal width and height of a board kept in planes. */
+#define PLANE_SIZE 64
+
+/** @brief Maximal number of players of a game kept in planes. */
+#define PLANE_PLAYERS 1024
+
+/** @brief Moves the field from plane of one player to another.
+ * Player 0 stands for free fields. Does nothing if the game has no planes.
+ * Complexity O(1)
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] board_num - number of the field on the board,
+ * @param[in] from      - previous owner of the field,
+ * @param[in] to        - new owner of the field.
+ */
+static inline void plane_move(gamma_t* g, uint64_t board_num, uint32_t from,
+                              uint32_t to) {
+    uint32_t x = board_num % g->width, y = board_num / g->width;
+    uint64_t bit = 1ULL << x;
+    g->planes[(uint64_t)from * g->height + y] &= ~bit;
+    g->planes[(uint64_t)to * g->height + y] |= bit;
+}
+
+/** @brief Builds planes if the board is small enough.
+ * Expects the board to be set. Owners greater than number of players,
+ * which may be read from damaged snapshot, are left out.
+ * Complexity O(n) where n stands for number of fields.
+ * @param[in, out] g    - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated.
+ */
+bool init_planes(gamma_t* g);
+
+/** @brief Copies planes to the clone.
+ * @param[in, out] copy - pointer to structure holding cloned game,
+ * @param[in] g         - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated, the clone has no planes
+ * then.
+ */
+bool clone_planes(gamma_t* copy, gamma_t* g);
+
+/** @brief Frees planes of the game.
+ * @param[in, out] g    - pointer to structure holding game status.
+ */
+void free_planes(gamma_t* g);
+
+/** @brief Counts areas player's area would split into without given field.
+ * Works like count_areas_after_freeing on a game with planes. Fills areas
+ * from every player's field adjacent to the freed one at once, a sweep over
+ * rows at a time, and stops when at most one fill can still grow.
+ * Complexity O(h * s) where h stands for board height and s for number of
+ * turns of the longest path in disjoined areas except the largest one.
+ * @param[in] g      - pointer to structure holding game status,
+ * @param[in] player - owner of the field,
+ * @param[in] x      - horizontal position of player's field on board,
+ * @param[in] y      - vertical position of player's field on board.
+ * @return Number of those areas.
+ */
+int plane_areas_after_freeing(gamma_t* g, uint32_t player, uint32_t x,
+                              uint32_t y);
+
+#endif /* PLANES_H */
@@ -0,0 +1,253 @@
+/** @file
+ * Implementation of state of the game published for observer threads.
+ * The sequence is odd while the writer publishes counters. Observers read
+ * counters, then check that the sequence was even and didn't change. Every
+ * view remembers the sequence of the board it shows, views are shared while
+ * the sequence stays the same.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "borders.h"
+#include "board.h"
+#include "stats.h"
+#include "publish.h"
+#include "gamma.h"
+
+/** @brief Published borders of player who can start a new area. */
+#define ANY_FREE_FIELD UINT64_MAX
+
+/** @brief Structure representing published counters of player.
+ */
+typedef struct published_player {
+    atomic_uint_fast64_t busy; ///< number of player's fields.
+    atomic_uint_fast64_t borders; ///< fields player can take or ANY_FREE_FIELD.
+} published_player;
+
+/** @brief Structure representing view of the board.
+ * The game is the first member, so pointer to it is pointer to the view.
+ */
+typedef struct board_view {
+    gamma_t game; ///< game holding only owners of fields.
+    atomic_uint_fast64_t refs; ///< number of observers using the view.
+    uint64_t sequence; ///< sequence of the shown board.
+} board_view;
+
+/** @brief Structure representing state of the game published for observers.
+ */
+typedef struct published {
+    atomic_uint_fast64_t sequence; ///< number of publications, odd during one.
+    atomic_uint_fast64_t free_fields; ///< number of free fields.
+    published_player* players; ///< counters of every player.
+    pthread_mutex_t board_lock; ///< held while the board is changed.
+    pthread_mutex_t view_lock; ///< held while the latest view is taken.
+    board_view* view; ///< the latest view or NULL.
+} published;
+
+bool init_published(gamma_t* g) {
+    published* p = malloc(sizeof(published));
+    published_player* players = malloc(((uint64_t)g->players + 1) *
+                                       sizeof(published_player));
+    if (p == NULL || players == NULL) {
+        free(p);
+        free(players);
+        return false; // failed to allocate memory
+    }
+    atomic_init(&p->sequence, 0);
+    atomic_init(&p->free_fields, g->free_fields);
+    for (uint64_t i = 0; i <= g->players; i++) {
+        atomic_init(&players[i].busy, 0);
+        atomic_init(&players[i].borders, 0);
+    }
+    p->players = players;
+    pthread_mutex_init(&p->board_lock, NULL);
+    pthread_mutex_init(&p->view_lock, NULL);
+    p->view = NULL;
+    g->published = p;
+    for (uint32_t i = 1; i <= g->players && i != 0; i++)
+        publish_player(g, i);
+    return true;
+}
+
+void free_published(gamma_t* g) {
+    published* p = g->published;
+    if (p == NULL)
+        return;
+    if (p->view != NULL)
+        release_view(&p->view->game);
+    pthread_mutex_destroy(&p->board_lock);
+    pthread_mutex_destroy(&p->view_lock);
+    free(p->players);
+    free(p);
+    g->published = NULL;
+}
+
+void lock_board(gamma_t* g) {
+    if (g->published != NULL)
+        pthread_mutex_lock(&g->published->board_lock);
+}
+
+void unlock_board(gamma_t* g) {
+    if (g->published != NULL)
+        pthread_mutex_unlock(&g->published->board_lock);
+}
+
+void publish_begin(gamma_t* g) {
+    published* p = g->published;
+    if (p == NULL)
+        return;
+    pthread_mutex_lock(&p->board_lock);
+    uint64_t sequence = atomic_load_explicit(&p->sequence,
+                                             memory_order_relaxed);
+    atomic_store_explicit(&p->sequence, sequence + 1, memory_order_relaxed);
+    // counters can't be stored before observers see the odd sequence
+    atomic_thread_fence(memory_order_release);
+}
+
+void publish_player(gamma_t* g, uint32_t player) {
+    published* p = g->published;
+    if (p == NULL || player == 0 || player > g->players)
+        return; // owner of damaged snapshot is left out
+    player_t* data = &g->players_array[player];
+    uint64_t borders = data->used_areas == g->areas ? data->free_borders :
+                                                      ANY_FREE_FIELD;
+    atomic_store_explicit(&p->players[player].busy, data->used_fields,
+                          memory_order_relaxed);
+    atomic_store_explicit(&p->players[player].borders, borders,
+                          memory_order_relaxed);
+}
+
+void publish_area(gamma_t* g, uint32_t x, uint32_t y) {
+    if (g->published == NULL)
+        return;
+    for (int64_t i = (int64_t)y - 2; i <= (int64_t)y + 2; i++)
+        for (int64_t k = (int64_t)x - 2; k <= (int64_t)x + 2; k++)
+            if (i >= 0 && k >= 0 && i < g->height && k < g->width)
+                publish_player(g, get_owner(g, i * (uint64_t)g->width + k));
+}
+
+void publish_end(gamma_t* g) {
+    published* p = g->published;
+    if (p == NULL)
+        return;
+    atomic_store_explicit(&p->free_fields, g->free_fields,
+                          memory_order_relaxed);
+    uint64_t sequence = atomic_load_explicit(&p->sequence,
+                                             memory_order_relaxed);
+    atomic_store_explicit(&p->sequence, sequence + 1, memory_order_release);
+    pthread_mutex_unlock(&p->board_lock);
+}
+
+void read_published(gamma_t* g, uint32_t player, uint64_t* busy,
+                    uint64_t* available) {
+    published* p = g->published;
+    uint64_t sequence, borders, free_fields;
+    do {
+        sequence = atomic_load_explicit(&p->sequence, memory_order_acquire);
+        *busy = atomic_load_explicit(&p->players[player].busy,
+                                     memory_order_relaxed);
+        borders = atomic_load_explicit(&p->players[player].borders,
+                                       memory_order_relaxed);
+        free_fields = atomic_load_explicit(&p->free_fields,
+                                           memory_order_relaxed);
+        // counters have to be read before the sequence is checked again
+        atomic_thread_fence(memory_order_acquire);
+    } while ((sequence & 1) != 0 ||
+             atomic_load_explicit(&p->sequence, memory_order_relaxed) !=
+             sequence);
+    *available = borders == ANY_FREE_FIELD ? free_fields : borders;
+}
+
+/** @brief Takes the latest view if it shows the board of given sequence.
+ * @param[in, out] p        - pointer to published state,
+ * @param[in] sequence      - sequence of the current board.
+ * @return Pointer to the view or NULL if there's no such view.
+ */
+static board_view* current_view(published* p, uint64_t sequence) {
+    pthread_mutex_lock(&p->view_lock);
+    board_view* view = p->view;
+    if (view != NULL && view->sequence == sequence)
+        atomic_fetch_add_explicit(&view->refs, 1, memory_order_relaxed);
+    else
+        view = NULL;
+    pthread_mutex_unlock(&p->view_lock);
+    return view;
+}
+
+/** @brief Builds view of the board, expects the board to be locked.
+ * @param[in, out] g        - pointer to structure holding game status,
+ * @param[in] sequence      - sequence of the current board.
+ * @return Pointer to the view or NULL if memory couldn't be allocated.
+ */
+static board_view* build_view(gamma_t* g, uint64_t sequence) {
+    board_view* view = malloc(sizeof(board_view));
+    if (view == NULL)
+        return NULL; // failed to allocate memory
+    view->game = *g;
+    view->game.players_array = NULL;
+    view->game.journal = NULL;
+    view->game.recording = false;
+    view->game.planes = NULL;
+    view->game.listener = NULL;
+    view->game.published = NULL;
+    clear_stats(&view->game);
+    if (!view_board(&view->game, g)) {
+        free(view);
+        return NULL; // failed to allocate memory
+    }
+    // one reference is kept by published state and one by the observer
+    atomic_init(&view->refs, 2);
+    view->sequence = sequence;
+    return view;
+}
+
+gamma_t* take_view(gamma_t* g) {
+    published* p = g->published;
+    board_view* view = current_view(p, atomic_load_explicit(
+                                           &p->sequence,
+                                           memory_order_acquire));
+    if (view != NULL)
+        return &view->game;
+
+    pthread_mutex_lock(&p->board_lock);
+    uint64_t sequence = atomic_load_explicit(&p->sequence,
+                                             memory_order_relaxed);
+    // another observer could build the view while this one waited
+    view = current_view(p, sequence);
+    if (view == NULL) {
+        view = build_view(g, sequence);
+        if (view != NULL) {
+            pthread_mutex_lock(&p->view_lock);
+            board_view* old = p->view;
+            p->view = view;
+            pthread_mutex_unlock(&p->view_lock);
+            if (old != NULL)
+                release_view(&old->game);
+        }
+    }
+    pthread_mutex_unlock(&p->board_lock);
+    return view != NULL ? &view->game : NULL;
+}
+
+void release_view(gamma_t* view) {
+    board_view* v = (board_view*)view;
+    if (atomic_fetch_sub_explicit(&v->refs, 1, memory_order_acq_rel) == 1) {
+        free_board(view);
+        free(v);
+    }
+}
+
+bool gamma_concurrent(gamma_t *g, bool enabled) {
+    if (g == NULL)
+        return false; // incorrect parameter
+    if (!enabled)
+        free_published(g);
+    else if (g->published == NULL)
+        return init_published(g);
+    return true;
+}
@@ -0,0 +1,97 @@
+/** @file
+ * Interface of state of the game published for observer threads.
+ * One thread changes the game while many observers ask about it. Counters
+ * of players are published after every change under a sequence lock, so
+ * observers read them without waiting for the writer. Observers render
+ * the board from a view sharing tiles of owners with the game, built once
+ * for every state of the board and freed by the last observer using it.
+ * The writer holds the board lock while it changes the board; observers
+ * hold it only while sharing tiles of a new view.
+ */
+
+#ifndef PUBLISH_H
+#define PUBLISH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+
+/** @brief Starts publishing state of the game.
+ * Counters of every player are published. Complexity O(p) where p stands
+ * for number of players.
+ * @param[in, out] g    - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated.
+ */
+bool init_published(gamma_t* g);
+
+/** @brief Stops publishing state of the game.
+ * No observer may use the game anymore.
+ * @param[in, out] g    - pointer to structure holding game status.
+ */
+void free_published(gamma_t* g);
+
+/** @brief Locks the board before the writer changes tiles of the game.
+ * Does nothing if state of the game isn't published.
+ * @param[in, out] g    - pointer to structure holding game status.
+ */
+void lock_board(gamma_t* g);
+
+/** @brief Unlocks the board locked by lock_board.
+ * @param[in, out] g    - pointer to structure holding game status.
+ */
+void unlock_board(gamma_t* g);
+
+/** @brief Locks the board before a move and starts publishing counters.
+ * Does nothing if state of the game isn't published.
+ * @param[in, out] g    - pointer to structure holding game status.
+ */
+void publish_begin(gamma_t* g);
+
+/** @brief Publishes counters of the player changed by the move.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] player    - number of the player, 0 is skipped.
+ */
+void publish_player(gamma_t* g, uint32_t player);
+
+/** @brief Publishes counters of players who can be affected by a move.
+ * Those are owners of fields in 5x5 square around the field.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] x         - horizontal position on board,
+ * @param[in] y         - vertical position on board.
+ */
+void publish_area(gamma_t* g, uint32_t x, uint32_t y);
+
+/** @brief Ends publishing counters and unlocks the board.
+ * Number of free fields is published and every view becomes outdated.
+ * @param[in, out] g    - pointer to structure holding game status.
+ */
+void publish_end(gamma_t* g);
+
+/** @brief Reads published counters of the player.
+ * Retries while the writer publishes new ones, so both counters come from
+ * the same state of the game.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] player    - number of the player,
+ * @param[out] busy     - number of player's fields,
+ * @param[out] available - number of fields the player can take.
+ */
+void read_published(gamma_t* g, uint32_t player, uint64_t* busy,
+                    uint64_t* available);
+
+/** @brief Gives view of the current board.
+ * The view is built if the board changed since the last one.
+ * @param[in] g         - pointer to structure holding game status.
+ * @return Pointer to the view, to be released with release_view, or NULL
+ * if memory couldn't be allocated.
+ */
+gamma_t* take_view(gamma_t* g);
+
+/** @brief Releases the view, frees it if no observer uses it.
+ * @param[in, out] view - pointer to the view.
+ */
+void release_view(gamma_t* view);
+
+#endif /* PUBLISH_H */
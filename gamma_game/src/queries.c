@@ -0,0 +1,122 @@
+/** @file
+ * Implementation of answering batches of queries about the game.
+ * Queries don't change the game, so they are shared between threads taking
+ * chunks of the batch one after another. Golden move checks which couldn't
+ * allocate memory are repeated by the calling thread after others finish.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "borders.h"
+#include "golden.h"
+#include "gamma.h"
+
+/** @brief Number of queries taken by a thread at once. */
+#define QUERY_CHUNK 64
+
+/** @brief Maximum number of threads answering one batch. */
+#define MAX_QUERY_THREADS 256
+
+/** @brief Answer of golden move query which has to be repeated. */
+#define PENDING_ANSWER UINT64_MAX
+
+/** @brief Structure representing batch of queries shared between threads.
+ */
+typedef struct query_batch {
+    gamma_t* g; ///< game the queries are about, not changed by them.
+    gamma_query* queries; ///< queries of the batch.
+    size_t count; ///< number of queries.
+    atomic_size_t next; ///< first query not taken by any thread.
+    atomic_bool pending; ///< if some query has to be repeated.
+} query_batch;
+
+/** @brief Answers single query without changing the game.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] query     - answered query.
+ * @return Answer or PENDING_ANSWER if memory couldn't be allocated.
+ */
+static uint64_t answer(gamma_t* g, gamma_query* query) {
+    if (query->type == 'b')
+        return gamma_busy_fields(g, query->player);
+    if (query->type == 'f')
+        return gamma_free_fields(g, query->player);
+    if (query->type != 'q' || query->player < 1 || g->players < query->player)
+        return 0; // incorrect query
+    int result = golden_possible(g, query->player);
+    return result < 0 ? PENDING_ANSWER : (uint64_t)result;
+}
+
+/** @brief Answers chunks of queries until whole batch is taken.
+ * @param[in, out] data - pointer to shared batch of queries.
+ * @return NULL.
+ */
+static void* answer_chunks(void* data) {
+    query_batch* batch = data;
+    size_t first;
+    while ((first = atomic_fetch_add(&batch->next, QUERY_CHUNK)) <
+           batch->count) {
+        size_t last = first + QUERY_CHUNK;
+        if (last > batch->count)
+            last = batch->count;
+        for (size_t i = first; i < last; i++) {
+            batch->queries[i].answer = answer(batch->g, &batch->queries[i]);
+            if (batch->queries[i].answer == PENDING_ANSWER)
+                atomic_store(&batch->pending, true);
+        }
+    }
+    return NULL;
+}
+
+/** @brief Chooses number of threads answering the batch.
+ * @param[in] threads   - requested number of threads, 0 for every processor,
+ * @param[in] count     - number of queries.
+ * @return Number of threads, at least one.
+ */
+static size_t threads_number(unsigned threads, size_t count) {
+    size_t result = threads;
+    if (result == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        result = processors > 0 ? processors : 1;
+    }
+    // every thread should get at least one chunk
+    size_t chunks = (count + QUERY_CHUNK - 1) / QUERY_CHUNK;
+    if (result > chunks)
+        result = chunks;
+    if (result > MAX_QUERY_THREADS)
+        result = MAX_QUERY_THREADS;
+    return result > 0 ? result : 1;
+}
+
+bool gamma_queries(gamma_t *g, gamma_query *queries, size_t count,
+                   unsigned threads) {
+    if (g == NULL || (queries == NULL && count > 0))
+        return false; // incorrect parameter
+
+    query_batch batch = {.g = g, .queries = queries, .count = count};
+    atomic_init(&batch.next, 0);
+    atomic_init(&batch.pending, false);
+    pthread_t helpers[MAX_QUERY_THREADS];
+    size_t started = 0, wanted = threads_number(threads, count) - 1;
+    while (started < wanted &&
+           pthread_create(&helpers[started], NULL, answer_chunks, &batch) == 0)
+        started++; // calling thread answers queries too if creating fails
+    answer_chunks(&batch);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(helpers[i], NULL);
+
+    if (atomic_load(&batch.pending)) {
+        // checking golden moves changing the game is left for one thread
+        for (size_t i = 0; i < count; i++)
+            if (queries[i].answer == PENDING_ANSWER)
+                queries[i].answer = gamma_golden_possible(g,
+                                                          queries[i].player);
+    }
+    return true;
+}
@@ -0,0 +1,250 @@
+/** @file
+ * Implementation of converting board fields into text.
+ * With less then 10 players owners are converted into single characters
+ * by vector kernels, SSE2 on every x86-64 processor and AVX2 if available.
+ * With more players texts of owners are prepared once for the whole board
+ * and numbers not fitting there are formatted two digits at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "borders.h"
+#include "board.h"
+#include "render.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RENDER_VECTORS
+#include <immintrin.h>
+#endif
+
+/** @brief Number of fields of sparse board gathered at once. */
+#define GATHERED_FIELDS 1024
+
+/** @brief Maximum number of prepared texts of fields. */
+#define MAX_TEXTS (1 << 16)
+
+/** @brief Number of characters of single prepared text. */
+#define TEXT_SIZE 8
+
+/** @brief Decimal representations of numbers from 0 to 99. */
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+/** @brief Converts owners lower then 10 into characters without vectors.
+ * @param[in] owners    - owners of consecutive fields,
+ * @param[in] count     - number of fields,
+ * @param[out] text     - pointer to place for characters.
+ */
+static void owner_characters(const uint32_t* owners, uint64_t count,
+                             char* text) {
+    for (uint64_t i = 0; i < count; i++)
+        text[i] = owners[i] == 0 ? '.' : (char)('0' + owners[i]);
+}
+
+#ifdef RENDER_VECTORS
+
+/** @brief Converts owners lower then 10 into characters with SSE2.
+ * @param[in] owners    - owners of consecutive fields,
+ * @param[in] count     - number of fields,
+ * @param[out] text     - pointer to place for characters.
+ */
+static void owner_characters_sse2(const uint32_t* owners, uint64_t count,
+                                  char* text) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i digit = _mm_set1_epi8('0');
+    const __m128i free_field = _mm_set1_epi8('.');
+    uint64_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i* source = (const __m128i*)(owners + i);
+        __m128i low = _mm_packs_epi32(_mm_loadu_si128(source),
+                                      _mm_loadu_si128(source + 1));
+        __m128i high = _mm_packs_epi32(_mm_loadu_si128(source + 2),
+                                       _mm_loadu_si128(source + 3));
+        __m128i bytes = _mm_packus_epi16(low, high);
+        __m128i is_free = _mm_cmpeq_epi8(bytes, zero);
+        __m128i result = _mm_or_si128(
+            _mm_andnot_si128(is_free, _mm_add_epi8(bytes, digit)),
+            _mm_and_si128(is_free, free_field));
+        _mm_storeu_si128((__m128i*)(text + i), result);
+    }
+    owner_characters(owners + i, count - i, text + i);
+}
+
+/** @brief Converts owners lower then 10 into characters with AVX2.
+ * @param[in] owners    - owners of consecutive fields,
+ * @param[in] count     - number of fields,
+ * @param[out] text     - pointer to place for characters.
+ */
+__attribute__((target("avx2")))
+static void owner_characters_avx2(const uint32_t* owners, uint64_t count,
+                                  char* text) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i digit = _mm256_set1_epi8('0');
+    const __m256i free_field = _mm256_set1_epi8('.');
+    // packing works inside 128-bit lanes, this restores order of fields
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint64_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i* source = (const __m256i*)(owners + i);
+        __m256i low = _mm256_packs_epi32(_mm256_loadu_si256(source),
+                                         _mm256_loadu_si256(source + 1));
+        __m256i high = _mm256_packs_epi32(_mm256_loadu_si256(source + 2),
+                                          _mm256_loadu_si256(source + 3));
+        __m256i bytes = _mm256_permutevar8x32_epi32(
+            _mm256_packus_epi16(low, high), order);
+        __m256i is_free = _mm256_cmpeq_epi8(bytes, zero);
+        __m256i result = _mm256_blendv_epi8(_mm256_add_epi8(bytes, digit),
+                                            free_field, is_free);
+        _mm256_storeu_si256((__m256i*)(text + i), result);
+    }
+    owner_characters_sse2(owners + i, count - i, text + i);
+}
+
+#endif /* RENDER_VECTORS */
+
+/** @brief Converts owners lower then 10 into characters.
+ * Chooses the fastest variant supported by the processor.
+ * @param[in] owners    - owners of consecutive fields,
+ * @param[in] count     - number of fields,
+ * @param[out] text     - pointer to place for characters.
+ */
+static void convert_owners(const uint32_t* owners, uint64_t count,
+                           char* text) {
+#ifdef RENDER_VECTORS
+    // features are found at startup, so the check is cheap in any thread
+    if (__builtin_cpu_supports("avx2"))
+        owner_characters_avx2(owners, count, text);
+    else
+        owner_characters_sse2(owners, count, text);
+#else
+    owner_characters(owners, count, text);
+#endif
+}
+
+/** @brief Writes owner number padded with spaces to given width.
+ * Free field is written as '.'.
+ * @param[in] number    - number of the owner,
+ * @param[in] size      - number of characters to fill,
+ * @param[out] text     - pointer to place for characters.
+ */
+static void put_number(uint32_t number, uint32_t size, char* text) {
+    uint32_t position = size;
+    if (number == 0) {
+        text[--position] = '.';
+    }
+    else {
+        while (number >= 100) {
+            const char* pair = digit_pairs + 2 * (number % 100);
+            text[--position] = pair[1];
+            text[--position] = pair[0];
+            number /= 100;
+        }
+        if (number >= 10) {
+            text[--position] = digit_pairs[2 * number + 1];
+            text[--position] = digit_pairs[2 * number];
+        }
+        else {
+            text[--position] = (char)('0' + number);
+        }
+    }
+    memset(text, ' ', position);
+}
+
+/** @brief Converts owners into padded numbers separated with spaces.
+ * Prepared texts are copied whole, which may write after the field, so
+ * they are not used for the last fields.
+ * @param[in] owners    - owners of consecutive fields,
+ * @param[in] count     - number of fields,
+ * @param[in] size      - number of characters of a number,
+ * @param[in] texts     - pointer to prepared texts,
+ * @param[out] text     - pointer to place for characters.
+ */
+static void convert_numbers(const uint32_t* owners, uint64_t count,
+                            uint32_t size, field_texts* texts, char* text) {
+    uint64_t i = 0;
+    if (texts->texts != NULL && count > TEXT_SIZE) {
+        for (; i < count - TEXT_SIZE; i++) {
+            if (owners[i] < texts->count)
+                memcpy(text, texts->texts + owners[i] * TEXT_SIZE, TEXT_SIZE);
+            else
+                put_number(owners[i], size, text);
+            text[size] = ' ';
+            text += size + 1;
+        }
+    }
+    for (; i < count; i++) {
+        put_number(owners[i], size, text);
+        text[size] = ' ';
+        text += size + 1;
+    }
+}
+
+void prepare_field_texts(gamma_t* g, field_texts* texts) {
+    texts->count = 0;
+    texts->texts = NULL;
+    if (g->players < 10 || g->field_print_size + 1 > TEXT_SIZE)
+        return; // texts are not needed or don't fit
+    uint64_t count = (uint64_t)g->players + 1;
+    if (count > MAX_TEXTS)
+        count = MAX_TEXTS;
+    texts->texts = malloc(count * TEXT_SIZE);
+    if (texts->texts == NULL)
+        return; // fields will be formatted one by one
+    texts->count = count;
+    for (uint64_t i = 0; i < count; i++) {
+        char* text = texts->texts + i * TEXT_SIZE;
+        put_number(i, g->field_print_size, text);
+        memset(text + g->field_print_size, ' ',
+               TEXT_SIZE - g->field_print_size);
+    }
+}
+
+void free_field_texts(field_texts* texts) {
+    free(texts->texts);
+    texts->texts = NULL;
+    texts->count = 0;
+}
+
+uint64_t field_text_size(gamma_t* g) {
+    return g->players < 10 ? 1 : (uint64_t)g->field_print_size + 1;
+}
+
+uint64_t render_fields(gamma_t* g, field_texts* texts, uint64_t first, uint64_t count,
+                       bool line_end, char* text) {
+    uint64_t field_size = field_text_size(g);
+    uint64_t done = 0;
+    while (done < count) {
+        const uint32_t* owners;
+        uint32_t gathered[GATHERED_FIELDS];
+        uint64_t part = count - done;
+        if (g->sparse) { // owners of sparse board are not consecutive
+            if (part > GATHERED_FIELDS)
+                part = GATHERED_FIELDS;
+            for (uint64_t i = 0; i < part; i++)
+                gathered[i] = get_owner(g, first + done + i);
+            owners = gathered;
+        }
+        else { // owners are consecutive within a tile
+            owners = owners_run(g, first + done, &part);
+        }
+        if (g->players < 10)
+            convert_owners(owners, part, text + done * field_size);
+        else
+            convert_numbers(owners, part, g->field_print_size, texts,
+                            text + done * field_size);
+        done += part;
+    }
+    uint64_t length = count * field_size;
+    if (line_end) {
+        if (g->players < 10)
+            length++;
+        text[length - 1] = '\n'; // replaces separator after the last field
+    }
+    return length;
+}
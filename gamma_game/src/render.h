@@ -0,0 +1,57 @@
+/** @file
+ * Interface of converting board fields into text.
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+
+/** @brief Structure representing prepared texts of fields.
+ * With at least 10 players texts of owners up to count - 1 are prepared
+ * once for rendering the whole board, every text takes 8 characters.
+ */
+typedef struct field_texts {
+    uint64_t count; ///< number of prepared texts.
+    char* texts; ///< prepared texts or NULL.
+} field_texts;
+
+/** @brief Prepares texts of fields for rendering the board.
+ * If memory couldn't be allocated no texts are prepared and fields are
+ * formatted one by one.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[out] texts    - pointer to prepared texts.
+ */
+void prepare_field_texts(gamma_t* g, field_texts* texts);
+
+/** @brief Frees prepared texts of fields.
+ * @param[in, out] texts    - pointer to prepared texts.
+ */
+void free_field_texts(field_texts* texts);
+
+/** @brief Gives number of characters of single rendered field.
+ * With less then 10 players fields are not separated, otherwise every
+ * field is padded to g->field_print_size and followed by a separator.
+ * @param[in] g         - pointer to structure holding game status.
+ * @return Number of characters including separator.
+ */
+uint64_t field_text_size(gamma_t* g);
+
+/** @brief Renders consecutive fields of one board line.
+ * Writes count * field_text_size(g) characters, or one more if the fields
+ * end the line, because the line is ended with '\n'.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] texts     - pointer to texts prepared for the game,
+ * @param[in] first     - number of the first field on the board,
+ * @param[in] count     - number of rendered fields,
+ * @param[in] line_end  - if the last rendered field ends the line,
+ * @param[out] text     - pointer to place for characters.
+ * @return Number of written characters.
+ */
+uint64_t render_fields(gamma_t* g, field_texts* texts, uint64_t first, uint64_t count,
+                       bool line_end, char* text);
+
+#endif /* RENDER_H */
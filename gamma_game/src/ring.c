@@ -0,0 +1,79 @@
+/** @file
+ * Implementation of lock-free rings passing records between two threads.
+ * Positions only grow, slot of a record is its position modulo capacity.
+ * A record is copied before the position is published with release order,
+ * and the other side reads the position with acquire order.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <time.h>
+
+#include "ring.h"
+
+/** @brief Number of rounds a waiting thread only yields the processor. */
+#define YIELD_ROUNDS 256
+
+/** @brief Time slept in every later round, in nanoseconds. */
+#define SLEEP_NANOSECONDS 50000
+
+bool open_ring(spsc_ring* ring, size_t capacity, size_t size) {
+    ring->slots = malloc(capacity * size);
+    if (ring->slots == NULL)
+        return false; // failed to allocate memory
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->seen_head = ring->seen_tail = 0;
+    ring->capacity = capacity;
+    ring->size = size;
+    return true;
+}
+
+void ring_wait(unsigned* rounds) {
+    if (*rounds < YIELD_ROUNDS) {
+        (*rounds)++;
+        sched_yield();
+        return;
+    }
+    struct timespec pause = {0, SLEEP_NANOSECONDS};
+    nanosleep(&pause, NULL);
+}
+
+void ring_put(spsc_ring* ring, const void* record) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned rounds = 0;
+    while (tail - ring->seen_head == ring->capacity) {
+        ring->seen_head = atomic_load_explicit(&ring->head,
+                                               memory_order_acquire);
+        if (tail - ring->seen_head == ring->capacity)
+            ring_wait(&rounds); // ring is full
+    }
+    memcpy(ring->slots + (tail & (ring->capacity - 1)) * ring->size, record,
+           ring->size);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+void ring_take(spsc_ring* ring, void* record) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned rounds = 0;
+    while (head == ring->seen_tail) {
+        ring->seen_tail = atomic_load_explicit(&ring->tail,
+                                               memory_order_acquire);
+        if (head == ring->seen_tail)
+            ring_wait(&rounds); // ring is empty
+    }
+    memcpy(record, ring->slots + (head & (ring->capacity - 1)) * ring->size,
+           ring->size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void close_ring(spsc_ring* ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
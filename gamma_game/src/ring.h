@@ -0,0 +1,64 @@
+/** @file
+ * Interface of lock-free rings passing records between two threads.
+ * One thread puts records into the ring and one takes them out. Each side
+ * remembers the last seen position of the other one, so the shared
+ * positions are read only when the ring seems full or empty.
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/** @brief Size of cache line keeping positions of both sides apart. */
+#define RING_LINE 64
+
+/** @brief Structure representing ring of records of equal size.
+ */
+typedef struct spsc_ring {
+    _Alignas(RING_LINE) atomic_size_t head; ///< number of taken records.
+    size_t seen_tail; ///< tail last seen by the taking thread.
+    _Alignas(RING_LINE) atomic_size_t tail; ///< number of put records.
+    size_t seen_head; ///< head last seen by the putting thread.
+    _Alignas(RING_LINE) size_t capacity; ///< number of slots, power of two.
+    size_t size; ///< size of single record.
+    char* slots; ///< records one after another.
+} spsc_ring;
+
+/** @brief Prepares empty ring.
+ * @param[out] ring     - pointer to the ring,
+ * @param[in] capacity  - number of slots, power of two,
+ * @param[in] size      - size of single record.
+ * @return False if memory couldn't be allocated.
+ */
+bool open_ring(spsc_ring* ring, size_t capacity, size_t size);
+
+/** @brief Puts the record into the ring, waits while the ring is full.
+ * @param[in, out] ring - pointer to the ring,
+ * @param[in] record    - pointer to the record.
+ */
+void ring_put(spsc_ring* ring, const void* record);
+
+/** @brief Takes the oldest record, waits while the ring is empty.
+ * @param[in, out] ring - pointer to the ring,
+ * @param[out] record   - pointer to place for the record.
+ */
+void ring_take(spsc_ring* ring, void* record);
+
+/** @brief Waits a moment for another thread.
+ * The thread gives up the processor first and sleeps after many rounds,
+ * so a long wait doesn't keep a processor busy.
+ * @param[in, out] rounds - number of rounds waited so far.
+ */
+void ring_wait(unsigned* rounds);
+
+/** @brief Frees the ring.
+ * @param[in, out] ring - pointer to the ring.
+ */
+void close_ring(spsc_ring* ring);
+
+#endif /* RING_H */
@@ -0,0 +1,410 @@
+/** @file
+ * Implementation of frame renderer of interactive mode.
+ * Places of the screen are numbered by row and column of the terminal,
+ * a place is one character wide with less than 10 players, otherwise
+ * it holds padded number of a player and a separating space.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "borders.h"
+#include "board.h"
+#include "field_set.h"
+#include "gamma.h"
+#include "output_writer.h"
+#include "screen.h"
+
+/** @brief Owner of a field which isn't shown yet. */
+#define NOT_SHOWN UINT32_MAX
+
+/** @brief Terminal rows assumed if the size can't be read. */
+#define DEFAULT_ROWS 24
+
+/** @brief Terminal columns assumed if the size can't be read. */
+#define DEFAULT_COLUMNS 80
+
+/** @brief Colours of a field. */
+enum field_style {
+    STYLE_PLAIN, ///< white letters on black background.
+    STYLE_ACTIVE, ///< yellow letters, field of the player to move.
+    STYLE_CURSOR, ///< black letters on white background.
+    STYLES ///< number of styles.
+};
+
+/** @brief Escape codes setting every style, each resets colours first. */
+static const char* const style_codes[STYLES] = {
+    "\x1b[0m", "\x1b[0;33m", "\x1b[0;47;30m"
+};
+
+/** @brief Spaces padding numbers of players. */
+static const char padding[] = "          ";
+
+/** @brief Adds a text ended with zero to the frame.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] text      - the text.
+ */
+static void put_text(screen* s, const char* text) {
+    write_text(&s->out, text, strlen(text));
+}
+
+/** @brief Clears the terminal row and moves terminal cursor to its beginning.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] row       - terminal row, from 1.
+ */
+static void clear_row(screen* s, uint32_t row) {
+    put_text(s, "\x1b[");
+    write_number(&s->out, row);
+    put_text(s, ";1f\x1b[0m\x1b[2K"); // clear the line
+    s->row = 0;
+    s->style = -1;
+}
+
+/** @brief Reads size of the terminal.
+ * @param[out] rows     - pointer to number of rows,
+ * @param[out] columns  - pointer to number of columns.
+ */
+static void terminal_size(uint32_t* rows, uint32_t* columns) {
+    struct winsize window;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) == -1 ||
+        window.ws_row == 0 || window.ws_col == 0) {
+        *rows = DEFAULT_ROWS; // not a terminal
+        *columns = DEFAULT_COLUMNS;
+        return;
+    }
+    *rows = window.ws_row;
+    *columns = window.ws_col;
+}
+
+/** @brief Gives width of a place of the screen.
+ * @param[in] g         - pointer to structure holding game status.
+ * @return Number of characters.
+ */
+static uint32_t place_width(gamma_t* g) {
+    // with at least 10 players fields are separated with spaces
+    return g->field_print_size == 1 ? 1 : g->field_print_size + 1;
+}
+
+bool screen_fits(gamma_t* g, uint32_t min_width) {
+    uint32_t rows, columns;
+    terminal_size(&rows, &columns);
+    return rows > SCREEN_TEXT_LINES && columns >= min_width &&
+           columns >= place_width(g);
+}
+
+/** @brief Fits the screen into the terminal.
+ * Sets number of places and sizes of blocks of overview.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] rows      - number of terminal rows,
+ * @param[in] columns   - number of terminal columns.
+ */
+static void layout(screen* s, uint32_t rows, uint32_t columns) {
+    gamma_t* g = s->g;
+    rows = rows > SCREEN_TEXT_LINES ? rows - SCREEN_TEXT_LINES : 1;
+    columns /= place_width(g);
+    if (columns == 0)
+        columns = 1;
+    s->rows = g->height < rows ? g->height : rows;
+    s->columns = g->width < columns ? g->width : columns;
+    s->block_width = (g->width + (uint64_t)s->columns - 1) / s->columns;
+    s->block_height = (g->height + (uint64_t)s->rows - 1) / s->rows;
+}
+
+/** @brief Gives number of places showing fields in a terminal row.
+ * @param[in] s         - pointer to the screen.
+ * @return Number of those places.
+ */
+static uint32_t shown_columns(screen* s) {
+    if (!s->overview)
+        return s->columns;
+    return (s->g->width + s->block_width - 1) / s->block_width;
+}
+
+/** @brief Gives number of terminal rows showing fields.
+ * @param[in] s         - pointer to the screen.
+ * @return Number of those rows.
+ */
+static uint32_t shown_rows(screen* s) {
+    if (!s->overview)
+        return s->rows;
+    return (s->g->height + s->block_height - 1) / s->block_height;
+}
+
+/** @brief Finds place of the screen showing the field.
+ * In overview that is the place of the block holding the field.
+ * @param[in] s         - pointer to the screen,
+ * @param[in] x         - horizontal position of the field,
+ * @param[in] y         - vertical position of the field,
+ * @param[out] column   - pointer to column of the place,
+ * @param[out] row      - pointer to row of the place.
+ * @return False if the field isn't shown.
+ */
+static bool field_place(screen* s, uint32_t x, uint32_t y, uint32_t* column,
+                        uint32_t* row) {
+    if (s->overview) {
+        *column = x / s->block_width;
+        *row = y / s->block_height;
+        return true;
+    }
+    if (x < s->view_x || x - s->view_x >= s->columns ||
+        y < s->view_y || y - s->view_y >= s->rows)
+        return false; // field out of the view
+    *column = x - s->view_x;
+    *row = y - s->view_y;
+    return true;
+}
+
+/** @brief Draws the place if it should look different than it does.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] column    - column of the place,
+ * @param[in] row       - row of the place.
+ */
+static void draw_place(screen* s, uint32_t column, uint32_t row) {
+    gamma_t* g = s->g;
+    uint64_t x = s->view_x + (uint64_t)column;
+    uint64_t y = s->view_y + (uint64_t)row;
+    if (s->overview) {
+        // block is shown as its middle field
+        x = column * s->block_width + s->block_width / 2;
+        y = row * s->block_height + s->block_height / 2;
+        x = x < g->width ? x : g->width - 1;
+        y = y < g->height ? y : g->height - 1;
+    }
+    uint32_t owner = get_owner(g, y * g->width + x);
+    uint32_t cursor_column, cursor_row;
+    uint8_t style = STYLE_PLAIN;
+    if (s->cursor_shown &&
+        field_place(s, s->cursor_x, s->cursor_y, &cursor_column,
+                    &cursor_row) &&
+        cursor_column == column && cursor_row == row)
+        style = STYLE_CURSOR;
+    else if (s->active != 0 && owner == s->active)
+        style = STYLE_ACTIVE;
+    screen_cell* cell = &s->cells[row * (uint64_t)s->columns + column];
+    if (cell->owner == owner && cell->style == style)
+        return; // terminal shows it already
+    cell->owner = owner;
+    cell->style = style;
+
+    uint32_t size = g->field_print_size;
+    uint32_t terminal_column = column * place_width(g) + 1;
+    if (s->row != row + 1 || s->column != terminal_column) {
+        put_text(s, "\x1b[");
+        write_number(&s->out, row + 1);
+        put_text(s, ";");
+        write_number(&s->out, terminal_column);
+        put_text(s, "f");
+        s->row = row + 1;
+    }
+    if (s->style != style) {
+        put_text(s, style_codes[style]);
+        s->style = style;
+    }
+    write_text(&s->out, padding, size - count_digits(owner));
+    if (owner == 0)
+        put_text(s, ".");
+    else
+        write_number(&s->out, owner);
+    s->column = terminal_column + size;
+}
+
+/** @brief Draws every shown place which looks different than it should.
+ * @param[in, out] s    - pointer to the screen.
+ */
+static void draw_places(screen* s) {
+    uint32_t rows = shown_rows(s), columns = shown_columns(s);
+    for (uint32_t row = 0; row < rows; row++)
+        for (uint32_t column = 0; column < columns; column++)
+            draw_place(s, column, row);
+}
+
+/** @brief Clears rows of the board and forgets what they showed.
+ * @param[in, out] s    - pointer to the screen.
+ */
+static void clear_places(screen* s) {
+    for (uint32_t row = 0; row < s->rows; row++)
+        clear_row(s, row + 1);
+    for (uint64_t i = 0; i < s->rows * (uint64_t)s->columns; i++)
+        s->cells[i] = (screen_cell){NOT_SHOWN, STYLE_PLAIN};
+}
+
+/** @brief Moves the view so that the cursor is shown.
+ * The cursor is put in the middle of the view if it was out of it.
+ * @param[in, out] s    - pointer to the screen.
+ * @return True if the view moved.
+ */
+static bool follow_cursor(screen* s) {
+    uint32_t old_x = s->view_x, old_y = s->view_y;
+    if (s->cursor_x < s->view_x || s->cursor_x - s->view_x >= s->columns)
+        s->view_x = s->cursor_x > s->columns / 2 ?
+                    s->cursor_x - s->columns / 2 : 0;
+    if (s->cursor_y < s->view_y || s->cursor_y - s->view_y >= s->rows)
+        s->view_y = s->cursor_y > s->rows / 2 ? s->cursor_y - s->rows / 2 : 0;
+    // view doesn't go past the board
+    if (s->view_x > s->g->width - s->columns)
+        s->view_x = s->g->width - s->columns;
+    if (s->view_y > s->g->height - s->rows)
+        s->view_y = s->g->height - s->rows;
+    return s->view_x != old_x || s->view_y != old_y;
+}
+
+/** @brief Allocates places for the current size of the terminal.
+ * @param[in, out] s    - pointer to the screen.
+ * @return False if memory couldn't be allocated, the screen is unchanged.
+ */
+static bool alloc_places(screen* s) {
+    screen old = *s;
+    uint32_t rows, columns;
+    terminal_size(&rows, &columns);
+    layout(s, rows, columns);
+    screen_cell* cells = malloc(s->rows * (uint64_t)s->columns *
+                                sizeof(screen_cell));
+    if (cells == NULL) {
+        s->rows = old.rows;
+        s->columns = old.columns;
+        s->block_width = old.block_width;
+        s->block_height = old.block_height;
+        return false; // failed to allocate memory
+    }
+    free(s->cells);
+    s->cells = cells;
+    return true;
+}
+
+/** @brief Collects fields changing owner, listener of the shown game.
+ * @param[in, out] data - pointer to the screen,
+ * @param[in] event     - pointer to the event.
+ */
+static void note_change(void* data, const gamma_event* event) {
+    screen* s = data;
+    // set is marked as incomplete if the field can't be added
+    if (event->kind == GAMMA_EVENT_OWNER)
+        field_set_add(&s->changed, event->field);
+}
+
+bool open_screen(screen* s, gamma_t* g) {
+    s->g = g;
+    s->cells = NULL;
+    s->rows = s->columns = 1;
+    s->block_width = s->block_height = 1;
+    if (!alloc_places(s))
+        return false; // failed to allocate memory
+    s->overview = false;
+    s->view_x = s->view_y = 0;
+    s->changed = (field_set){NULL, 0, 0, false};
+    gamma_listen(g, note_change, s);
+    open_writer(&s->out, STDOUT_FILENO);
+    s->cursor_x = s->cursor_y = 0;
+    s->cursor_shown = false;
+    s->active = 0;
+
+    put_text(s, "\x1b[2J"); // clear the entire screen
+    put_text(s, "\x1b[?25l"); // hide the cursor
+    clear_places(s);
+    draw_places(s);
+    return true;
+}
+
+bool screen_resize(screen* s) {
+    if (!alloc_places(s))
+        return false; // failed to allocate memory
+    put_text(s, "\x1b[2J"); // clear the entire screen
+    follow_cursor(s);
+    clear_places(s);
+    draw_places(s);
+    return true;
+}
+
+void screen_overview(screen* s) {
+    s->overview = !s->overview;
+    follow_cursor(s);
+    clear_places(s);
+    draw_places(s);
+}
+
+uint64_t screen_step(screen* s, bool vertical) {
+    if (!s->overview)
+        return 1;
+    return vertical ? s->block_height : s->block_width;
+}
+
+void screen_cursor(screen* s, uint32_t x, uint32_t y, bool shown) {
+    uint32_t old_column, old_row;
+    bool old_shown = s->cursor_shown &&
+                     field_place(s, s->cursor_x, s->cursor_y, &old_column,
+                                 &old_row);
+    s->cursor_x = x;
+    s->cursor_y = y;
+    s->cursor_shown = shown;
+    if (!s->overview && follow_cursor(s)) {
+        draw_places(s); // view scrolled
+        return;
+    }
+    uint32_t column, row;
+    if (old_shown)
+        draw_place(s, old_column, old_row);
+    if (shown && field_place(s, x, y, &column, &row))
+        draw_place(s, column, row);
+}
+
+void screen_active(screen* s, uint32_t player) {
+    uint32_t old = s->active;
+    if (old == player)
+        return; // nothing changes
+    s->active = player;
+    uint32_t rows = shown_rows(s), columns = shown_columns(s);
+    for (uint32_t row = 0; row < rows; row++) {
+        for (uint32_t column = 0; column < columns; column++) {
+            uint32_t owner = s->cells[row * (uint64_t)s->columns +
+                                      column].owner;
+            if (owner != 0 && (owner == old || owner == player))
+                draw_place(s, column, row);
+        }
+    }
+}
+
+output_writer* screen_line(screen* s, uint32_t line) {
+    // text of the line moves terminal cursor and changes colours
+    clear_row(s, s->rows + 1 + line);
+    return &s->out;
+}
+
+/** @brief Draws fields changed by the game since the last frame.
+ * @param[in, out] s    - pointer to the screen.
+ */
+static void draw_changes(screen* s) {
+    gamma_t* g = s->g;
+    if (s->changed.incomplete) {
+        draw_places(s); // changes couldn't be remembered
+    }
+    else {
+        for (uint64_t i = 0; i < s->changed.capacity; i++) {
+            uint64_t field = s->changed.slots[i];
+            uint32_t column, row;
+            if (field != FIELD_SET_EMPTY &&
+                field_place(s, field % g->width, field / g->width, &column,
+                            &row))
+                draw_place(s, column, row);
+        }
+    }
+    field_set_clear(&s->changed);
+}
+
+bool screen_flush(screen* s) {
+    draw_changes(s);
+    return flush_writer(&s->out);
+}
+
+void close_screen(screen* s) {
+    put_text(s, "\x1b[0m"); // colour reset
+    put_text(s, "\x1b[?25h"); // show the cursor
+    close_writer(&s->out);
+    gamma_listen(s->g, NULL, NULL);
+    field_set_clear(&s->changed);
+    free(s->cells);
+}
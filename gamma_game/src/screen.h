@@ -0,0 +1,132 @@
+/** @file
+ * Interface of frame renderer of interactive mode.
+ * The terminal shows a view of the board, a window of fields scrolled
+ * so that the cursor stays inside, or an overview, where every character
+ * stands for a block of fields and shows owner of its middle field.
+ * The screen remembers what the terminal shows in every place. Changes
+ * of the game are collected into a frame, which writes only places looking
+ * different than before, moving terminal cursor and changing colours only
+ * when needed, and is sent with a single write. Cost of a frame depends
+ * on the size of the terminal, not of the board.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+#include "field_set.h"
+#include "output_writer.h"
+
+/** @brief Number of terminal lines kept below the board for text. */
+#define SCREEN_TEXT_LINES 3
+
+/** @brief Place of the terminal showing a field.
+ */
+typedef struct screen_cell {
+    uint32_t owner; ///< shown owner or UINT32_MAX if nothing is shown.
+    uint8_t style; ///< colours of the field, see screen.c.
+} screen_cell;
+
+/** @brief Structure representing terminal showing the game.
+ */
+typedef struct screen {
+    gamma_t* g; ///< shown game.
+    screen_cell* cells; ///< what the terminal shows in every place.
+    uint32_t columns; ///< number of places for fields in a terminal row.
+    uint32_t rows; ///< number of terminal rows for fields.
+    bool overview; ///< if places stand for blocks of fields.
+    uint64_t block_width; ///< width of block of fields in overview.
+    uint64_t block_height; ///< height of block of fields in overview.
+    uint32_t view_x; ///< horizontal position of the first shown field.
+    uint32_t view_y; ///< vertical position of the first shown field.
+    field_set changed; ///< fields changed by the game since last frame.
+    output_writer out; ///< characters of the frame.
+    uint32_t cursor_x; ///< horizontal position of the cursor.
+    uint32_t cursor_y; ///< vertical position of the cursor.
+    bool cursor_shown; ///< if the cursor is shown.
+    uint32_t active; ///< player whose fields are highlighted or 0.
+    uint32_t row; ///< terminal row where output goes or 0 if not known.
+    uint32_t column; ///< terminal column where output goes.
+    int style; ///< colours of the terminal or -1 if not known.
+} screen;
+
+/** @brief Checks if the terminal can show the game.
+ * It needs place for at least one field and for text below the board.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] min_width - number of characters of the longest text line.
+ * @return True if the terminal is large enough.
+ */
+bool screen_fits(gamma_t* g, uint32_t min_width);
+
+/** @brief Clears the terminal and prepares the first frame with the board.
+ * The game reports changed fields to the screen till it's closed.
+ * @param[out] s        - pointer to the screen,
+ * @param[in, out] g    - pointer to structure holding game status.
+ * @return False if memory couldn't be allocated.
+ */
+bool open_screen(screen* s, gamma_t* g);
+
+/** @brief Adapts the screen to new size of the terminal.
+ * The terminal is cleared and the board drawn again, text below the board
+ * has to be written again.
+ * @param[in, out] s    - pointer to the screen.
+ * @return False if memory couldn't be allocated, the screen keeps
+ * the old size then.
+ */
+bool screen_resize(screen* s);
+
+/** @brief Switches between the view of the board and the overview.
+ * The view is moved to the cursor. Text below the board stays.
+ * @param[in, out] s    - pointer to the screen.
+ */
+void screen_overview(screen* s);
+
+/** @brief Gives step of cursor moved by one place of the screen.
+ * @param[in] s         - pointer to the screen,
+ * @param[in] vertical  - if the step is vertical.
+ * @return Number of fields, 1 unless overview is shown.
+ */
+uint64_t screen_step(screen* s, bool vertical);
+
+/** @brief Moves the cursor, scrolling the view so that it's shown.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] x         - horizontal position of the cursor,
+ * @param[in] y         - vertical position of the cursor,
+ * @param[in] shown     - if the cursor is shown.
+ */
+void screen_cursor(screen* s, uint32_t x, uint32_t y, bool shown);
+
+/** @brief Highlights fields of the player instead of previous one.
+ * Complexity O(n) where n stands for number of places of the terminal.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] player    - number of the player or 0 to highlight nobody.
+ */
+void screen_active(screen* s, uint32_t player);
+
+/** @brief Gives output for writing a line of text below the board.
+ * Terminal cursor is put at the beginning of the cleared line.
+ * @param[in, out] s    - pointer to the screen,
+ * @param[in] line      - number of the line below the board, from 0.
+ * @return Pointer to output of the frame.
+ */
+output_writer* screen_line(screen* s, uint32_t line);
+
+/** @brief Draws fields changed by the game and sends the frame.
+ * @param[in, out] s    - pointer to the screen.
+ * @return False if the frame couldn't be written.
+ */
+bool screen_flush(screen* s);
+
+/** @brief Sends the rest of the frame and frees the screen.
+ * Fields changed since the last frame aren't drawn, so text below the board
+ * stays the last output.
+ * @param[in, out] s    - pointer to the screen.
+ */
+void close_screen(screen* s);
+
+#endif /* SCREEN_H */
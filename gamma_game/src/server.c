@@ -0,0 +1,760 @@
+/** @file
+ * Implementation of the server hosting many batch mode games.
+ * Main thread accepts connections and reads them in epoll loop. Complete
+ * lines are passed to worker threads. Every session belongs to one worker,
+ * which runs all its commands, so games are never used by two threads.
+ * Sockets are non-blocking: workers queue answers of connections and main
+ * thread sends them when sockets are ready for writing.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "gamma.h"
+#include "batch_mode.h"
+#include "output_writer.h"
+#include "server.h"
+
+/** @brief Size of buffer for reading from a connection. */
+#define READ_SIZE (1 << 16)
+
+/** @brief Maximum length of unfinished line kept for a connection. */
+#define MAX_LINE (1 << 20)
+
+/** @brief Maximum number of characters queued for a connection.
+ * Connection isn't read while its lines waiting for the worker or its
+ * answers waiting for sending have more characters.
+ */
+#define MAX_QUEUED (1 << 20)
+
+/** @brief Number of buckets of sessions hash table. */
+#define SESSION_BUCKETS 4096
+
+/** @brief Maximum number of events taken from epoll at once. */
+#define MAX_EVENTS 64
+
+/** @brief Maximum time of searching for a suggested move, in milliseconds. */
+#define MAX_SUGGEST_TIME 1000
+
+/** @brief Structure representing named game.
+ */
+typedef struct session {
+    char* name; ///< name given by clients.
+    gamma_t* g; ///< game of the session or NULL before 'B' or 'L'.
+    int worker; ///< number of worker running commands of the session.
+    struct session* next; ///< next session in the same bucket.
+} session;
+
+/** @brief Structure representing lines passed to a worker.
+ * Lines of a job are consecutive complete lines of one connection.
+ * Job without lines closes the connection.
+ */
+typedef struct job {
+    struct connection* client; ///< connection that sent the lines.
+    char* lines; ///< consecutive lines ended with '\n'.
+    size_t size; ///< number of characters of lines.
+    int first_line; ///< number of the first line.
+    struct job* next; ///< next job in the queue.
+} job;
+
+/** @brief Structure representing client connection.
+ * Input fields are used only by main thread, output only by the worker
+ * of the session once the connection is attached. Fields after the lock
+ * are shared by both threads.
+ */
+typedef struct connection {
+    int fd; ///< non-blocking socket of the connection.
+    int epoll_fd; ///< epoll instance watching the socket.
+    session* attached; ///< session of the connection or NULL.
+    char* line; ///< unfinished line.
+    size_t line_size; ///< number of characters of unfinished line.
+    int line_number; ///< number of the last line given to the worker.
+    batch_output output; ///< answers and errors added to the queue.
+    struct connection* previous; ///< previous connection of the server.
+    struct connection* next; ///< next connection of the server.
+    job closing; ///< job closing the connection.
+    pthread_mutex_t lock; ///< lock of fields below.
+    bool reading; ///< if the end of input wasn't reached yet.
+    size_t input_size; ///< number of characters of lines not run yet.
+    char* queue; ///< answers waiting for sending.
+    size_t queue_begin; ///< number of already sent characters of queue.
+    size_t queue_size; ///< number of characters in queue.
+    size_t queue_capacity; ///< size of queue.
+    bool finished; ///< if no more answers will be added.
+    bool broken; ///< if answers can't be sent.
+    bool watched; ///< if the socket is watched by epoll.
+} connection;
+
+/** @brief Structure representing worker thread and its queue of jobs.
+ */
+typedef struct worker {
+    pthread_t thread; ///< the thread.
+    pthread_mutex_t lock; ///< lock of the queue.
+    pthread_cond_t ready; ///< signalled when a job is added.
+    job* first; ///< first job in the queue.
+    job* last; ///< last job in the queue.
+    bool stopped; ///< if worker should end after emptying the queue.
+} worker;
+
+/** @brief Structure representing state of the server.
+ */
+typedef struct server {
+    int listener; ///< listening socket.
+    int epoll_fd; ///< epoll instance.
+    int signal_fd; ///< descriptor receiving SIGINT and SIGTERM.
+    worker* workers; ///< worker threads.
+    int workers_number; ///< number of workers.
+    int sessions_number; ///< number of created sessions.
+    connection* clients; ///< connections not closed yet.
+    session* buckets[SESSION_BUCKETS]; ///< hash table of sessions.
+} server;
+
+/** @brief Adds job to the queue of a worker.
+ * @param[in, out] w    - pointer to the worker,
+ * @param[in] task      - pointer to added job.
+ */
+static void push_job(worker* w, job* task) {
+    task->next = NULL;
+    pthread_mutex_lock(&w->lock);
+    if (w->last == NULL)
+        w->first = task;
+    else
+        w->last->next = task;
+    w->last = task;
+    pthread_cond_signal(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/** @brief Takes all jobs from the queue of a worker.
+ * Waits until there is a job or the worker is stopped.
+ * @param[in, out] w    - pointer to the worker.
+ * @return List of jobs or NULL if worker should end.
+ */
+static job* take_jobs(worker* w) {
+    pthread_mutex_lock(&w->lock);
+    while (w->first == NULL && !w->stopped)
+        pthread_cond_wait(&w->ready, &w->lock);
+    job* jobs = w->first;
+    w->first = NULL;
+    w->last = NULL;
+    pthread_mutex_unlock(&w->lock);
+    return jobs;
+}
+
+/** @brief Closes the connection and frees it.
+ * @param[in, out] client   - pointer to the connection.
+ */
+static void close_connection(connection* client) {
+    close_batch_output(&client->output);
+    close(client->fd);
+    free(client->line);
+    free(client->queue);
+    pthread_mutex_destroy(&client->lock);
+    free(client);
+}
+
+/** @brief Adds answers to the queue of the connection.
+ * Used as the sink of connection output.
+ * @param[in, out] data     - pointer to the connection,
+ * @param[in] text          - pointer to the characters,
+ * @param[in] length        - number of characters.
+ */
+static void queue_answers(void* data, const char* text, size_t length) {
+    connection* client = data;
+    pthread_mutex_lock(&client->lock);
+    if (client->queue_begin > 0) { // sent characters are dropped
+        client->queue_size -= client->queue_begin;
+        memmove(client->queue, client->queue + client->queue_begin,
+                client->queue_size);
+        client->queue_begin = 0;
+    }
+    size_t needed = client->queue_size + length;
+    if (!client->broken && needed > client->queue_capacity) {
+        size_t capacity = 2 * client->queue_capacity;
+        if (capacity < needed)
+            capacity = needed;
+        char* queue = realloc(client->queue, capacity);
+        if (queue == NULL) {
+            client->broken = true; // answers would be lost
+        }
+        else {
+            client->queue = queue;
+            client->queue_capacity = capacity;
+        }
+    }
+    if (!client->broken) {
+        memcpy(client->queue + client->queue_size, text, length);
+        client->queue_size = needed;
+    }
+    pthread_mutex_unlock(&client->lock);
+}
+
+/** @brief Sends queued answers until the socket would block.
+ * Lock of the connection has to be held.
+ * @param[in, out] client   - pointer to the connection.
+ */
+static void send_answers(connection* client) {
+    while (!client->broken && client->queue_begin < client->queue_size) {
+        ssize_t result = send(client->fd, client->queue + client->queue_begin,
+                              client->queue_size - client->queue_begin,
+                              MSG_NOSIGNAL);
+        if (result > 0)
+            client->queue_begin += result;
+        else if (result < 0 && errno == EINTR)
+            continue;
+        else if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return; // rest is sent when the socket is ready
+        else
+            client->broken = true;
+    }
+    client->queue_begin = client->queue_size = 0;
+}
+
+/** @brief Checks if queues of the connection are full.
+ * Lock of the connection has to be held.
+ * @param[in] client    - pointer to the connection.
+ * @return True if the connection shouldn't be read.
+ */
+static bool queues_full(connection* client) {
+    return client->input_size > MAX_QUEUED ||
+           client->queue_size - client->queue_begin > MAX_QUEUED;
+}
+
+/** @brief Sets events of the connection watched by epoll.
+ * Input is watched until its end unless queues are full, output while
+ * there are queued answers. Finished or broken connection is reported to
+ * main thread, which closes it. Lock of the connection has to be held.
+ * @param[in, out] client   - pointer to the connection.
+ */
+static void watch_connection(connection* client) {
+    uint32_t events = 0;
+    if (client->broken) {
+        if (client->reading || client->finished)
+            events = EPOLLIN | EPOLLOUT; // main thread ends the connection
+    }
+    else {
+        if (client->reading && !queues_full(client))
+            events |= EPOLLIN | EPOLLRDHUP;
+        if (client->queue_begin < client->queue_size || client->finished)
+            events |= EPOLLOUT;
+    }
+    struct epoll_event event = {.events = events, .data.ptr = client};
+    if (events == 0) {
+        // hang up of the socket isn't reported until it is watched again
+        if (client->watched)
+            epoll_ctl(client->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+        client->watched = false;
+    }
+    else if (client->watched) {
+        epoll_ctl(client->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+    }
+    else {
+        client->watched = epoll_ctl(client->epoll_fd, EPOLL_CTL_ADD,
+                                    client->fd, &event) == 0;
+    }
+}
+
+/** @brief Checks if command may be run by a client of the server.
+ * Interactive mode and binary protocol can't be started in the server.
+ * Files are not saved or loaded, as clients could then overwrite or read
+ * any file the server can access.
+ * @param[in] my_command    - parsed command.
+ * @return True if the command may be run.
+ */
+static bool allowed_command(command* my_command) {
+    return my_command->command_type != 'I' &&
+           my_command->command_type != 'X' &&
+           my_command->command_type != 's' &&
+           my_command->command_type != 'L';
+}
+
+/** @brief Runs lines of a job as batch mode commands of the session.
+ * Time of searching for a suggested move is limited, so one command can't
+ * keep the worker and its sessions for long.
+ * @param[in, out] task     - pointer to the job.
+ */
+static void run_job(job* task) {
+    connection* client = task->client;
+    session* game = client->attached;
+    uint32_t args[4];
+    command my_command = {0, args, 0, NULL};
+    char* line = task->lines;
+    char* end = task->lines + task->size;
+    int line_number = task->first_line;
+    while (line < end) {
+        char* line_end = memchr(line, '\n', end - line) + 1;
+        bool proper_command = parse_line(line, line_end - line, &my_command,
+                                         game->g != NULL) &&
+                              allowed_command(&my_command);
+        if (proper_command && my_command.command_type == 'a' &&
+            my_command.args[1] > MAX_SUGGEST_TIME)
+            my_command.args[1] = MAX_SUGGEST_TIME;
+        if (proper_command && my_command.command_type != '#')
+            proper_command = run_command(&my_command, &game->g, line_number,
+                                         &client->output);
+        if (!proper_command)
+            print_error(&client->output, line_number);
+        line = line_end;
+        line_number++;
+    }
+}
+
+/** @brief Main function of worker thread.
+ * Runs jobs in order of adding and queues answers of connections, which
+ * are sent by main thread.
+ * @param[in, out] argument     - pointer to the worker.
+ * @return NULL.
+ */
+static void* work(void* argument) {
+    worker* w = argument;
+    job* jobs;
+    while ((jobs = take_jobs(w)) != NULL) {
+        while (jobs != NULL) {
+            job* task = jobs;
+            jobs = task->next;
+            connection* client = task->client;
+            // closing job is part of connection freed by main thread
+            bool closing = task->lines == NULL;
+            if (!closing) {
+                run_job(task);
+                flush_batch_output(&client->output);
+            }
+            pthread_mutex_lock(&client->lock);
+            if (closing)
+                client->finished = true;
+            else
+                client->input_size -= task->size;
+            watch_connection(client);
+            pthread_mutex_unlock(&client->lock);
+            if (!closing) {
+                free(task->lines);
+                free(task);
+            }
+        }
+    }
+    return NULL;
+}
+
+/** @brief Gives hash of session name.
+ * @param[in] name  - name of the session.
+ * @return Number of the bucket.
+ */
+static uint64_t session_bucket(const char* name) {
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    for (; *name != '\0'; name++)
+        hash = (hash ^ (unsigned char)*name) * 1099511628211ULL;
+    return hash % SESSION_BUCKETS;
+}
+
+/** @brief Finds session with given name or creates it.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in] name          - name of the session.
+ * @return Pointer to the session or NULL if memory couldn't be allocated.
+ */
+static session* find_session(server* state, const char* name) {
+    uint64_t bucket = session_bucket(name);
+    for (session* s = state->buckets[bucket]; s != NULL; s = s->next)
+        if (strcmp(s->name, name) == 0)
+            return s;
+    session* s = malloc(sizeof(session));
+    char* copy = strdup(name);
+    if (s == NULL || copy == NULL) {
+        free(s);
+        free(copy);
+        return NULL; // failed to allocate memory
+    }
+    s->name = copy;
+    s->g = NULL;
+    s->worker = state->sessions_number++ % state->workers_number;
+    s->next = state->buckets[bucket];
+    state->buckets[bucket] = s;
+    return s;
+}
+
+/** @brief Attaches connection to session named in the first line.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection,
+ * @param[in, out] line     - the first line, ended with '\n'.
+ * @param[in] length        - number of characters of the line.
+ * @return False if the line is not "S name".
+ */
+static bool attach(server* state, connection* client, char* line,
+                   size_t length) {
+    line[length - 1] = '\0';
+    if (length < 4 || line[0] != 'S' || line[1] != ' ' ||
+        strpbrk(line + 2, " \t\v\f\r") != NULL || memchr(line, '\0', length - 1))
+        return false; // not a proper session name
+    client->attached = find_session(state, line + 2);
+    return client->attached != NULL;
+}
+
+/** @brief Ends reading of the connection.
+ * Connection attached to a session is finished by its worker after
+ * answering all lines.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection.
+ */
+static void end_reading(server* state, connection* client) {
+    pthread_mutex_lock(&client->lock);
+    client->reading = false;
+    if (client->attached == NULL)
+        client->finished = true; // no worker answers the connection
+    pthread_mutex_unlock(&client->lock);
+    if (client->attached != NULL) {
+        client->closing.client = client;
+        client->closing.lines = NULL;
+        push_job(&state->workers[client->attached->worker], &client->closing);
+    }
+}
+
+/** @brief Closes the connection by the main thread.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection.
+ */
+static void remove_connection(server* state, connection* client) {
+    if (client->watched)
+        epoll_ctl(state->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    if (client->previous != NULL)
+        client->previous->next = client->next;
+    else
+        state->clients = client->next;
+    if (client->next != NULL)
+        client->next->previous = client->previous;
+    close_connection(client);
+}
+
+/** @brief Passes lines to the worker of the session.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection,
+ * @param[in] lines         - consecutive lines ended with '\n', given job
+ *                            takes ownership of them,
+ * @param[in] size          - number of characters of lines.
+ */
+static void push_lines(server* state, connection* client, char* lines,
+                       size_t size) {
+    job* task = malloc(sizeof(job));
+    if (task == NULL) {
+        free(lines);
+        return; // failed to allocate memory, lines are lost
+    }
+    task->client = client;
+    task->lines = lines;
+    task->size = size;
+    task->first_line = client->line_number + 1;
+    for (char* line = lines; (line = memchr(line, '\n',
+         lines + size - line)) != NULL; line++)
+        client->line_number++;
+    pthread_mutex_lock(&client->lock);
+    client->input_size += size;
+    pthread_mutex_unlock(&client->lock);
+    push_job(&state->workers[client->attached->worker], task);
+}
+
+/** @brief Passes complete lines of the connection to its worker.
+ * The first line attaches connection to a session.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection,
+ * @param[in] data          - read characters,
+ * @param[in] size          - number of read characters.
+ * @return False if the connection should be ended.
+ */
+static bool pass_lines(server* state, connection* client, char* data,
+                       size_t size) {
+    if (client->line_size + size > MAX_LINE + READ_SIZE)
+        return false; // line too long
+    char* lines = realloc(client->line, client->line_size + size);
+    if (lines == NULL)
+        return false; // failed to allocate memory
+    memcpy(lines + client->line_size, data, size);
+    client->line = lines;
+    client->line_size += size;
+
+    if (client->attached == NULL) {
+        char* end = memchr(lines, '\n', client->line_size);
+        if (end == NULL)
+            return client->line_size <= MAX_LINE; // session not known yet
+        size_t length = end - lines + 1;
+        if (!attach(state, client, lines, length)) {
+            write_text(&client->output.errors, "ERROR 0\n", 8);
+            flush_writer(&client->output.errors);
+            return false;
+        }
+        client->line_size -= length;
+        memmove(lines, lines + length, client->line_size);
+    }
+
+    char* last = memrchr(lines, '\n', client->line_size);
+    if (last == NULL)
+        return client->line_size <= MAX_LINE; // no complete line
+    size_t complete = last - lines + 1;
+    char* rest = NULL;
+    if (complete < client->line_size) { // unfinished line is kept
+        rest = malloc(client->line_size - complete);
+        if (rest == NULL)
+            return false; // failed to allocate memory
+        memcpy(rest, lines + complete, client->line_size - complete);
+    }
+    client->line = rest;
+    client->line_size -= complete;
+    push_lines(state, client, lines, complete);
+    return true;
+}
+
+/** @brief Passes the last line not ended with '\n' at the end of input.
+ * Such line is an error unless it is a comment, like in batch mode.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection.
+ */
+static void pass_last_line(server* state, connection* client) {
+    if (client->attached == NULL || client->line_size == 0)
+        return;
+    char* line = realloc(client->line, client->line_size + 2);
+    if (line == NULL)
+        return; // failed to allocate memory
+    // "\0\n" after the line makes it incorrect unless it is a comment
+    line[client->line_size] = '\0';
+    line[client->line_size + 1] = '\n';
+    size_t size = client->line_size + 2;
+    client->line = NULL;
+    client->line_size = 0;
+    push_lines(state, client, line, size);
+}
+
+/** @brief Reads available data of the connection.
+ * Reading stops when queues of the connection are full.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection,
+ * @param[in] buffer        - buffer of READ_SIZE characters.
+ */
+static void read_connection(server* state, connection* client, char* buffer) {
+    while (client->reading) {
+        pthread_mutex_lock(&client->lock);
+        bool broken = client->broken;
+        bool full = queues_full(client);
+        pthread_mutex_unlock(&client->lock);
+        if (broken) {
+            end_reading(state, client);
+            return;
+        }
+        if (full)
+            return; // reading is resumed when queues are emptied
+        ssize_t result = recv(client->fd, buffer, READ_SIZE, 0);
+        if (result > 0) {
+            if (!pass_lines(state, client, buffer, result))
+                end_reading(state, client);
+            continue;
+        }
+        if (result < 0 && (errno == EINTR))
+            continue;
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return; // everything was read
+        pass_last_line(state, client);
+        end_reading(state, client);
+    }
+}
+
+/** @brief Handles events of the connection.
+ * Reads lines and sends queued answers. Connection is closed when it is
+ * finished and its answers are sent.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in, out] client   - pointer to the connection,
+ * @param[in] events        - events reported by epoll,
+ * @param[in] buffer        - buffer of READ_SIZE characters.
+ */
+static void serve_connection(server* state, connection* client,
+                             uint32_t events, char* buffer) {
+    read_connection(state, client, buffer);
+    pthread_mutex_lock(&client->lock);
+    if (!client->reading && (events & (EPOLLHUP | EPOLLERR)))
+        client->broken = true; // client won't read answers
+    send_answers(client);
+    bool done = client->finished && (client->broken ||
+                                     client->queue_size == 0);
+    if (!done)
+        watch_connection(client);
+    pthread_mutex_unlock(&client->lock);
+    if (done)
+        remove_connection(state, client);
+}
+
+/** @brief Accepts waiting connections.
+ * @param[in, out] state    - pointer to state of the server.
+ */
+static void accept_connections(server* state) {
+    int fd;
+    while ((fd = accept4(state->listener, NULL, NULL,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        connection* client = calloc(1, sizeof(connection));
+        if (client == NULL) {
+            close(fd);
+            continue; // failed to allocate memory
+        }
+        client->fd = fd;
+        client->epoll_fd = state->epoll_fd;
+        client->reading = true;
+        pthread_mutex_init(&client->lock, NULL);
+        // answers and errors go to the same queue
+        open_batch_sink(&client->output, queue_answers, client);
+        watch_connection(client);
+        if (!client->watched) {
+            close_connection(client);
+            continue;
+        }
+        client->next = state->clients;
+        if (state->clients != NULL)
+            state->clients->previous = client;
+        state->clients = client;
+    }
+}
+
+/** @brief Prepares listening socket, epoll and signal descriptors.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in] socket_path   - path of the listening socket.
+ * @return False if some of them couldn't be created.
+ */
+static bool open_descriptors(server* state, const char* socket_path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+        return false; // path too long
+    strcpy(address.sun_path, socket_path);
+    unlink(socket_path);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL); // inherited by workers
+    sigdelset(&signals, SIGPIPE);
+
+    state->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK |
+                             SOCK_CLOEXEC, 0);
+    state->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    state->signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (state->listener < 0 || state->epoll_fd < 0 || state->signal_fd < 0 ||
+        bind(state->listener, (struct sockaddr*)&address,
+             sizeof(address)) != 0 ||
+        listen(state->listener, SOMAXCONN) != 0)
+        return false;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, state->listener,
+                  &event) != 0)
+        return false;
+    event.data.ptr = &state->signal_fd;
+    return epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, state->signal_fd,
+                     &event) == 0;
+}
+
+/** @brief Starts worker threads.
+ * @param[in, out] state    - pointer to state of the server,
+ * @param[in] workers       - number of threads.
+ * @return False if threads couldn't be started.
+ */
+static bool start_workers(server* state, int workers) {
+    state->workers = calloc(workers, sizeof(worker));
+    if (state->workers == NULL)
+        return false; // failed to allocate memory
+    for (int i = 0; i < workers; i++) {
+        worker* w = &state->workers[i];
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->ready, NULL);
+        if (pthread_create(&w->thread, NULL, work, w) != 0)
+            return false; // failed to start thread
+        state->workers_number++;
+    }
+    return true;
+}
+
+/** @brief Stops worker threads after they finish their jobs.
+ * @param[in, out] state    - pointer to state of the server.
+ */
+static void stop_workers(server* state) {
+    for (int i = 0; i < state->workers_number; i++) {
+        worker* w = &state->workers[i];
+        pthread_mutex_lock(&w->lock);
+        w->stopped = true;
+        pthread_cond_signal(&w->ready);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->ready);
+    }
+    free(state->workers);
+}
+
+/** @brief Frees all sessions and their games.
+ * @param[in, out] state    - pointer to state of the server.
+ */
+static void free_sessions(server* state) {
+    for (int i = 0; i < SESSION_BUCKETS; i++) {
+        while (state->buckets[i] != NULL) {
+            session* s = state->buckets[i];
+            state->buckets[i] = s->next;
+            gamma_delete(s->g);
+            free(s->name);
+            free(s);
+        }
+    }
+}
+
+bool run_server(const char* socket_path, int workers) {
+    server* state = calloc(1, sizeof(server));
+    char* buffer = malloc(READ_SIZE);
+    if (state == NULL || buffer == NULL) {
+        free(state);
+        free(buffer);
+        return false; // failed to allocate memory
+    }
+    state->listener = state->epoll_fd = state->signal_fd = -1;
+    bool started = open_descriptors(state, socket_path) &&
+                   start_workers(state, workers);
+
+    bool running = started;
+    while (running) {
+        struct epoll_event events[MAX_EVENTS];
+        int count = epoll_wait(state->epoll_fd, events, MAX_EVENTS, -1);
+        if (count < 0 && errno != EINTR)
+            break; // epoll failed
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == NULL)
+                accept_connections(state);
+            else if (events[i].data.ptr == &state->signal_fd)
+                running = false; // SIGINT or SIGTERM received
+            else
+                serve_connection(state, events[i].data.ptr, events[i].events,
+                                 buffer);
+        }
+    }
+
+    stop_workers(state);
+    while (state->clients != NULL) { // workers don't use them any more
+        connection* client = state->clients;
+        state->clients = client->next;
+        send_answers(client); // answers are sent if the socket is ready
+        close_connection(client);
+    }
+    free_sessions(state);
+    if (state->listener >= 0) {
+        close(state->listener);
+        unlink(socket_path);
+    }
+    if (state->epoll_fd >= 0)
+        close(state->epoll_fd);
+    if (state->signal_fd >= 0)
+        close(state->signal_fd);
+    free(state);
+    free(buffer);
+    return started;
+}
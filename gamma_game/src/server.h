@@ -0,0 +1,29 @@
+/** @file
+ * Interface of the server hosting many batch mode games.
+ * Clients connect to a Unix domain socket. The first line sent by a client
+ * is "S name", which attaches the connection to the session with this name,
+ * creating it if needed. Following lines are batch mode commands of this
+ * session, answered on the same connection and numbered from 1 after the
+ * "S name" line. Incorrect first line is answered with "ERROR 0" and the
+ * connection is closed. Sessions are kept after clients
+ * disconnect, so a client can continue the game of a session later.
+ * Commands saving and loading files are not accepted and time of searching
+ * for suggested moves is limited.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Runs the server until SIGINT or SIGTERM is received.
+ * @param[in] socket_path   - path of the listening socket,
+ * @param[in] workers       - number of threads running commands.
+ * @return False if the server couldn't be started.
+ */
+bool run_server(const char* socket_path, int workers);
+
+#endif /* SERVER_H */
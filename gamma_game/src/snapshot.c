@@ -0,0 +1,509 @@
+/** @file
+ * Implementation of saving and loading game snapshots.
+ * Snapshot starts with a header followed by players data, risky targets
+ * and frontiers of players and board arrays. Every section starts at offset
+ * divisible by SECTION_ALIGNMENT, so tiles of loaded board lie directly in
+ * the mapped file. The file is mapped privately, changes
+ * made by the game are never written back.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "borders.h"
+#include "board.h"
+#include "field_set.h"
+#include "gamma.h"
+#include "planes.h"
+
+/** @brief First bytes of every snapshot. */
+#define SNAPSHOT_MAGIC "GAMMASNP"
+
+/** @brief Version of snapshot format written by gamma_save. */
+#define SNAPSHOT_VERSION 2
+
+/** @brief Value telling if snapshot was written with the same byte order. */
+#define BYTE_ORDER_MARK 0x01020304
+
+/** @brief Alignment of snapshot sections. */
+#define SECTION_ALIGNMENT 64
+
+/** @brief Structure representing snapshot header.
+ * Offsets are counted from the beginning of the file.
+ */
+typedef struct snapshot_header {
+    char magic[8]; ///< SNAPSHOT_MAGIC without terminating zero.
+    uint32_t version; ///< version of snapshot format.
+    uint32_t byte_order; ///< BYTE_ORDER_MARK in byte order of the writer.
+    uint32_t width; ///< board width.
+    uint32_t height; ///< board height.
+    uint32_t players; ///< maximum number of players in this game.
+    uint32_t areas; ///< maximum number of areas for a player.
+    uint64_t free_fields; ///< fields not belonging to any player.
+    uint32_t sparse; ///< if only busy fields are kept.
+    uint32_t wide_indexes; ///< if node indexes are 64-bit.
+    uint64_t slots; ///< number of slots of sparse board.
+    uint64_t busy_slots; ///< number of busy slots of sparse board.
+    uint64_t used_nodes; ///< number of nodes given to fields.
+    uint64_t nodes_capacity; ///< size of nodes array.
+    uint64_t players_offset; ///< offset of players records.
+    uint64_t targets_offset; ///< offset of risky targets and frontiers.
+    uint64_t owners_offset; ///< offset of owners array.
+    uint64_t field_nodes_offset; ///< offset of nodes of fields array.
+    uint64_t keys_offset; ///< offset of slot keys of sparse board.
+    uint64_t nodes_offset; ///< offset of nodes parents array.
+    uint64_t file_size; ///< size of whole snapshot.
+} snapshot_header;
+
+/** @brief Structure representing player in snapshot.
+ * Risky targets slots and frontier slots of consecutive players follow one
+ * another.
+ */
+typedef struct player_record {
+    uint32_t used_golden; ///< if player already used golden move.
+    uint32_t used_areas; ///< how many arreas does the player have.
+    uint64_t free_borders; ///< free fields adjacent to player fields.
+    uint64_t used_fields; ///< how many fields does the player have.
+    uint64_t golden_targets; ///< foreign adjacent fields safe to take.
+    uint64_t targets_size; ///< number of risky targets.
+    uint64_t targets_capacity; ///< number of risky targets slots.
+    uint64_t targets_incomplete; ///< if risky targets are not complete.
+    uint64_t frontier_size; ///< number of fields in frontier.
+    uint64_t frontier_capacity; ///< number of frontier slots.
+    uint64_t frontier_incomplete; ///< if frontier is not complete.
+} player_record;
+
+/** @brief Rounds offset up to the beginning of the next section.
+ * @param[in] offset    - offset in the file.
+ * @return Rounded offset.
+ */
+static uint64_t align(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT *
+           SECTION_ALIGNMENT;
+}
+
+/** @brief Fills snapshot header describing the game.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[out] header   - pointer to filled header.
+ */
+static void fill_header(gamma_t* g, snapshot_header* header) {
+    memset(header, 0, sizeof(snapshot_header));
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_VERSION;
+    header->byte_order = BYTE_ORDER_MARK;
+    header->width = g->width;
+    header->height = g->height;
+    header->players = g->players;
+    header->areas = g->areas;
+    header->free_fields = g->free_fields;
+    header->sparse = g->sparse;
+    header->wide_indexes = g->wide_indexes;
+    header->slots = g->sparse ? g->slots : 0;
+    header->busy_slots = g->sparse ? g->busy_slots : 0;
+    header->used_nodes = g->used_nodes;
+    header->nodes_capacity = g->nodes_capacity;
+
+    uint64_t positions = storage_size(g);
+    uint64_t targets_slots = 0;
+    for (uint64_t i = 0; i <= g->players; i++)
+        targets_slots += g->players_array[i].risky_targets.capacity +
+                         g->players_array[i].frontier.capacity;
+
+    header->players_offset = align(sizeof(snapshot_header));
+    header->targets_offset = align(header->players_offset +
+                             ((uint64_t)g->players + 1) * sizeof(player_record));
+    header->owners_offset = align(header->targets_offset +
+                                  targets_slots * sizeof(uint64_t));
+    header->field_nodes_offset = align(header->owners_offset +
+                                       positions * sizeof(uint32_t));
+    header->keys_offset = align(header->field_nodes_offset +
+                                positions * index_size(g));
+    header->nodes_offset = align(header->keys_offset +
+                                 (g->sparse ? positions * sizeof(uint64_t) : 0));
+    header->file_size = header->nodes_offset +
+                        g->nodes_capacity * index_size(g);
+}
+
+/** @brief Writes section of the snapshot at given offset.
+ * @param[in] file      - snapshot file,
+ * @param[in] offset    - offset of the section,
+ * @param[in] data      - pointer to written bytes,
+ * @param[in] size      - number of written bytes.
+ * @return False if writing failed.
+ */
+static bool write_section(FILE* file, uint64_t offset,
+                          const void* data, uint64_t size) {
+    if (fseeko(file, offset, SEEK_SET) != 0)
+        return false;
+    return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+/** @brief Writes tiled array as one section of the snapshot.
+ * @param[in] file      - snapshot file,
+ * @param[in] offset    - offset of the section,
+ * @param[in] array     - pointer to written array,
+ * @param[in] elements  - number of elements,
+ * @param[in] size      - size of single element.
+ * @return False if writing failed.
+ */
+static bool write_tiles(FILE* file, uint64_t offset, tiled_array* array,
+                        uint64_t elements, size_t size) {
+    for (uint64_t i = 0; i < array->count; i++) {
+        uint64_t first = i << TILE_SHIFT;
+        uint64_t part = elements - first < TILE_ELEMENTS ? elements - first :
+                                                           TILE_ELEMENTS;
+        if (!write_section(file, offset + first * size, array->data[i],
+                           part * size))
+            return false;
+    }
+    return true;
+}
+
+/** @brief Creates temporary file next to the snapshot path.
+ * Name of the file is @p path followed by process id and a counter, so
+ * saves in other threads and processes get other files. The file is in the
+ * same directory, so it can be renamed over @p path.
+ * @param[in] path          - path of the snapshot,
+ * @param[out] temp_path    - pointer to allocated name of the file.
+ * @return Opened file or NULL if it couldn't be created.
+ */
+static FILE* create_temporary(const char* path, char** temp_path) {
+    static atomic_uint counter;
+    unsigned number = atomic_fetch_add(&counter, 1);
+    if (asprintf(temp_path, "%s.%ld.%u.tmp", path, (long)getpid(),
+                 number) < 0) {
+        *temp_path = NULL;
+        return NULL; // failed to allocate memory
+    }
+    int fd = open(*temp_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    FILE* file = fd == -1 ? NULL : fdopen(fd, "wb");
+    if (file == NULL) {
+        if (fd != -1) {
+            close(fd);
+            unlink(*temp_path);
+        }
+        free(*temp_path);
+        *temp_path = NULL;
+    }
+    return file;
+}
+
+bool gamma_save(gamma_t *g, const char *path) {
+    if (g == NULL || path == NULL)
+        return false; // incorrect parameter
+    // old snapshot is replaced only by a complete one, a game loaded from
+    // it keeps pages mapped from the replaced file
+    char* temp_path;
+    FILE* file = create_temporary(path, &temp_path);
+    if (file == NULL)
+        return false; // failed to create the file
+
+    snapshot_header header;
+    fill_header(g, &header);
+    bool written = write_section(file, 0, &header, sizeof(header));
+
+    uint64_t targets_offset = header.targets_offset;
+    for (uint64_t i = 0; i <= g->players && written; i++) {
+        player_t* player = &g->players_array[i];
+        player_record record = {player->used_golden, player->used_areas,
+                                player->free_borders, player->used_fields,
+                                player->golden_targets,
+                                player->risky_targets.size,
+                                player->risky_targets.capacity,
+                                player->risky_targets.incomplete,
+                                player->frontier.size,
+                                player->frontier.capacity,
+                                player->frontier.incomplete};
+        uint64_t targets_size = record.targets_capacity * sizeof(uint64_t);
+        uint64_t frontier_size = record.frontier_capacity * sizeof(uint64_t);
+        written = write_section(file, header.players_offset +
+                                i * sizeof(player_record),
+                                &record, sizeof(record)) &&
+                  write_section(file, targets_offset,
+                                player->risky_targets.slots, targets_size) &&
+                  write_section(file, targets_offset + targets_size,
+                                player->frontier.slots, frontier_size);
+        targets_offset += targets_size + frontier_size;
+    }
+
+    uint64_t positions = storage_size(g);
+    written = written &&
+        write_tiles(file, header.owners_offset, &g->owners, positions,
+                    sizeof(uint32_t)) &&
+        write_tiles(file, header.field_nodes_offset, &g->field_nodes,
+                    positions, index_size(g)) &&
+        (!g->sparse || write_tiles(file, header.keys_offset, &g->field_keys,
+                                   positions, sizeof(uint64_t))) &&
+        write_tiles(file, header.nodes_offset, &g->nodes, g->nodes_capacity,
+                    index_size(g));
+    written = written && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0)
+        written = false;
+    written = written && rename(temp_path, path) == 0;
+    if (!written)
+        unlink(temp_path); // incomplete snapshot is useless
+    free(temp_path);
+    return written;
+}
+
+/** @brief Checks if section of the snapshot fits before given offset.
+ * Size of the section is computed without overflow.
+ * @param[in] begin     - offset of the section,
+ * @param[in] count     - number of elements of the section,
+ * @param[in] size      - size of single element,
+ * @param[in] end       - offset the section has to end before.
+ * @return True if the section ends at or before @p end.
+ */
+static bool section_fits(uint64_t begin, uint64_t count, uint64_t size,
+                         uint64_t end) {
+    uint64_t bytes;
+    return !__builtin_mul_overflow(count, size, &bytes) && begin <= end &&
+           bytes <= end - begin;
+}
+
+/** @brief Checks if snapshot header describes a correct snapshot.
+ * @param[in] header    - pointer to the header,
+ * @param[in] size      - size of the file.
+ * @return True if the header can be used for loading the game.
+ */
+static bool proper_header(snapshot_header* header, uint64_t size) {
+    if (size < sizeof(snapshot_header))
+        return false; // file too short
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        header->byte_order != BYTE_ORDER_MARK)
+        return false; // not a snapshot or written in other format
+    if (header->width < 1 || header->height < 1 || header->players < 1 ||
+        header->areas < 1 || header->file_size != size)
+        return false; // damaged snapshot
+    if (header->sparse && (header->slots < 2 ||
+        (header->slots & (header->slots - 1)) != 0))
+        return false; // number of slots is not a power of two
+    uint64_t offsets[] = {header->players_offset, header->targets_offset,
+                          header->owners_offset, header->field_nodes_offset,
+                          header->keys_offset, header->nodes_offset};
+    for (int i = 0; i < 6; i++)
+        if (offsets[i] % SECTION_ALIGNMENT != 0 || offsets[i] > size ||
+            (i > 0 && offsets[i] < offsets[i - 1]))
+            return false; // sections out of order
+    return header->used_nodes <= header->nodes_capacity;
+}
+
+/** @brief Loads set of fields from mapped snapshot.
+ * @param[out] set          - pointer to loaded set,
+ * @param[in] header        - pointer to header of mapped snapshot,
+ * @param[in, out] offset   - offset of slots of the set, moved after them,
+ * @param[in] size          - number of fields in the set,
+ * @param[in] capacity      - number of slots of the set,
+ * @param[in] incomplete    - if the set is not complete.
+ * @return False if memory couldn't be allocated or data is damaged.
+ */
+static bool load_set(field_set* set, snapshot_header* header,
+                     uint64_t* offset, uint64_t size, uint64_t capacity,
+                     uint64_t incomplete) {
+    if (!section_fits(*offset, capacity, sizeof(uint64_t),
+                      header->owners_offset) ||
+        (capacity & (capacity - 1)) != 0)
+        return false; // damaged snapshot
+    uint64_t slots_size = capacity * sizeof(uint64_t);
+    if (capacity > 0) {
+        set->slots = malloc(slots_size);
+        if (set->slots == NULL)
+            return false; // failed to allocate memory
+        memcpy(set->slots, (char*)header + *offset, slots_size);
+    }
+    set->capacity = capacity;
+    set->size = size;
+    set->incomplete = incomplete;
+    *offset += slots_size;
+    return true;
+}
+
+/** @brief Loads players data from mapped snapshot.
+ * @param[in, out] g    - pointer to structure holding game status,
+ * @param[in] header    - pointer to header of mapped snapshot.
+ * @return False if memory couldn't be allocated or data is damaged.
+ */
+static bool load_players(gamma_t* g, snapshot_header* header) {
+    char* begin = (char*)header;
+    player_record* records = (player_record*)(begin + header->players_offset);
+    uint64_t targets_offset = header->targets_offset;
+    for (uint64_t i = 0; i <= g->players; i++) {
+        player_t* player = &g->players_array[i];
+        player_record record = records[i];
+        player->used_golden = record.used_golden;
+        player->used_areas = record.used_areas;
+        player->free_borders = record.free_borders;
+        player->used_fields = record.used_fields;
+        player->golden_targets = record.golden_targets;
+        if (!load_set(&player->risky_targets, header, &targets_offset,
+                      record.targets_size, record.targets_capacity,
+                      record.targets_incomplete) ||
+            !load_set(&player->frontier, header, &targets_offset,
+                      record.frontier_size, record.frontier_capacity,
+                      record.frontier_incomplete))
+            return false;
+    }
+    return true;
+}
+
+/** @brief Gives node index kept at given position of the board array.
+ * @param[in] g         - pointer to structure holding game status,
+ * @param[in] array     - pointer to array of node indexes,
+ * @param[in] position  - position in the array.
+ * @return The index, NO_NODE is given as -1.
+ */
+static int64_t index_at(gamma_t* g, tiled_array* array, uint64_t position) {
+    if (g->wide_indexes)
+        return *(int64_t*)tile_element(array, position, sizeof(int64_t));
+    return *(int32_t*)tile_element(array, position, sizeof(int32_t));
+}
+
+/** @brief Checks if board arrays of loaded game are consistent.
+ * Owners must be players of the game, nodes of busy fields and parents of
+ * used nodes must be used nodes, and every key of sparse board must be
+ * a field of the board, so a damaged snapshot can't make the game read
+ * outside its arrays.
+ * Complexity O(n) where n stands for storage size of the board.
+ * @param[in] g - pointer to structure holding game status.
+ * @return True if the board can be used.
+ */
+static bool proper_board(gamma_t* g) {
+    uint64_t positions = storage_size(g), busy_slots = 0;
+    for (uint64_t i = 0; i < positions; i++) {
+        if (g->sparse) {
+            uint64_t key = slot_key(g, i);
+            if (key == NO_FIELD)
+                continue; // free slot
+            if (key >= g->width * (uint64_t)g->height)
+                return false; // field outside the board
+            busy_slots++;
+        }
+        uint32_t owner = *(uint32_t*)tile_element(&g->owners, i,
+                                                  sizeof(uint32_t));
+        if (owner > g->players || (g->sparse && owner == 0))
+            return false; // owner is not a player of the game
+        int64_t node = index_at(g, &g->field_nodes, i);
+        if (owner != 0 && (node < 0 || (uint64_t)node >= g->used_nodes))
+            return false; // busy field without a used node
+    }
+    if (g->sparse && (busy_slots != g->busy_slots || busy_slots >= g->slots))
+        return false; // sparse board has no free slot or wrong count
+    for (uint64_t i = 0; i < g->used_nodes; i++) {
+        int64_t parent = get_parent(g, i);
+        if (parent >= 0 && (uint64_t)parent >= g->used_nodes)
+            return false; // parent is not a used node
+    }
+    return true;
+}
+
+/** @brief Creates game using board arrays of mapped snapshot.
+ * The game takes ownership of the mapping, which is unmapped on failure.
+ * @param[in] header    - pointer to header of mapped snapshot.
+ * @return Pointer to the game or NULL if memory couldn't be allocated
+ * or data is damaged.
+ */
+static gamma_t* load_game(snapshot_header* header) {
+    uint64_t players = header->players;
+    gamma_t* g = NULL;
+    player_t* players_array = NULL;
+    if (section_fits(header->players_offset, players + 1,
+                     sizeof(player_record), header->targets_offset)) {
+        g = malloc(sizeof(gamma_t));
+        players_array = calloc(players + 1, sizeof(player_t));
+    }
+    if (g == NULL || players_array == NULL) {
+        free(g);
+        free(players_array);
+        munmap(header, header->file_size);
+        return NULL; // damaged snapshot or failed to allocate memory
+    }
+
+    g->width = header->width;
+    g->height = header->height;
+    g->players = header->players;
+    g->areas = header->areas;
+    g->free_fields = header->free_fields;
+    g->players_array = players_array;
+    g->field_print_size = count_digits(g->players);
+    g->sparse = header->sparse;
+    g->wide_indexes = header->wide_indexes;
+    g->slots = header->slots;
+    g->busy_slots = header->busy_slots;
+    g->slots_shift = 64;
+    for (uint64_t slots = g->slots; slots > 1; slots /= 2)
+        g->slots_shift--;
+    g->used_nodes = header->used_nodes;
+    g->nodes_capacity = header->nodes_capacity;
+    g->journal = NULL;
+    g->recording = false;
+    g->planes = NULL;
+    g->listener = NULL;
+    g->listener_data = NULL;
+    g->published = NULL;
+    clear_stats(g);
+
+    uint64_t positions = storage_size(g);
+    bool proper =
+        section_fits(header->owners_offset, positions, sizeof(uint32_t),
+                     header->field_nodes_offset) &&
+        section_fits(header->field_nodes_offset, positions, index_size(g),
+                     header->keys_offset) &&
+        section_fits(header->keys_offset, g->sparse ? positions : 0,
+                     sizeof(uint64_t), header->nodes_offset) &&
+        section_fits(header->nodes_offset, g->nodes_capacity, index_size(g),
+                     header->file_size);
+    uint64_t offsets[4] = {header->owners_offset, header->field_nodes_offset,
+                           header->keys_offset, header->nodes_offset};
+    if (!proper) {
+        munmap(header, header->file_size);
+        free(players_array);
+        free(g);
+        return NULL; // damaged snapshot
+    }
+    if (!map_board(g, (char*)header, header->file_size, offsets)) {
+        free(players_array);
+        free(g);
+        return NULL; // failed to allocate memory
+    }
+    if (!proper_board(g) || !load_players(g, header) || !init_planes(g)) {
+        gamma_delete(g); // unmaps the snapshot
+        return NULL; // damaged snapshot or failed to allocate memory
+    }
+    return g;
+}
+
+gamma_t* gamma_load(const char *path) {
+    if (path == NULL)
+        return NULL; // incorrect parameter
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL; // failed to open the file
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 ||
+        (uint64_t)file_stat.st_size < sizeof(snapshot_header)) {
+        close(fd);
+        return NULL; // not a snapshot
+    }
+    uint64_t size = file_stat.st_size;
+    // board arrays are changed in private copies of mapped pages
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return NULL; // failed to map the file
+
+    if (!proper_header(mapping, size)) {
+        munmap(mapping, size);
+        return NULL; // not a snapshot
+    }
+    return load_game(mapping);
+}
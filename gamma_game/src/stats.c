@@ -0,0 +1,43 @@
+/** @file
+ * Implementation of counters of engine hot paths.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "borders.h"
+#include "stats.h"
+
+const char* const stat_names[STAT_COUNTERS] = {
+    "finds", "find_steps", "area_fields", "golden_searches",
+    "golden_cycles", "neighbour_probes", "board_bytes"
+};
+
+bool stats_enabled() {
+#ifdef GAMMA_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void clear_stats(gamma_t* g) {
+#ifdef GAMMA_STATS
+    for (int i = 0; i < STAT_COUNTERS; i++)
+        atomic_init(&g->stats[i], 0);
+#else
+    (void)g;
+#endif
+}
+
+uint64_t stat_value(gamma_t* g, enum stat_counter counter) {
+#ifdef GAMMA_STATS
+    return atomic_load_explicit(&g->stats[counter], memory_order_relaxed);
+#else
+    (void)g;
+    (void)counter;
+    return 0;
+#endif
+}
@@ -0,0 +1,65 @@
+/** @file
+ * Interface of counters of engine hot paths.
+ * Counters are kept for every game only when the engine is compiled with
+ * GAMMA_STATS defined, otherwise counting compiles to nothing. They are
+ * updated with relaxed atomic operations, as queries about the same game
+ * are answered by many threads.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef GAMMA_STATS
+#include <stdatomic.h>
+#endif
+
+/** @brief Counters of engine hot paths. */
+enum stat_counter {
+    STAT_FINDS, ///< searches for main representative in find-and-union.
+    STAT_FIND_STEPS, ///< steps up the tree made by those searches.
+    STAT_AREA_FIELDS, ///< fields visited while giving areas new nodes.
+    STAT_GOLDEN_SEARCHES, ///< areas searched to check a golden move.
+    STAT_GOLDEN_CYCLES, ///< fields freed and given back to check it.
+    STAT_NEIGHBOUR_PROBES, ///< adjacent fields read by borders functions.
+    STAT_BOARD_BYTES, ///< bytes allocated for printing the board.
+    STAT_COUNTERS ///< number of counters.
+};
+
+#ifdef GAMMA_STATS
+/** @brief Adds value to the counter of the game. */
+#define STAT_ADD(g, counter, value) \
+    atomic_fetch_add_explicit(&(g)->stats[counter], (value), \
+                              memory_order_relaxed)
+#else
+/** @brief Counting does nothing, the value isn't evaluated. */
+#define STAT_ADD(g, counter, value) ((void)0)
+#endif
+
+/** @brief Names of counters, used in answers of batch mode. */
+extern const char* const stat_names[STAT_COUNTERS];
+
+struct gamma;
+
+/** @brief Checks if counters are compiled into the engine.
+ * @return True if GAMMA_STATS was defined.
+ */
+bool stats_enabled();
+
+/** @brief Sets every counter of the game to zero.
+ * @param[out] g     - pointer to structure holding game status.
+ */
+void clear_stats(struct gamma* g);
+
+/** @brief Gives value of the counter of the game.
+ * @param[in] g       - pointer to structure holding game status,
+ * @param[in] counter - the counter.
+ * @return Value of the counter, 0 if counters aren't compiled in.
+ */
+uint64_t stat_value(struct gamma* g, enum stat_counter counter);
+
+#endif /* STATS_H */